@@ -1,11 +1,42 @@
 #pragma once
 #define TINYEXIF_NO_XMP_SUPPORT  // 在包含头文件前定义 禁止xmp
 #include "TinyEXIF.h"  // 使用相对路径
+#include <filesystem>
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <string>
 
+/**
+ * @class FileEXIFStream
+ * @brief 按需读取 JPEG 的 EXIFStream
+ * @description TinyEXIF 逐个读取标记，其他段只是跳过；这里按位置读取，只有标记和 APP1 段会被读入，
+ *              大尺寸 JPEG 取 EXIF 也只有几 KB 的读取，不再把整个文件读进内存。
+ *              不使用映射：文件在读取期间被改写或截断时只会解析失败。
+ */
+class FileEXIFStream : public TinyEXIF::EXIFStream {
+public:
+    // 直接接受 fs::path：Windows 上不经过本地编码转换，任何文件名都能打开
+    explicit FileEXIFStream(const std::filesystem::path& path)
+        : m_stream(path, std::ios::binary) {}
+
+    bool IsValid() const override { return m_stream.is_open(); }
+
+    const uint8_t* GetBuffer(unsigned desiredLength) override {
+        m_buffer.resize(desiredLength);
+        if (!m_stream.read(reinterpret_cast<char*>(m_buffer.data()), desiredLength)) return nullptr;
+        return m_buffer.data();
+    }
+
+    bool SkipBuffer(unsigned desiredLength) override {
+        return static_cast<bool>(m_stream.seekg(desiredLength, std::ios::cur));
+    }
+
+private:
+    std::ifstream m_stream;
+    std::vector<uint8_t> m_buffer;
+};
+
 class EXIF {
 private:
     std::string m_imagePath;
@@ -17,30 +48,15 @@ private:
 public:
 EXIF(const std::string& imagePath) : m_imageWidth(0), m_imageHeight(0), m_isValid(false) 
 {
-    std::ifstream input_file(imagePath, std::ios::binary);
-    if (!input_file) {
+    FileEXIFStream stream(imagePath);
+    if (!stream.IsValid()) {
         std::cerr << "Error: cannot open input file" << std::endl;
         return;
     }
 
-    // 获取文件大小（带错误检查）
-    input_file.seekg(0, std::ios::end);
-    size_t file_size = input_file.tellg();
-    if (file_size == static_cast<size_t>(-1)) {
-        std::cerr << "Error: failed to get file size" << std::endl;
-        return;
-    }
-    input_file.seekg(0, std::ios::beg);
-
-    // 读取文件内容
-    std::vector<uint8_t> file_data(file_size);
-    if (!input_file.read(reinterpret_cast<char*>(file_data.data()), file_size)) {
-        std::cerr << "Error: failed to read file content" << std::endl;
-        return;
-}
+    // 解析EXIF：只读取 JPEG 标记和 APP1 段
 
-    // 解析EXIF
-    if (info.parseFrom(file_data.data(), file_size) != TinyEXIF::PARSE_SUCCESS) {
+    if (info.parseFrom(stream) != TinyEXIF::PARSE_SUCCESS) {
         std::cerr << "Error: EXIF parsing failed" << std::endl;
         m_isValid=false;
         return;
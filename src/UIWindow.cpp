@@ -133,6 +133,14 @@ bool UIWindow::initialize() {
         cleanup();
         return false;
     }
+
+    // 可选：像素缓冲区异步上传，不支持时退回 nvgCreateImageRGBA
+    if (pixelUploadEnabled) {
+        uploadRing = std::make_unique<PixelUploadRing>(vg);
+        if (!uploadRing->initialize()) {
+            uploadRing.reset();
+        }
+    }
     
     // 添加字体加载代码
     int font = nvgCreateFont(vg, "default", "./msyh.ttc");
@@ -165,6 +173,9 @@ bool UIWindow::initialize() {
  * @description 按相反顺序清理资源：NanoVG -> GLFW窗口 -> GLFW库
  */
 void UIWindow::cleanup() {
+    // 像素缓冲区属于当前 GL 上下文，需在上下文销毁前释放
+    uploadRing.reset();
+
     // 清理NanoVG上下文
     if (vg) {
         nvgDeleteGL3(vg);
@@ -256,6 +267,17 @@ void UIWindow::getFramebufferSize(int& width, int& height) const {
     if (window) glfwGetFramebufferSize(window, &width, &height);
 }
 
+/**
+ * @brief 获取单张纹理的最大边长
+ * @return int GL_MAX_TEXTURE_SIZE，上下文未创建时返回 0
+ */
+int UIWindow::getMaxTextureSize() const {
+    if (!window) return 0;
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    return static_cast<int>(maxSize);
+}
+
 /**
  * @brief 获取鼠标光标在窗口中的位置
  * @param x 输出参数，光标X坐标（相对于窗口左上角）
@@ -296,6 +318,11 @@ void UIWindow::beginFrame() {
     
     // 设置OpenGL视口为整个帧缓冲区
     glViewport(0, 0, width, height);
+
+    // 回收上一帧提交的像素缓冲区
+    if (uploadRing) {
+        uploadRing->pump();
+    }
     
     // 开始NanoVG渲染帧
     // 参数：上下文、宽度、高度、设备像素比
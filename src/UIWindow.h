@@ -13,6 +13,8 @@
 // 移除这行：#include "nanovg_gl.h"
 #include <functional>
 #include <string>
+#include <memory>
+#include "component/PixelUploadRing.h"
 
 // #include "stb_image.h"
 
@@ -108,6 +110,12 @@ public:
      */
     void getFramebufferSize(int& width, int& height) const;
     
+    /**
+     * @brief 获取单张纹理的最大边长（GL_MAX_TEXTURE_SIZE）
+     * @return int 最大边长，上下文未创建时返回 0
+     */
+    int getMaxTextureSize() const;
+    
     /**
      * @brief 获取鼠标光标位置
      * @param x 输出参数，光标X坐标
@@ -168,6 +176,24 @@ public:
      */
     GLFWwindow* getGLFWWindow() const { return window; }
 
+    // ==================== 异步纹理上传 ====================
+
+    /**
+     * @brief 启用基于像素缓冲区的异步纹理上传
+     * @param enable 是否启用
+     * @description 必须在 initialize 前调用；上下文不支持时自动关闭
+     */
+    void setPixelUploadEnabled(bool enable) { pixelUploadEnabled = enable; }
+
+    /**
+     * @brief 获取像素缓冲区上传环
+     * @return PixelUploadRing* 未启用或不支持时返回 nullptr
+     * @description 与 nvgCreateImageRGBA / nvgUpdateImage 并列的创建、更新接口：
+     *              工作线程把像素写入 acquire 得到的暂存内存，主线程用 createImage / updateImage 提交，
+     *              每帧在 beginFrame 中回收 GPU 已读完的缓冲区
+     */
+    PixelUploadRing* getUploadRing() const { return uploadRing.get(); }
+
     // ==================== 事件回调设置 ====================
     
     /**
@@ -220,6 +246,8 @@ private:
     int windowWidth, windowHeight; ///< 窗口尺寸
     std::string windowTitle;     ///< 窗口标题
     bool initialized;            ///< 初始化状态标志
+    bool pixelUploadEnabled = false;               ///< 是否启用像素缓冲区上传
+    std::unique_ptr<PixelUploadRing> uploadRing;   ///< 像素缓冲区上传环
     std::function<void(int, const char**)> dropCallback;
     static void dropCallbackWrapper(GLFWwindow* window, int count, const char** paths);
     
@@ -3,6 +3,9 @@
 #include "utils/utils.h"
 #include "utils/setting.h"
 #include "TinyEXIF/EXIF.h"
+#include "component/DecodeScheduler.h"
+#include "utils/DecodeBufferPool.h"
+#include "utils/ExifCache.h"
 #include <iostream>
 #include <chrono>
 #include <algorithm>
@@ -20,10 +23,28 @@ VimagApp::VimagApp() : window(Config::DEFAULT_WINDOW_WIDTH, Config::DEFAULT_WIND
 }
 
 VimagApp::~VimagApp() {
-    // 等待后台线程完成
-    if (m_scanThread.joinable()) {
-        m_scanThread.join();
+    // 停止目录监视、后台扫描和排序
+    m_watcher.stop();
+    m_scanner.cancel();
+    m_scanner.wait();
+    if (m_indexThread.joinable()) m_indexThread.join();
+    m_sorter.cancel();
+    m_sorter.wait();
+    ExifCache::getInstance().cancelPrefetch();
+    if (directoryIndex) {
+        m_directoryIndex.save();
+        ExifCache::getInstance().save();
     }
+    // 控件持有的纹理句柄必须先于缓存释放
+    UITexture::cleanupAll();
+    UITexture::setTextureCache(nullptr);
+    // 先释放预加载缓存（会等待其解码任务结束），再停止解码线程池
+    textureCaches.reset();
+    DecodeScheduler::getInstance().shutdown();
+#ifdef DEBUG
+    ImageDecoderRegistry::getInstance().printStats();
+    DecodeBufferPool::getInstance().printStats();
+#endif
 }
 
 bool VimagApp::initialize(int argc, char** argv) {
@@ -33,13 +54,13 @@ bool VimagApp::initialize(int argc, char** argv) {
     } else {
         std::cout << "Usage: " << argv[0] << " <file_path>" << std::endl;
         // 使用默认图像
-        imagePaths.push_back("Vimag.png");
-        imageNames.push_back("Vimag.png");
+        imageCatalog.add(fs::path("Vimag.png"));
     }
     
     // 初始化窗口
     window.enableDynamicTitleBar(true, 15.0);
     window.setTransparentFramebuffer(true);
+    window.setPixelUploadEnabled(pixelBufferUpload);
     
     if (!window.initialize()) {
         std::cerr << "Failed to initialize window" << std::endl;
@@ -63,6 +84,23 @@ bool VimagApp::initialize(int argc, char** argv) {
     
     window.getFramebufferSize(currentWindowWidth, currentWindowHeight);
     
+    textureCaches = std::make_unique<TextureCaches>(window.getNVGContext());
+    textureCaches->setMemoryBudget(static_cast<size_t>(std::max(gpuCacheBudgetMB, 64)) * 1024 * 1024,
+                                   static_cast<size_t>(std::max(cpuCacheBudgetMB, 64)) * 1024 * 1024);
+    // 预加载的纹理分帧上传，避免一帧内上传多张大图造成卡顿
+    textureCaches->setUploadBudget(static_cast<size_t>(std::max(uploadBudgetMB, 4)) * 1024 * 1024,
+                                   static_cast<double>(std::max(uploadBudgetMs, 1)));
+    textureCaches->setUploadRing(window.getUploadRing());
+    textureCaches->setTexturePoolCapacity(static_cast<size_t>(std::max(texturePoolSize, 0)),
+                                          static_cast<size_t>(std::max(texturePoolMB, 0)) * 1024 * 1024);
+    textureCaches->setMipmapsEnabled(mipmaps);
+    DecodeBufferPool::getInstance().setCacheLimit(static_cast<size_t>(std::max(decodePoolMB, 0)) * 1024 * 1024);
+    updateDecodeTarget();
+    // 超过纹理上限的图片先缩小显示，放大时改用分块
+    textureCaches->setMaxTextureSize(window.getMaxTextureSize());
+    // 显示控件与预加载共用同一个缓存
+    UITexture::setTextureCache(textureCaches.get());
+    
     createUI();
     
     setupEventHandlers();
@@ -77,14 +115,30 @@ void VimagApp::loadSettings() {
     showIndex = getSettingBool("Display", "image_index", true);
     showExif = getSettingBool("Display", "image_EXIF", true);
     enableExifOrientation = getSettingBool("Display", "Enable_Exif_orientation", true);
+    gpuCacheBudgetMB = getSettingInt("Cache", "gpu_budget_mb", 512);
+    cpuCacheBudgetMB = getSettingInt("Cache", "cpu_budget_mb", 256);
+    uploadBudgetMB = getSettingInt("Cache", "upload_budget_mb", 32);
+    uploadBudgetMs = getSettingInt("Cache", "upload_budget_ms", 4);
+    pixelBufferUpload = getSettingBool("Cache", "pixel_buffer_upload", true);
+    texturePoolSize = getSettingInt("Cache", "texture_pool_size", 8);
+    texturePoolMB = getSettingInt("Cache", "texture_pool_mb", 128);
+    mipmaps = getSettingBool("Cache", "mipmaps", true);
+    decodePoolMB = getSettingInt("Cache", "decode_pool_mb", 256);
+    decodeToDisplay = getSettingBool("Cache", "decode_to_display", true);
+    decodeDisplayMultiple = std::clamp(getSettingInt("Cache", "decode_display_multiple", 1), 1, 4);
+    directoryIndex = getSettingBool("Cache", "directory_index", true);
+    directoryWatch = getSettingBool("Cache", "directory_watch", true);
+    if (!parseSortMode(getSetting("Display", "sort_mode", "path"), sortMode)) {
+        sortMode = SortMode::Path;
+    }
+    sortDescending = getSettingBool("Display", "sort_descending", false);
 }
 
 void VimagApp::loadImages(const std::string& filePath) {
     if (isFile(filePath)) {
         // 如果是文件，只加载这一个文件，延迟扫描目录
         fs::path directory = getDirectoryFromPath(filePath);
-        imagePaths.push_back(fs::path(filePath));
-        imageNames.push_back(fs::path(filePath).filename().string());
+        imageCatalog.add(fs::path(filePath));
         currentIndex = 0;
         
         // 标记需要后台扫描
@@ -92,19 +146,51 @@ void VimagApp::loadImages(const std::string& filePath) {
         m_scanDirectory = directory;
         m_originalFilePath = filePath;
     } else if (isDirectory(filePath)) {
+        // 如果是目录，先显示顶层找到的第一张图片，索引读取或目录扫描和打开文件时一样在后台完成
         fs::path directory = filePath;
-        find_image_files(directory, imagePaths, imageNames);
+        fs::path first = findFirstImage(directory);
+        if (!first.empty()) {
+            imageCatalog.add(first);
+            m_originalFilePath = first;
+        } else {
+            m_showFirstScanned = true;
+        }
+        currentIndex = 0;
+
+        m_needsDirectoryScan = true;
+        m_scanDirectory = directory;
     } else {
         // 原有的默认处理逻辑
         fs::path directory = "./";
-        getImages(filePath, directory, imagePaths, imageNames, currentIndex);
+        std::vector<fs::path> paths;
+        std::vector<std::string> names;
+        getImages(filePath, directory, paths, names, currentIndex);
+        imageCatalog.assign(paths);
+        // 列表已重新排序
+        size_t index = currentIndex < paths.size() ? imageCatalog.find(paths[currentIndex]) : ImageCatalog::npos;
+        currentIndex = index == ImageCatalog::npos ? 0 : index;
     }
     
-    if (imagePaths.empty()) {
-        imagePaths.push_back("Vimag.png");
-        imageNames.push_back("Vimag.png");
+    if (imageCatalog.empty()) {
+        imageCatalog.add(fs::path("Vimag.png"));
         currentIndex = 0;
     }
+    // 扫描得到的列表按路径排序，其他排序方式在后台完成
+    m_sortPending = !isPathOrder();
+    if (directoryIndex && !m_scanDirectory.empty()) {
+        ExifCache::getInstance().load(m_scanDirectory);
+    }
+}
+
+fs::path VimagApp::findFirstImage(const fs::path& directory) {
+    // 只看顶层，找到一张就停下，不遍历整个目录
+    std::error_code ec;
+    for (fs::directory_iterator it(directory, ec), end; !ec && it != end; it.increment(ec)) {
+        if (DirectoryScanner::isImageExtension(it->path()) && it->is_regular_file(ec)) {
+            return it->path();
+        }
+    }
+    return fs::path();
 }
 
 // 修复 run 方法中的错误
@@ -120,10 +206,15 @@ void VimagApp::run() {
     const double targetFrameTime = 1.0 / Config::TARGET_FPS;
     auto lastTime = glfwGetTime();
     
+    // 先开始监视再扫描，扫描期间的变化不会漏掉
+    if (directoryWatch && !m_scanDirectory.empty()) {
+        m_watcher.start(m_scanDirectory);
+    }
     // 启动后台目录扫描
     if (m_needsDirectoryScan) {
         startBackgroundDirectoryScan();
     }
+    updatePrefetchWindow();
 
     while (!window.shouldClose()) {
   
@@ -148,6 +239,8 @@ void VimagApp::run() {
         // 更新
         texture->update(deltaTime);
         window.pollEvents();
+        textureCaches->processMainThreadTasks();
+        processPendingImageLoad();
         UIAnimationManager::getInstance().update(deltaTime);
         
         // 定时器检查
@@ -158,6 +251,8 @@ void VimagApp::run() {
         
         // 检查后台扫描是否完成
         checkBackgroundScanCompletion();
+        applyDirectoryChanges();
+        checkSortCompletion();
 
         
         // === 优化渲染条件 ===
@@ -207,47 +302,406 @@ void VimagApp::run() {
 
     }
     
-    // 清理后台线程
-    if (m_scanThread.joinable()) {
-        m_scanThread.join();
-    }
+    // 清理目录监视、后台扫描和排序线程
+    m_watcher.stop();
+    m_scanner.cancel();
+    m_scanner.wait();
+    if (m_indexThread.joinable()) m_indexThread.join();
+    m_sorter.cancel();
+    m_sorter.wait();
 }
 
 // 添加后台扫描方法的实现
-void VimagApp::startBackgroundDirectoryScan() {
-    m_scanThread = std::thread([this]() {
-        std::vector<fs::path> allImagePaths;
-        std::vector<std::string> allImageNames;
-        
-        // 在后台线程中扫描目录
-        find_image_files(m_scanDirectory, allImagePaths, allImageNames);
-        
-        // 找到原始文件的索引
-        size_t newIndex = findPathIndex(allImagePaths, m_originalFilePath);
-        
-        // 原子性地更新主线程数据
-        {
+void VimagApp::startBackgroundDirectoryScan(bool streamResults) {
+    m_streamScan = streamResults;
+    m_scanCompleted = false;
+    m_originalMerged = false;
+    m_scanIncoming.clear();
+    m_scanAll.clear();
+
+    // 有索引时只检查变化的目录，不再遍历整棵目录树。
+    // 读取和校验要逐个查询目录状态，在后台线程完成，结果和扫描一样通过 m_scanAll 交给主线程
+    if (directoryIndex) {
+        if (m_indexThread.joinable()) m_indexThread.join();
+        m_indexLoadFailed = false;
+        m_indexThread = std::thread([this, root = m_scanDirectory] {
+            // 重新扫描时先写回尚未保存的图片信息，load 会丢弃内存中的内容
+            m_directoryIndex.save();
+            if (!m_directoryIndex.load(root)) {
+                m_indexLoadFailed = true;
+                return;
+            }
+            m_directoryIndex.refresh();
+            m_directoryIndex.getImages(m_scanAll);
+            m_directoryIndex.save();
+            m_scanCompleted = true;
+        });
+        return;
+    }
+    startFullDirectoryScan();
+}
+
+void VimagApp::startFullDirectoryScan() {
+    if (directoryIndex) {
+        m_directoryIndex.reset(m_scanDirectory);
+        m_scanner.setDirectoryCallback([this](const fs::path& directory) {
+            m_directoryIndex.recordDirectory(directory);
+        });
+    }
+
+    // 扫描线程每处理完一个目录就交出一批图片，主线程逐帧并入列表，不必等整棵目录树扫完
+    bool started = m_scanner.start(m_scanDirectory,
+        [this](std::vector<fs::path>&& batch) {
             std::lock_guard<std::mutex> lock(m_imageDataMutex);
-            imagePaths = std::move(allImagePaths);
-            imageNames = std::move(allImageNames);
-            if (newIndex != static_cast<size_t>(-1)) {
-                currentIndex = newIndex;
+            for (const auto& path : batch) {
+                m_scanAll.add(path);
             }
+            m_scanIncoming.insert(m_scanIncoming.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        },
+        [this](const DirectoryScanStats& stats) {
+            // 所有批次都已交出，在扫描线程中排序，避免阻塞主线程
+            m_scanAll.sort();
+            if (directoryIndex && !stats.cancelled) {
+                m_directoryIndex.assign(m_scanAll);
+                m_directoryIndex.save();
+            }
+            m_scanCompleted = true;
+        });
+    if (!started) {
+        m_needsDirectoryScan = false;
+    }
+}
+
+void VimagApp::mergeScannedImages(std::vector<fs::path>& batch) {
+    const fs::path original = m_originalFilePath.lexically_normal();
+    const size_t before = imageCatalog.size();
+    for (const auto& path : batch) {
+        // 原始文件已经在列表开头
+        if (!m_originalMerged && path.filename() == original.filename() && path.lexically_normal() == original) {
+            m_originalMerged = true;
+            continue;
         }
-        
-        m_scanCompleted = true;
-    });
+        imageCatalog.add(path);
+    }
+    if (imageCatalog.size() != before) {
+        m_prefetchStale = true;
+        // 标签会重新读取 EXIF，扫描期间限制刷新频率
+        auto now = std::chrono::steady_clock::now();
+        if (now - m_lastScanLabelUpdate >= std::chrono::milliseconds(250)) {
+            m_lastScanLabelUpdate = now;
+            updateImageLabels();
+        }
+    }
 }
 
 void VimagApp::checkBackgroundScanCompletion() {
-    if (m_scanCompleted.load()) {
-        {
-            std::lock_guard<std::mutex> lock(m_imageDataMutex);
-            updateImageLabels(); // 更新显示的图片信息
+    if (!m_needsDirectoryScan) return;
+    if (m_indexLoadFailed.exchange(false)) {
+        m_indexThread.join();
+        startFullDirectoryScan();
+        return;
+    }
+    // 先读取完成标志再取批次：完成之前交出的批次一定都能取到
+    const bool completed = m_scanCompleted.load();
+    std::vector<fs::path> incoming;
+    {
+        std::lock_guard<std::mutex> lock(m_imageDataMutex);
+        incoming.swap(m_scanIncoming);
+    }
+    if (!completed) {
+        if (m_streamScan && !incoming.empty()) mergeScannedImages(incoming);
+        return;
+    }
+
+    // 扫描结束：换成排序后的完整列表，并重新定位当前图片
+    const fs::path current = imageCatalog.path(currentIndex);
+    size_t newIndex = m_scanAll.find(current);
+    if (newIndex == ImageCatalog::npos) {
+        // 路径写法可能不同（如相对路径），按规范化后的路径再找一次
+        const fs::path normal = current.lexically_normal();
+        const std::string name = current.filename().u8string();
+        for (size_t i = 0; i < m_scanAll.size(); ++i) {
+            if (m_scanAll.name(i) == name && m_scanAll.path(i).lexically_normal() == normal) {
+                newIndex = i;
+                break;
+            }
         }
-        m_scanCompleted = false;
-        m_needsDirectoryScan = false;
     }
+    bool currentMissing = false;
+    std::error_code ec;
+    const bool onPlaceholder = m_showFirstScanned && currentIndex == 0;
+    m_showFirstScanned = false;
+    if (onPlaceholder) {
+        // 启动时显示的是占位图，换成扫描到的第一张图片
+        currentMissing = true;
+        if (m_scanAll.empty()) {
+            m_scanAll.add(fs::path("Vimag.png"));
+        }
+        newIndex = 0;
+    } else if (newIndex == ImageCatalog::npos && fs::exists(current, ec)) {
+        // 当前文件不在扫描结果中（例如扩展名不在支持列表里），按顺序插入，保持列表有序
+        m_scanAll.insertSorted(current);
+        newIndex = m_scanAll.find(current);
+    } else if (newIndex == ImageCatalog::npos) {
+        // 重新扫描期间当前文件已被删除：显示同一位置的图片
+        currentMissing = true;
+        if (m_scanAll.empty()) {
+            m_scanAll.add(fs::path("Vimag.png"));
+        }
+        newIndex = std::min(currentIndex, m_scanAll.size() - 1);
+    }
+    if (m_indexThread.joinable()) m_indexThread.join();
+    imageCatalog = std::move(m_scanAll);
+    m_scanAll.clear();
+    currentIndex = newIndex;
+    // 新列表不带之前记录的尺寸信息，重新记录当前图片
+    m_recordedImagePath.clear();
+
+    m_scanCompleted = false;
+    m_needsDirectoryScan = false;
+    if (!isPathOrder()) m_sortPending = true;
+    if (currentMissing) {
+        updateImageDisplay();
+    } else {
+        updateImageLabels(); // 更新显示的图片信息
+    }
+    // 完整列表已就绪，按新索引重建预加载窗口
+    updatePrefetchWindow();
+}
+
+bool VimagApp::insertImagePath(const fs::path& path) {
+    if (isPathOrder()) return imageCatalog.insertSorted(path);
+    // 其他排序方式下先追加到末尾，稍后在后台重新排序
+    const size_t count = imageCatalog.size();
+    imageCatalog.add(path);
+    if (imageCatalog.size() == count) return false;
+    m_sortPending = true;
+    return true;
+}
+
+bool VimagApp::removeImagePaths(const fs::path& path, bool directory) {
+    if (!isPathOrder()) {
+        // 要删除的图片分散在列表中：保留的项移到前面，删除的项留在末尾一起删掉
+        std::vector<uint32_t> order;
+        std::vector<uint32_t> removed;
+        order.reserve(imageCatalog.size());
+        const size_t exact = directory ? ImageCatalog::npos : imageCatalog.find(path);
+        for (size_t i = 0; i < imageCatalog.size(); ++i) {
+            if (directory ? imageCatalog.isUnder(i, path) : i == exact) {
+                removed.push_back(static_cast<uint32_t>(i));
+            } else {
+                order.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        if (removed.empty()) return false;
+        const size_t kept = order.size();
+        for (uint32_t i : removed) {
+            if (textureCaches) textureCaches->invalidateImage(imageCatalog.path(i));
+        }
+        order.insert(order.end(), removed.begin(), removed.end());
+        imageCatalog.permute(order);
+        imageCatalog.erase(kept, imageCatalog.size());
+        return true;
+    }
+    // 列表有序，目录下的图片紧跟在目录路径之后
+    const size_t first = imageCatalog.lowerBound(path);
+    const size_t exact = directory ? ImageCatalog::npos : imageCatalog.find(path);
+    size_t last = first;
+    while (last < imageCatalog.size() && (directory ? imageCatalog.isUnder(last, path) : last == exact)) {
+        if (textureCaches) textureCaches->invalidateImage(imageCatalog.path(last));
+        ++last;
+    }
+    if (first == last) return false;
+    imageCatalog.erase(first, last);
+    return true;
+}
+
+void VimagApp::applyDirectoryChanges() {
+    // 扫描结束前列表还不完整，事件留在系统队列中
+    if (!m_watcher.isWatching() || m_needsDirectoryScan) return;
+    std::vector<DirectoryChange> changes;
+    m_watcher.poll(changes);
+    if (changes.empty()) return;
+
+    const fs::path current = imageCatalog.path(currentIndex);
+    fs::path followed = current;        // 当前图片改名后跟随新名字
+    bool currentModified = false;
+    bool listChanged = false;
+    for (const auto& change : changes) {
+        switch (change.type) {
+        case DirectoryChange::Type::Overflow:
+            std::cout << "[VimagApp] Too many directory changes, rescanning " << m_scanDirectory << std::endl;
+            m_needsDirectoryScan = true;
+            startBackgroundDirectoryScan(false);
+            return;
+        case DirectoryChange::Type::Added:
+            listChanged |= insertImagePath(change.path);
+            break;
+        case DirectoryChange::Type::Modified:
+            if (insertImagePath(change.path)) {
+                listChanged = true;
+            } else if (change.path == followed) {
+                currentModified = true;
+            } else if (textureCaches) {
+                textureCaches->invalidateImage(change.path);
+            }
+            break;
+        case DirectoryChange::Type::Removed:
+            listChanged |= removeImagePaths(change.path, change.directory);
+            break;
+        case DirectoryChange::Type::Renamed:
+            removeImagePaths(change.oldPath, false);
+            insertImagePath(change.path);
+            listChanged = true;
+            if (change.oldPath == followed) followed = change.path;
+            break;
+        }
+    }
+    if (!listChanged && !currentModified) return;
+
+    if (imageCatalog.empty()) {
+        imageCatalog.add(fs::path("Vimag.png"));
+    }
+    // 重新定位当前图片；它被删除时显示同一位置的下一张
+    const size_t index = imageCatalog.find(followed);
+    const bool currentRemoved = index == ImageCatalog::npos;
+    currentIndex = currentRemoved ? std::min(currentIndex, imageCatalog.size() - 1) : index;
+
+    if (currentRemoved || currentModified || followed != current) {
+        // 先释放控件对旧纹理的引用，才能从缓存中丢弃旧内容
+        texture->setImagePath(window.getNVGContext(), "");
+        if (textureCaches) textureCaches->invalidateImage(current);
+        updateImageDisplay();
+    } else {
+        updateImageLabels();
+    }
+    if (listChanged) updatePrefetchWindow();
+}
+
+bool VimagApp::isPathOrder() const {
+    return sortMode == SortMode::Path && !sortDescending;
+}
+
+void VimagApp::startSort() {
+    m_sortPending = false;
+    m_sorter.start(imageCatalog, sortMode, sortDescending);
+}
+
+void VimagApp::checkSortCompletion() {
+    ImageCatalog sorted;
+    SortStats stats;
+    if (!m_sorter.takeResult(sorted, stats)) {
+        // 扫描进行中时等扫描结束后再排序，避免对不完整的列表反复排序
+        if (m_sortPending && !m_needsDirectoryScan && !m_sorter.isRunning()) startSort();
+        return;
+    }
+
+    // 排序期间列表可能被目录监视修改：去掉已删除的，新增的追加到末尾并再排一次
+    bool same = sorted.size() == imageCatalog.size();
+    for (size_t i = 0; same && i < sorted.size(); ++i) {
+        same = imageCatalog.find(sorted.directoryString(sorted.directoryId(i)), sorted.name(i)) != ImageCatalog::npos;
+    }
+    if (!same) {
+        ImageCatalog merged;
+        merged.reserve(imageCatalog.size());
+        auto copyEntry = [&merged](const ImageCatalog& from, size_t i) {
+            size_t index = merged.add(merged.addDirectory(from.directoryString(from.directoryId(i))), from.name(i));
+            ImageIndexInfo info;
+            int64_t capture = 0;
+            if (from.getMetadata(i, info)) merged.setMetadata(index, info);
+            if (from.getCaptureTime(i, capture)) merged.setCaptureTime(index, capture);
+        };
+        for (size_t i = 0; i < sorted.size(); ++i) {
+            if (imageCatalog.find(sorted.directoryString(sorted.directoryId(i)), sorted.name(i)) != ImageCatalog::npos) {
+                copyEntry(sorted, i);
+            }
+        }
+        for (size_t i = 0; i < imageCatalog.size(); ++i) {
+            if (sorted.find(imageCatalog.directoryString(imageCatalog.directoryId(i)), imageCatalog.name(i)) == ImageCatalog::npos) {
+                copyEntry(imageCatalog, i);
+                m_sortPending = true;
+            }
+        }
+        sorted = std::move(merged);
+    }
+
+    // 当前图片保持不变
+    const fs::path current = imageCatalog.path(currentIndex);
+    imageCatalog = std::move(sorted);
+    if (imageCatalog.empty()) imageCatalog.add(fs::path("Vimag.png"));
+    const size_t index = imageCatalog.find(current);
+    currentIndex = index == ImageCatalog::npos ? std::min(currentIndex, imageCatalog.size() - 1) : index;
+    updateImageLabels();
+    updatePrefetchWindow();
+}
+
+void VimagApp::cycleSortMode(bool toggleDescending) {
+    if (toggleDescending) {
+        sortDescending = !sortDescending;
+        setSettingBool("Display", "sort_descending", sortDescending);
+    } else {
+        sortMode = static_cast<SortMode>((static_cast<int>(sortMode) + 1) % static_cast<int>(SortMode::Count));
+        setSetting("Display", "sort_mode", sortModeName(sortMode));
+    }
+    std::cout << "[VimagApp] Sort by " << sortModeName(sortMode) << (sortDescending ? " (descending)" : "") << std::endl;
+    if (m_needsDirectoryScan) {
+        m_sortPending = true;
+    } else {
+        startSort();
+    }
+}
+
+void VimagApp::updatePrefetchWindow() {
+    m_prefetchStale = false;
+    if (!textureCaches || imageCatalog.empty()) return;
+
+    const size_t count = imageCatalog.size();
+    const int ahead = std::min(Config::PREFETCH_AHEAD + m_browseStreak, Config::PREFETCH_MAX_AHEAD);
+    const int behind = Config::PREFETCH_BEHIND;
+
+    // 按加载先后收集窗口内的索引：前方优先，后方其次
+    std::vector<size_t> windowIndices;
+    auto addOffset = [&](long long offset) {
+        long long index = static_cast<long long>(currentIndex) + offset;
+        if (imageCycle) {
+            index = ((index % static_cast<long long>(count)) + count) % count;
+        } else if (index < 0 || index >= static_cast<long long>(count)) {
+            return;
+        }
+        size_t i = static_cast<size_t>(index);
+        if (i != currentIndex && std::find(windowIndices.begin(), windowIndices.end(), i) == windowIndices.end()) {
+            windowIndices.push_back(i);
+        }
+    };
+    for (int i = 1; i <= std::max(ahead, behind); i++) {
+        if (i <= ahead) addOffset(static_cast<long long>(i) * m_browseDirection);
+        if (i <= behind) addOffset(-static_cast<long long>(i) * m_browseDirection);
+    }
+
+    DecodeScheduler::getInstance().setFocus(currentIndex, count, imageCycle);
+    textureCaches->setFocus(currentIndex, count, imageCycle);
+
+    // 取消已离开窗口、仍在排队的解码任务
+    for (const auto& path : m_prefetchPaths) {
+        bool stillInWindow = std::any_of(windowIndices.begin(), windowIndices.end(),
+                                         [&](size_t i) { return imageCatalog.path(i) == path; });
+        if (!stillInWindow) {
+            textureCaches->cancelPreload(path);
+        }
+    }
+
+    m_prefetchPaths.clear();
+    std::vector<std::string> exifPaths;
+    std::vector<long long> exifIndices;
+    for (size_t index : windowIndices) {
+        const fs::path path = imageCatalog.path(index);
+        textureCaches->preloadImage(path, static_cast<long long>(index), DecodeScheduler::NEIGHBOR);
+        m_prefetchPaths.push_back(path);
+        exifPaths.push_back(path.generic_string());
+        exifIndices.push_back(static_cast<long long>(index));
+    }
+    // 相邻图片的 EXIF 也提前解析，切换时直接命中缓存
+    ExifCache::getInstance().prefetch(exifPaths, exifIndices);
 }
 
 void VimagApp::createUI() {
@@ -274,7 +728,7 @@ void VimagApp::createImagePanel() {
     rightPanel->setBackgroundColor(Config::BGCOLOR);
     
     // 创建纹理组件
-    std::string imagePath = imagePaths[currentIndex].generic_string();
+    std::string imagePath = imageCatalog.path(currentIndex).generic_string();
     texture = std::make_shared<UITexture>(0, 0, 
         currentWindowWidth * Config::IMAGE_SCALE_RATIO, 
         currentWindowHeight * Config::IMAGE_SCALE_RATIO, 
@@ -376,20 +830,105 @@ void VimagApp::createLabels() {
 }
 
 void VimagApp::handleImageChange(int direction) {
+    auto now = std::chrono::steady_clock::now();
+    bool fastSwitch = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastImageChangeTime).count()
+                      < FAST_SWITCH_THRESHOLD_MS;
+    lastImageChangeTime = now;
+
+    // 记录浏览方向，连续同向浏览时扩大前方预加载窗口
+    int newDirection = direction >= 0 ? 1 : -1;
+    if (newDirection == m_browseDirection) {
+        m_browseStreak++;
+    } else {
+        m_browseDirection = newDirection;
+        m_browseStreak = 0;
+    }
+
     currentIndex += direction;
     
     // 修复参数传递 - enableImageCycle 需要引用参数
-    size_t limitIndex = imagePaths.size();
+    size_t limitIndex = imageCatalog.size();
     // bool imageCycle = true; // 从配置读取
     enableImageCycle(currentIndex, limitIndex, imageCycle);
-    
+    // 按新的当前图片重排排队中的解码任务
+    DecodeScheduler::getInstance().setFocus(currentIndex, limitIndex, imageCycle);
+    textureCaches->setFocus(currentIndex, limitIndex, imageCycle);
+
+    const fs::path path = imageCatalog.path(currentIndex);
+    if (textureCaches->isImageLoaded(path)) {
+        // 已缓存的图片立即显示，之前未完成的请求作废
+        textureCaches->cancelRequests();
+        hasPendingImageLoad = false;
+        updateImageDisplay();
+        updateImageLabels();
+    } else {
+        // 未缓存：后台解码，最新请求优先；连续切换时中间的图片被跳过，解码中途放弃
+        textureCaches->requestImage(path, static_cast<long long>(currentIndex));
+        hasPendingImageLoad = true;
+        pendingImageIndex = currentIndex;
+        pendingImageLoadTime = now;
+    }
+
+    // 快速连续切换时不为每张中间图片重建预加载窗口，停下后再预加载
+    if (fastSwitch) {
+        m_prefetchStale = true;
+    } else {
+        updatePrefetchWindow();
+    }
+
+#ifdef DEBUG
+    TextureCacheStats stats = textureCaches->getStats();
+    std::cout << "[TextureCache] hit rate " << stats.hitRate * 100.0 << "% (" << stats.hits << "/" << stats.hits + stats.misses
+              << "), GPU " << stats.gpuBytesResident / (1024 * 1024) << "/" << stats.gpuBudgetBytes / (1024 * 1024) << " MB"
+              << ", CPU " << stats.cpuBytesPending / (1024 * 1024) << " MB, " << stats.entries << " entries" << std::endl;
+    const TextureUploadStats& upload = textureCaches->getUploadStats();
+    std::cout << "[TextureCache] upload " << upload.pendingUploads << " pending (" << upload.pendingBytes / (1024 * 1024)
+              << " MB), max frame " << upload.maxFrameMs << " ms, total " << upload.totalTextures << " textures" << std::endl;
+    DecodeBufferStats buffers = DecodeBufferPool::getInstance().getStats();
+    std::cout << "[DecodeBufferPool] live " << buffers.liveBytes / (1024 * 1024) << " MB, cached "
+              << buffers.cachedBytes / (1024 * 1024) << " MB, mapped " << buffers.mappedBytes / (1024 * 1024)
+              << " MB, reused " << buffers.poolHits << "/" << buffers.allocations << std::endl;
+    TexturePoolStats pool = textureCaches->getTexturePoolStats();
+    std::cout << "[TextureCache] texture pool hit rate " << pool.hitRate * 100.0 << "% (" << pool.hits << "/"
+              << pool.hits + pool.misses << "), " << pool.idleTextures << " idle, " << pool.idleBytes / (1024 * 1024) << " MB" << std::endl;
+#endif
+}
+
+void VimagApp::processPendingImageLoad() {
+    auto now = std::chrono::steady_clock::now();
+    auto idleMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastImageChangeTime).count();
+    if (m_prefetchStale && !hasPendingImageLoad && idleMs >= FAST_SWITCH_THRESHOLD_MS) {
+        updatePrefetchWindow();
+    }
+
+    if (!hasPendingImageLoad) return;
+    if (pendingImageIndex >= imageCatalog.size() || pendingImageIndex != currentIndex) {
+        hasPendingImageLoad = false;
+        return;
+    }
+    const fs::path path = imageCatalog.path(pendingImageIndex);
+
+    bool loaded = textureCaches->isImageLoaded(path);
+    // 后台解码失败或被丢弃（如超出预算）时，输入停下后同步加载，失败则显示错误图
+    bool giveUp = !loaded && !textureCaches->isImageLoading(path) && idleMs >= DELAYED_LOAD_MS;
+    if (!loaded && !giveUp) return;
+
+    hasPendingImageLoad = false;
     updateImageDisplay();
     updateImageLabels();
+    updatePrefetchWindow();
+
+    auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - pendingImageLoadTime).count();
+    std::cout << "[VimagApp] Displayed " << path.filename() << " after " << waitMs << " ms" << std::endl;
 }
 
 void VimagApp::updateImageDisplay() {
-    std::string imagePath = imagePaths[currentIndex].generic_string();
+    const fs::path path = imageCatalog.path(currentIndex);
+    std::string imagePath = path.generic_string();
+
+    // 已预加载的图片直接命中缓存；未命中时在主线程同步解码到缓存
     texture->setImagePath(window.getNVGContext(), imagePath);
+    m_recordedImagePath.clear();
     
     updateWindowSize();
     updateImageLabels();
@@ -398,8 +937,8 @@ void VimagApp::updateImageDisplay() {
 void VimagApp::updateImageLabels() {
     std::string label_info="";
     std::string indexString = "[" + std::to_string(currentIndex + 1) + "/" + 
-                             std::to_string(imagePaths.size()) + "]";
-    std::string imageName = imageNames[currentIndex];
+                             std::to_string(imageCatalog.size()) + "]";
+    std::string imageName = std::string(imageCatalog.name(currentIndex));
     
     if (texture->isLoadError()) {
         texture -> setImagePath(window.getNVGContext(),"./imageFail.gif");
@@ -412,7 +951,8 @@ void VimagApp::updateImageLabels() {
             label_info = indexString +" ● " + imageName + " ● " + std::to_string(texture->getImageWidth()) + "x" + std::to_string(texture->getImageHeight());
         }
         std::string exif_info;
-        bool ExifInfo_S = getExifInfo(imagePaths[currentIndex].generic_string(), exif_info,textureOrientation);
+        bool ExifInfo_S = getExifInfo(imageCatalog.path(currentIndex).generic_string(), exif_info,textureOrientation);
+        recordImageInfo(ExifInfo_S ? textureOrientation : 0);
         
         if(enableExifOrientation){
             if (ExifInfo_S) {
@@ -449,6 +989,31 @@ void VimagApp::updateImageLabels() {
       
 }
 
+void VimagApp::recordImageInfo(int orientation) {
+    const fs::path path = imageCatalog.path(currentIndex);
+    const std::string imagePath = path.generic_string();
+    // 后台解码期间控件还显示着上一张图片，它的尺寸不能记到当前图片名下
+    if (texture->getImagePath() != imagePath) return;
+    // 每次显示只记录一次，定时刷新标签时不再查询文件状态
+    if (m_recordedImagePath == imagePath) return;
+    m_recordedImagePath = imagePath;
+    std::error_code ec;
+    ImageIndexInfo info;
+    auto time = fs::last_write_time(path, ec);
+    if (ec) return;
+    info.mtime = DirectoryIndex::toTicks(time);
+    info.size = fs::file_size(path, ec);
+    if (ec) return;
+    info.width = texture->getImageWidth();
+    info.height = texture->getImageHeight();
+    info.orientation = orientation;
+    imageCatalog.setMetadata(currentIndex, info);
+    // 扫描期间索引正被后台线程读取或重建，不等待它的锁
+    if (directoryIndex && !m_needsDirectoryScan && m_directoryIndex.isOpen()) {
+        m_directoryIndex.setImageInfo(path, info);
+    }
+}
+
 void VimagApp::updateWindowSize() {
     mainPanel->setSize(currentWindowWidth, currentWindowHeight);
     rightPanel->setSize(currentWindowWidth, currentWindowHeight);
@@ -458,6 +1023,7 @@ void VimagApp::updateWindowSize() {
     
     texture->setSize(newWidth, newHeight);
     texture->setOriginSize(newWidth, newHeight);
+    texture->setViewportSize(currentWindowWidth, currentWindowHeight);
     texture->setPaintValid(false);
     
     rightPanel->updateLayout();
@@ -530,6 +1096,7 @@ void VimagApp::setupEventHandlers() {
         currentWindowWidth = width;
         currentWindowHeight = height;
         updateWindowSize();
+        updateDecodeTarget();
         mainPanel->updateLayout();
     });
     
@@ -695,6 +1262,11 @@ void VimagApp::setupWindowEvents() {
                 handleFullscreenToggle();
                 return;
             }
+            else if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+                // S 切换排序方式，Shift+S 切换升序/降序
+                cycleSortMode((mods & GLFW_MOD_SHIFT) != 0);
+                return;
+            }
             
             // 执行图片切换
             if (direction != 0) {
@@ -763,6 +1335,14 @@ void VimagApp::handleImageScale(float scrollY) {
     
     // 使用更短的动画时间和更平滑的缓动
     UIAnimationManager::getInstance().scaleTo(texture.get(), scaleX, scaleY, 0.1f, UIAnimation::EASE_OUT);
+
+    // 放大后纹理分辨率不足一个缩放步长时，按原始分辨率重新解码
+    if (!texture->isFullResolution()) {
+        float displayedWidth = texture->getDisplayedImageWidth() * scaleX;
+        if (displayedWidth > texture->getTextureWidth() * (1.0f + Config::SCALE_STEP)) {
+            texture->loadFullResolution(window.getNVGContext());
+        }
+    }
     
     // 立即标记需要重绘
     texture->setPaintValid(false);
@@ -800,6 +1380,7 @@ void VimagApp::handleFullscreenToggle() {
     window.toggleFullscreen();
     window.getFramebufferSize(currentWindowWidth, currentWindowHeight);
     updateWindowSize();
+    updateDecodeTarget();
 }
 
 void VimagApp::handleSettingToggle() {
@@ -862,3 +1443,10 @@ std::string VimagApp::getImageInfo() const {
     // 实现获取图像信息逻辑
     return "";
 }
+
+void VimagApp::updateDecodeTarget() {
+    if (!textureCaches) return;
+    // 用窗口长边作为上限，旋转 90° 显示时也不会不够用
+    int maxSide = decodeToDisplay ? std::max(currentWindowWidth, currentWindowHeight) * decodeDisplayMultiple : 0;
+    textureCaches->setDecodeTarget(maxSide);
+}
@@ -5,7 +5,13 @@
 #include "component/UILabel.h"
 #include "component/UITexture.h"
 #include "component/FlexLayout.h"
+#include "component/TextureCacheData.h"
 #include "utils/utils.h"
+#include "utils/DirectoryScanner.h"
+#include "utils/DirectoryIndex.h"
+#include "utils/DirectoryWatcher.h"
+#include "utils/ImageCatalog.h"
+#include "utils/ImageSorter.h"
 #include <nanovg.h>
 #include <memory>
 #include <vector>
@@ -29,6 +35,10 @@ public:
         static constexpr float MAX_SCALE = 13.0f;
         static constexpr float MIN_SCALE = 0.2f;
         static constexpr double TARGET_FPS = 120.0;
+        // 预加载窗口：浏览方向前方/后方保持解码好的图片数量
+        static constexpr int PREFETCH_AHEAD = 2;
+        static constexpr int PREFETCH_BEHIND = 1;
+        static constexpr int PREFETCH_MAX_AHEAD = 6;   // 连续同向浏览时前方窗口最大长度
         static inline const NVGcolor BGCOLOR = nvgRGBA(32, 32, 32, 255);
     };
 
@@ -44,10 +54,10 @@ private:
     std::shared_ptr<UIButton> indexButton;
     std::shared_ptr<UIButton> imageCycleButton;
     std::shared_ptr<UIButton> showExifInfo;
+    std::unique_ptr<TextureCaches> textureCaches;   // 预加载纹理缓存
 
     // 应用状态
-    std::vector<fs::path> imagePaths;
-    std::vector<std::string> imageNames;
+    ImageCatalog imageCatalog;              // 图片列表（路径、文件名、元数据）
     size_t currentIndex = 0;
     int currentWindowWidth, currentWindowHeight;
     
@@ -77,13 +87,48 @@ private:
     // 添加后台扫描相关成员变量
     bool m_needsDirectoryScan = false;
     fs::path m_scanDirectory;
-    std::string m_originalFilePath;
-    std::thread m_scanThread;
+    fs::path m_originalFilePath;                // 启动时先显示的文件，扫描结果中跳过它
+    DirectoryScanner m_scanner;
     std::mutex m_imageDataMutex;
+    std::vector<fs::path> m_scanIncoming;       // 扫描线程交出、尚未并入列表的图片（受 m_imageDataMutex 保护）
+    ImageCatalog m_scanAll;                     // 扫描到的全部图片，扫描结束时排序后替换列表
+    bool m_originalMerged = false;              // 扫描结果中的原始文件已跳过
+    bool m_showFirstScanned = false;            // 启动时只有占位图，扫描完成后显示第一张图片
+    bool m_streamScan = true;                   // 扫描结果是否逐批并入列表
+    std::chrono::steady_clock::time_point m_lastScanLabelUpdate;
+    DirectoryIndex m_directoryIndex;
+    std::thread m_indexThread;                  // 后台读取并校验目录索引
+    std::atomic<bool> m_indexLoadFailed{false}; // 没有可用的索引，需要完整扫描
+    DirectoryWatcher m_watcher;
     std::atomic<bool> m_scanCompleted{false};
 
     int textureOrientation = 0;
 
+    // 预加载窗口状态
+    int m_browseDirection = 1;      // 最近一次浏览方向（1向后，-1向前）
+    int m_browseStreak = 0;         // 连续同向浏览次数，用于扩大前方窗口
+    std::vector<fs::path> m_prefetchPaths;  // 当前窗口内已提交预加载的图片
+    int gpuCacheBudgetMB = 512;             // 纹理缓存显存预算
+    int cpuCacheBudgetMB = 256;             // 待上传像素数据内存预算
+    int uploadBudgetMB = 32;                // 每帧纹理上传字节预算
+    int uploadBudgetMs = 4;                 // 每帧纹理上传时间预算（毫秒）
+    bool pixelBufferUpload = true;          // 解码线程写入像素缓冲区，主线程异步上传
+    int texturePoolSize = 8;                // 按尺寸复用的空闲纹理数量上限
+    int texturePoolMB = 128;                // 空闲纹理显存上限
+    bool mipmaps = true;                    // 解码线程生成缩小层级，缩小显示时不闪烁
+    int decodePoolMB = 256;                 // 解码缓冲池保留的空闲内存上限
+    bool decodeToDisplay = true;            // 按窗口尺寸缩小解码，放大时再加载原图
+    int decodeDisplayMultiple = 1;          // 缩小解码的长边 = 窗口长边 × 倍数
+    bool directoryIndex = true;             // 保存目录扫描结果，再次打开时只检查变化的目录
+    bool directoryWatch = true;             // 监视目录，新增、删除、修改的图片实时反映到列表
+    SortMode sortMode = SortMode::Path;     // 图片列表的排序方式
+    bool sortDescending = false;
+
+    // 后台排序
+    ImageSorter m_sorter;
+    bool m_sortPending = false;             // 列表需要按当前排序方式重新排序
+    std::string m_recordedImagePath;        // 本次显示已写入尺寸信息的图片
+
 public:
     VimagApp();
     ~VimagApp();
@@ -107,6 +152,7 @@ private:
     // 事件处理方法
     void handleImageChange(int direction);
     void updateImageDisplay();
+    void processPendingImageLoad();
     void updateWindowSize();
     void handleFullscreenToggle();
     void handleSettingToggle();
@@ -127,8 +173,33 @@ private:
     void updateImageLabels();
     
     // 添加后台扫描相关方法声明
-    void startBackgroundDirectoryScan();
+    // 目录顶层的第一张图片（按遍历顺序），没有时返回空路径
+    static fs::path findFirstImage(const fs::path& directory);
+    // streamResults 为 false 时（如重新同步完整列表）不逐批并入，只在结束时替换
+    void startBackgroundDirectoryScan(bool streamResults = true);
+    // 遍历整棵目录树（没有可用的索引时）
+    void startFullDirectoryScan();
     void checkBackgroundScanCompletion();
+    // 把扫描线程交出的一批图片追加到列表末尾
+    void mergeScannedImages(std::vector<fs::path>& batch);
+    // 把当前图片的尺寸和旋转写入目录索引
+    void recordImageInfo(int orientation);
+    // 把目录监视报告的增删改应用到图片列表，当前图片保持不变
+    void applyDirectoryChanges();
+    // 在有序的图片列表中插入或删除，返回列表是否变化
+    bool insertImagePath(const fs::path& path);
+    bool removeImagePaths(const fs::path& path, bool directory);
+
+    // 排序
+    bool isPathOrder() const;               // 当前排序方式就是按路径升序（扫描结果的顺序）
+    void startSort();
+    // 取回后台排序的结果并替换列表，当前图片保持不变
+    void checkSortCompletion();
+    void cycleSortMode(bool toggleDescending);
+
+    // 预加载窗口
+    void updatePrefetchWindow();
+    void updateDecodeTarget();
     
 
 
@@ -137,6 +208,7 @@ private:
     std::chrono::steady_clock::time_point pendingImageLoadTime;
     bool hasPendingImageLoad = false;
     size_t pendingImageIndex = 0;
-    static constexpr int FAST_SWITCH_THRESHOLD_MS = 20; // 快速切换阈值（毫秒）
-    static constexpr int DELAYED_LOAD_MS = 50; // 延迟加载时间（毫秒）
+    bool m_prefetchStale = false;   // 快速切换期间跳过了预加载窗口的更新
+    static constexpr int FAST_SWITCH_THRESHOLD_MS = 100; // 快速切换阈值（毫秒），按住方向键的重复间隔约 30~50ms
+    static constexpr int DELAYED_LOAD_MS = 50; // 输入停止后多久放弃等待后台解码、改为同步加载（毫秒）
 };
@@ -0,0 +1,275 @@
+#include "DecodeScheduler.h"
+#include <iostream>
+#include <algorithm>
+
+DecodeScheduler& DecodeScheduler::getInstance() {
+    static DecodeScheduler instance;
+    return instance;
+}
+
+DecodeScheduler::~DecodeScheduler() {
+    shutdown();
+}
+
+void DecodeScheduler::start(unsigned threadCount) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_workers.empty()) return;
+
+    if (threadCount == 0) {
+        // 解码很吃内存带宽和内存，线程数不宜过多
+        unsigned hw = std::thread::hardware_concurrency();
+        threadCount = std::clamp(hw > 1 ? hw - 1 : 1u, 1u, 4u);
+    }
+
+    m_stop = false;
+    for (unsigned i = 0; i < threadCount; i++) {
+        m_workers.emplace_back(&DecodeScheduler::workerThreadFunc, this);
+    }
+    std::cout << "[DecodeScheduler] Started " << threadCount << " decode threads" << std::endl;
+}
+
+void DecodeScheduler::ensureStarted() {
+    bool started;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        started = !m_workers.empty();
+    }
+    if (!started) start();
+}
+
+void DecodeScheduler::shutdown() {
+    std::vector<std::thread> workers;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_workers.empty()) return;
+        m_stop = true;
+        // 排队中的任务直接丢弃，运行中的任务通知尽快退出
+        m_queue.clear();
+        for (auto& running : m_running) {
+            running.token->store(true);
+        }
+        workers = std::move(m_workers);
+        m_workers.clear();
+    }
+    m_queueCondition.notify_all();
+
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    m_idleCondition.notify_all();
+}
+
+unsigned DecodeScheduler::getThreadCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<unsigned>(m_workers.size());
+}
+
+void DecodeScheduler::classify(Job& job) const {
+    if (job.index < 0 || m_focusCount == 0) {
+        job.distance = 0;
+        return;
+    }
+
+    size_t index = static_cast<size_t>(job.index);
+    size_t distance = index > m_focusIndex ? index - m_focusIndex : m_focusIndex - index;
+    // 循环浏览时首尾相邻
+    if (m_focusCycle && distance < m_focusCount) {
+        distance = std::min(distance, m_focusCount - distance);
+    }
+    job.distance = distance;
+
+    if (distance == 0) {
+        job.priority = VISIBLE;
+    } else if (distance <= m_neighborRadius) {
+        job.priority = NEIGHBOR;
+    } else {
+        job.priority = PREFETCH;
+    }
+}
+
+DecodeScheduler::JobId DecodeScheduler::submit(const void* owner, const std::string& key, long long index,
+                                               Priority priority, JobFunc func, CancelFunc onCancel) {
+    ensureStarted();
+
+    JobId id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Job job;
+        job.id = id = m_nextId++;
+        job.owner = owner;
+        job.key = key;
+        job.index = index;
+        job.priority = priority;
+        job.seq = m_nextSeq++;
+        job.token = std::make_shared<std::atomic<bool>>(false);
+        job.func = std::move(func);
+        job.onCancel = std::move(onCancel);
+        classify(job);
+
+        m_queue.push_back(std::move(job));
+        std::push_heap(m_queue.begin(), m_queue.end(), JobCompare());
+    }
+    m_queueCondition.notify_one();
+    return id;
+}
+
+std::vector<DecodeScheduler::Job> DecodeScheduler::extractIf(const std::function<bool(const Job&)>& pred) {
+    // 调用方需持有 m_mutex
+    std::vector<Job> removed;
+    auto it = std::stable_partition(m_queue.begin(), m_queue.end(),
+                                    [&pred](const Job& job) { return !pred(job); });
+    if (it == m_queue.end()) return removed;
+
+    std::move(it, m_queue.end(), std::back_inserter(removed));
+    m_queue.erase(it, m_queue.end());
+    std::make_heap(m_queue.begin(), m_queue.end(), JobCompare());
+    return removed;
+}
+
+bool DecodeScheduler::cancel(JobId id) {
+    std::vector<Job> removed;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        removed = extractIf([id](const Job& job) { return job.id == id; });
+        found = !removed.empty();
+        for (auto& running : m_running) {
+            if (running.id == id) {
+                running.token->store(true);
+                found = true;
+            }
+        }
+    }
+    // 回调在锁外执行，避免回调中再次提交任务时死锁
+    for (auto& job : removed) {
+        if (job.onCancel) job.onCancel();
+    }
+    return found;
+}
+
+size_t DecodeScheduler::cancelKey(const void* owner, const std::string& key) {
+    std::vector<Job> removed;
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        removed = extractIf([owner, &key](const Job& job) { return job.owner == owner && job.key == key; });
+        count = removed.size();
+        for (auto& running : m_running) {
+            if (running.owner == owner && running.key == key) {
+                running.token->store(true);
+                count++;
+            }
+        }
+    }
+    for (auto& job : removed) {
+        if (job.onCancel) job.onCancel();
+    }
+    return count;
+}
+
+size_t DecodeScheduler::cancelOwner(const void* owner, bool waitRunning) {
+    std::vector<Job> removed;
+    size_t count = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        removed = extractIf([owner](const Job& job) { return job.owner == owner; });
+        count = removed.size();
+        for (auto& running : m_running) {
+            if (running.owner == owner) {
+                running.token->store(true);
+                count++;
+            }
+        }
+    }
+    for (auto& job : removed) {
+        if (job.onCancel) job.onCancel();
+    }
+
+    if (waitRunning) {
+        // 等待该 owner 的运行中任务全部结束，之后 owner 可以安全析构
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_idleCondition.wait(lock, [this, owner] {
+            return std::none_of(m_running.begin(), m_running.end(),
+                                [owner](const RunningJob& running) { return running.owner == owner; });
+        });
+    }
+    return count;
+}
+
+void DecodeScheduler::setFocus(size_t currentIndex, size_t count, bool cycle) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_focusIndex == currentIndex && m_focusCount == count && m_focusCycle == cycle) return;
+
+    m_focusIndex = currentIndex;
+    m_focusCount = count;
+    m_focusCycle = cycle;
+
+    bool changed = false;
+    for (auto& job : m_queue) {
+        if (job.index < 0) continue;
+        classify(job);
+        changed = true;
+    }
+    if (changed) {
+        std::make_heap(m_queue.begin(), m_queue.end(), JobCompare());
+    }
+}
+
+void DecodeScheduler::setNeighborRadius(size_t radius) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_neighborRadius = radius;
+    for (auto& job : m_queue) {
+        if (job.index >= 0) classify(job);
+    }
+    std::make_heap(m_queue.begin(), m_queue.end(), JobCompare());
+}
+
+bool DecodeScheduler::isPending(const void* owner, const std::string& key) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto match = [owner, &key](const auto& job) { return job.owner == owner && job.key == key; };
+    return std::any_of(m_queue.begin(), m_queue.end(), match) ||
+           std::any_of(m_running.begin(), m_running.end(), match);
+}
+
+size_t DecodeScheduler::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_queue.size() + m_running.size();
+}
+
+void DecodeScheduler::workerThreadFunc() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_queueCondition.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+            if (m_stop) break;
+
+            std::pop_heap(m_queue.begin(), m_queue.end(), JobCompare());
+            job = std::move(m_queue.back());
+            m_queue.pop_back();
+            m_running.push_back(RunningJob{job.id, job.owner, job.key, job.token});
+        }
+
+        try {
+            if (job.token->load()) {
+                if (job.onCancel) job.onCancel();
+            } else {
+                job.func(job.token);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "[DecodeScheduler] Exception in decode job " << job.key << ": " << e.what() << std::endl;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = std::find_if(m_running.begin(), m_running.end(),
+                                   [&job](const RunningJob& running) { return running.id == job.id; });
+            if (it != m_running.end()) {
+                m_running.erase(it);
+            }
+        }
+        m_idleCondition.notify_all();
+    }
+}
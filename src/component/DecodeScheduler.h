@@ -0,0 +1,126 @@
+#pragma once
+
+#include <string>
+#include <functional>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+/**
+ * @class DecodeScheduler
+ * @brief 固定大小的解码线程池
+ * @description 所有图像解码任务共用一个调度器，按三个优先级执行：
+ *              当前显示的图片 > 相邻图片 > 后台预读。
+ *              排队中的任务可以取消，也会在当前索引变化时重新排序。
+ */
+class DecodeScheduler {
+public:
+    // 优先级，数值越小越先执行
+    enum Priority {
+        VISIBLE = 0,    // 当前显示的图片
+        NEIGHBOR = 1,   // 相邻图片
+        PREFETCH = 2    // 后台预读
+    };
+
+    using JobId = uint64_t;
+    using CancelToken = std::shared_ptr<std::atomic<bool>>;
+    // 任务函数：耗时步骤之间应检查 token，被取消时尽快返回
+    using JobFunc = std::function<void(const CancelToken& token)>;
+    using CancelFunc = std::function<void()>;
+
+    // 禁止拷贝和赋值
+    DecodeScheduler(const DecodeScheduler&) = delete;
+    DecodeScheduler& operator=(const DecodeScheduler&) = delete;
+
+    // 单例模式
+    static DecodeScheduler& getInstance();
+
+    // 线程管理（首次提交任务时自动启动）
+    void start(unsigned threadCount = 0);
+    void shutdown();
+    unsigned getThreadCount() const;
+
+    /**
+     * @brief 提交解码任务
+     * @param owner 任务归属（用于批量取消），通常为缓存对象指针
+     * @param key 任务键（图片路径）
+     * @param index 图片在列表中的索引，<0 表示不参与按索引重排
+     * @param priority 初始优先级；带索引的任务会在 setFocus 时重新计算
+     * @param func 在工作线程执行的任务
+     * @param onCancel 任务在执行前被取消时调用（可能在任意线程）
+     */
+    JobId submit(const void* owner, const std::string& key, long long index,
+                 Priority priority, JobFunc func, CancelFunc onCancel = nullptr);
+
+    // 取消任务：排队中的直接移除，运行中的设置取消标记
+    bool cancel(JobId id);
+    size_t cancelKey(const void* owner, const std::string& key);
+    size_t cancelOwner(const void* owner, bool waitRunning = false);
+
+    // 当前索引变化时调用，按与当前图片的距离重排排队中的任务
+    void setFocus(size_t currentIndex, size_t count, bool cycle);
+    void setNeighborRadius(size_t radius);
+
+    bool isPending(const void* owner, const std::string& key) const;
+    size_t getPendingCount() const;
+
+    ~DecodeScheduler();
+
+private:
+    DecodeScheduler() = default;
+
+    struct Job {
+        JobId id = 0;
+        const void* owner = nullptr;
+        std::string key;
+        long long index = -1;
+        Priority priority = PREFETCH;
+        size_t distance = 0;
+        uint64_t seq = 0;
+        CancelToken token;
+        JobFunc func;
+        CancelFunc onCancel;
+    };
+
+    struct RunningJob {
+        JobId id;
+        const void* owner;
+        std::string key;
+        CancelToken token;
+    };
+
+    // 堆比较：优先级高、距离近、提交早的任务排在堆顶
+    struct JobCompare {
+        bool operator()(const Job& a, const Job& b) const {
+            if (a.priority != b.priority) return a.priority > b.priority;
+            if (a.distance != b.distance) return a.distance > b.distance;
+            return a.seq > b.seq;
+        }
+    };
+
+    void workerThreadFunc();
+    void ensureStarted();
+    void classify(Job& job) const;
+    std::vector<Job> extractIf(const std::function<bool(const Job&)>& pred);
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_queueCondition;
+    std::condition_variable m_idleCondition;
+    std::vector<Job> m_queue;           // 二叉堆
+    std::vector<RunningJob> m_running;
+    std::vector<std::thread> m_workers;
+    bool m_stop = false;
+
+    JobId m_nextId = 1;
+    uint64_t m_nextSeq = 0;
+
+    // 当前焦点
+    size_t m_focusIndex = 0;
+    size_t m_focusCount = 0;
+    bool m_focusCycle = false;
+    size_t m_neighborRadius = 2;
+};
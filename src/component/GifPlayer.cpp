@@ -0,0 +1,198 @@
+#include "GifPlayer.h"
+#include "DecodeScheduler.h"
+#include "TextureCacheData.h"
+#include <iostream>
+#include <algorithm>
+
+GifPlayer::GifPlayer(NVGcontext* vg, const std::string& path) : m_vg(vg), m_path(path) {
+}
+
+GifPlayer::~GifPlayer() {
+    // 等待正在运行的解码任务结束，之后才能释放解码器和缓冲区
+    DecodeScheduler::getInstance().cancelOwner(this, true);
+
+    if (m_texture != -1) {
+        nvgDeleteImage(m_vg, m_texture);
+        m_texture = -1;
+    }
+}
+
+void GifPlayer::start() {
+    // 打开文件要读取整个 GIF，放到解码任务中完成，不阻塞主线程
+    requestDecode();
+}
+
+int GifPlayer::getFrameCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_frameCount;
+}
+
+std::vector<int> GifPlayer::getDelays() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_delays;
+}
+
+int GifPlayer::normalizeDelay(int delay) {
+    // 0 或 10 毫秒的帧延迟在浏览器中按 100 毫秒播放，保持一致
+    return delay < MIN_FRAME_DELAY ? DEFAULT_FRAME_DELAY : delay;
+}
+
+void GifPlayer::requestDecode() {
+    if (m_failed.load(std::memory_order_acquire) || m_static.load(std::memory_order_acquire)) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_decoding || m_ready.size() >= DECODE_AHEAD) return;
+        m_decoding = true;
+    }
+
+    DecodeScheduler::getInstance().submit(this, m_path, -1, DecodeScheduler::VISIBLE,
+        [this](const DecodeScheduler::CancelToken& token) {
+            decodeAhead(*token);
+        },
+        [this]() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoding = false;
+        });
+}
+
+void GifPlayer::decodeAhead(const std::atomic<bool>& cancelled) {
+    if (!m_decoder.isOpen()) {
+        if (cancelled.load()) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoding = false;
+            return;
+        }
+        if (!m_decoder.open(m_path)) {
+            m_failed.store(true, std::memory_order_release);
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_decoding = false;
+            return;
+        }
+        m_width.store(m_decoder.getWidth(), std::memory_order_release);
+        m_height.store(m_decoder.getHeight(), std::memory_order_release);
+    }
+    const int width = m_width.load(std::memory_order_relaxed);
+    const int height = m_height.load(std::memory_order_relaxed);
+    const size_t frameBytes = static_cast<size_t>(width) * height * 4;
+
+    while (!cancelled.load()) {
+        std::vector<unsigned char> buffer;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_ready.size() >= DECODE_AHEAD) break;
+            if (!m_spare.empty()) {
+                buffer.swap(m_spare.back());
+                m_spare.pop_back();
+            }
+        }
+        buffer.resize(frameBytes);
+
+        int delay = 0;
+        int index = m_decoder.getFrameIndex();
+        if (!m_decoder.nextFrame(buffer.data(), delay)) {
+            int decoded = m_decoder.getFrameIndex();
+            if (decoded == 0) {
+                std::cerr << "[GifPlayer] No frames decoded: " << m_path << std::endl;
+                m_failed.store(true, std::memory_order_release);
+                break;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (m_frameCount == 0) m_frameCount = decoded;
+                m_spare.push_back(std::move(buffer));
+            }
+            if (decoded == 1) {
+                // 只有一帧，已入队的第一帧就是全部内容
+                m_static.store(true, std::memory_order_release);
+                break;
+            }
+            // 循环播放：回到第一帧继续解码
+            if (!m_decoder.rewind()) {
+                m_failed.store(true, std::memory_order_release);
+                break;
+            }
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_frameCount == 0 && index == static_cast<int>(m_delays.size())) {
+            m_delays.push_back(delay);
+        }
+        Frame frame;
+        frame.pixels = std::move(buffer);
+        frame.delay = delay;
+        frame.index = index;
+        m_decoder.getDirtyRect(frame.dirtyX, frame.dirtyY, frame.dirtyWidth, frame.dirtyHeight);
+        m_ready.push_back(std::move(frame));
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_decoding = false;
+}
+
+bool GifPlayer::uploadFrame(const Frame& frame) {
+    const int width = getWidth();
+    const int height = getHeight();
+    if (m_texture == -1) {
+        m_texture = nvgCreateImageRGBA(m_vg, width, height, 0, frame.pixels.data());
+        if (m_texture == -1) {
+            std::cerr << "[GifPlayer] Failed to create frame texture: " << m_path << std::endl;
+            m_failed.store(true, std::memory_order_release);
+            return false;
+        }
+        m_uploadedPixels += static_cast<uint64_t>(width) * height;
+        return true;
+    }
+
+    if (frame.dirtyWidth <= 0 || frame.dirtyHeight <= 0) return true;   // 画面没有变化
+
+    if (TextureCaches::updateTextureRegion(m_vg, m_texture, frame.dirtyX, frame.dirtyY,
+                                           frame.dirtyWidth, frame.dirtyHeight, frame.pixels.data())) {
+        m_uploadedPixels += static_cast<uint64_t>(frame.dirtyWidth) * frame.dirtyHeight;
+    } else {
+        nvgUpdateImage(m_vg, m_texture, frame.pixels.data());
+        m_uploadedPixels += static_cast<uint64_t>(width) * height;
+    }
+    return true;
+}
+
+bool GifPlayer::advance(double deltaMs) {
+    m_accumulator += deltaMs;
+    if (m_hasFrame && m_accumulator < m_currentDelay) return false;
+
+    Frame frame;
+    bool hasFrame = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_ready.empty()) {
+            frame = std::move(m_ready.front());
+            m_ready.pop_front();
+            hasFrame = true;
+        }
+    }
+
+    if (!hasFrame) {
+        // 解码跟不上时停在当前帧，不累积欠下的时间
+        if (m_hasFrame) {
+            m_accumulator = std::min(m_accumulator, static_cast<double>(m_currentDelay));
+        }
+        requestDecode();
+        return false;
+    }
+
+    if (!uploadFrame(frame)) return false;
+
+    m_accumulator = m_hasFrame ? m_accumulator - m_currentDelay : 0.0;
+    m_hasFrame = true;
+    m_currentFrame = frame.index;
+    m_currentDelay = normalizeDelay(frame.delay);
+    // 长时间停顿（如窗口最小化）后不追帧
+    if (m_accumulator > m_currentDelay) m_accumulator = 0.0;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_spare.push_back(std::move(frame.pixels));
+    }
+    requestDecode();
+    return true;
+}
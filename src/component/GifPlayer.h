@@ -0,0 +1,101 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "nanovg.h"
+#include "../utils/utils.h"
+
+/**
+ * @class GifPlayer
+ * @brief GIF 流式播放器
+ * @description 不再一次性解码全部帧：
+ *              - 工作线程按需解码，预解码的帧放在固定大小的环形缓冲区中
+ *              - 主线程按帧延迟取出下一帧，只把变化的矩形区域更新到同一张纹理上
+ *              - 内存和显存只与分辨率有关，与帧数无关；上传量与画面变化面积成正比
+ */
+class GifPlayer {
+public:
+    static constexpr size_t DECODE_AHEAD = 4;    // 预解码的帧数（内存中）
+    static constexpr int MIN_FRAME_DELAY = 20;   // 延迟过小的帧按浏览器惯例处理
+    static constexpr int DEFAULT_FRAME_DELAY = 100;
+
+    GifPlayer(NVGcontext* vg, const std::string& path);
+    ~GifPlayer();
+
+    // 禁止拷贝和赋值
+    GifPlayer(const GifPlayer&) = delete;
+    GifPlayer& operator=(const GifPlayer&) = delete;
+
+    // 开始后台解码；文件头在第一个解码任务中读取，失败时 isFailed 返回 true
+    void start();
+
+    /**
+     * @brief 推进播放时间
+     * @param deltaMs 距上次调用经过的毫秒数
+     * @return 显示的帧发生变化时返回 true
+     */
+    bool advance(double deltaMs);
+
+    // 当前帧的纹理，第一帧解码完成前为 -1（调用方显示封面）
+    int getImage() const { return m_hasFrame ? m_texture : -1; }
+    // 文件头读取之前为 0
+    int getWidth() const { return m_width.load(std::memory_order_acquire); }
+    int getHeight() const { return m_height.load(std::memory_order_acquire); }
+    int getCurrentFrame() const { return m_currentFrame; }
+    // 完整解码一遍之后才知道帧数，之前返回 0
+    int getFrameCount() const;
+    // 已解码帧的延迟（毫秒），完整解码一遍后包含全部帧
+    std::vector<int> getDelays() const;
+    bool isFailed() const { return m_failed.load(std::memory_order_acquire); }
+    // 只有一帧的 GIF 不需要继续播放
+    bool isStatic() const { return m_static.load(std::memory_order_acquire); }
+    // 累计上传的像素数，用于观察局部更新的效果
+    uint64_t getUploadedPixels() const { return m_uploadedPixels; }
+
+private:
+    struct Frame {
+        std::vector<unsigned char> pixels;   // RGBA 画布
+        int delay = 0;
+        int index = 0;
+        // 相对前一帧变化的区域，帧按顺序显示时只需上传这一部分
+        int dirtyX = 0;
+        int dirtyY = 0;
+        int dirtyWidth = 0;
+        int dirtyHeight = 0;
+    };
+
+    void requestDecode();
+    void decodeAhead(const std::atomic<bool>& cancelled);
+    bool uploadFrame(const Frame& frame);
+    static int normalizeDelay(int delay);
+
+    NVGcontext* m_vg;
+    std::string m_path;
+    std::atomic<int> m_width{0};
+    std::atomic<int> m_height{0};
+
+    // 解码器只在工作线程中使用（同一时间最多一个任务），包括打开文件和读取文件头
+    GifDecoder m_decoder;
+
+    // 以下成员由 m_mutex 保护
+    mutable std::mutex m_mutex;
+    std::deque<Frame> m_ready;                        // 已解码、等待显示的帧
+    std::vector<std::vector<unsigned char>> m_spare;  // 可复用的帧缓冲区
+    bool m_decoding = false;
+    int m_frameCount = 0;
+    std::vector<int> m_delays;
+
+    std::atomic<bool> m_failed{false};
+    std::atomic<bool> m_static{false};
+
+    // 仅主线程访问
+    int m_texture = -1;
+    bool m_hasFrame = false;
+    uint64_t m_uploadedPixels = 0;
+    int m_currentFrame = 0;
+    double m_accumulator = 0.0;
+    int m_currentDelay = 0;
+};
@@ -0,0 +1,304 @@
+#include "PixelUploadRing.h"
+#define NANOVG_GL3
+#include "nanovg_gl.h"
+#include <iostream>
+#include <algorithm>
+
+namespace {
+
+// nanovg 缓存了当前绑定的纹理，上传后必须恢复原来的绑定，否则它会跳过下一次绑定
+class TextureBindingGuard {
+public:
+    TextureBindingGuard() {
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, &m_texture);
+    }
+    ~TextureBindingGuard() {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(m_texture));
+    }
+
+private:
+    GLint m_texture = 0;
+};
+
+size_t roundUpBytes(size_t bytes) {
+    const size_t step = 4ull * 1024 * 1024;
+    return (bytes + step - 1) / step * step;
+}
+
+} // namespace
+
+PixelUploadRing::PixelUploadRing(NVGcontext* vg, int slotCount, size_t slotBytes)
+    : m_vg(vg), m_slotCount(std::max(slotCount, 1)), m_slotBytes(std::max<size_t>(slotBytes, 1)) {
+}
+
+PixelUploadRing::~PixelUploadRing() {
+    shutdown();
+}
+
+bool PixelUploadRing::initialize() {
+    if (m_ready) return true;
+    // 映射缓冲区需要 GL 3.0，栅栏需要 GL 3.2（或对应扩展）
+    if (!glMapBufferRange || !glUnmapBuffer || !glFenceSync || !glClientWaitSync || !glDeleteSync) {
+        std::cerr << "[PixelUploadRing] Buffer mapping or sync objects not supported, using direct uploads" << std::endl;
+        return false;
+    }
+
+    bool created = true;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.resize(static_cast<size_t>(m_slotCount));
+        for (auto& buffer : m_buffers) {
+            glGenBuffers(1, &buffer.pbo);
+            buffer.capacity = m_slotBytes;
+            if (!buffer.pbo || !mapBuffer(buffer)) {
+                created = false;
+                break;
+            }
+            m_stats.stagingBytes += buffer.capacity;
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_ready = true;
+    }
+    if (!created) {
+        std::cerr << "[PixelUploadRing] Failed to create pixel buffer" << std::endl;
+        shutdown();   // 释放已创建的缓冲区
+        return false;
+    }
+    std::cout << "[PixelUploadRing] " << m_slotCount << " pixel buffers, "
+              << m_slotBytes / (1024 * 1024) << " MB each" << std::endl;
+    return true;
+}
+
+void PixelUploadRing::shutdown() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ready) return;
+    for (auto& buffer : m_buffers) {
+        if (buffer.fence) {
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+        }
+        if (buffer.mapped) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            buffer.mapped = nullptr;
+        }
+        if (buffer.pbo) {
+            glDeleteBuffers(1, &buffer.pbo);
+            buffer.pbo = 0;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    m_buffers.clear();
+    m_stats.stagingBytes = 0;
+    m_ready = false;
+}
+
+bool PixelUploadRing::mapBuffer(Buffer& buffer) {
+    // 缓冲区已由栅栏确认空闲，无需驱动再做同步；INVALIDATE 表示旧内容可以丢弃
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+    GLint size = 0;
+    glGetBufferParameteriv(GL_PIXEL_UNPACK_BUFFER, GL_BUFFER_SIZE, &size);
+    if (static_cast<size_t>(size) != buffer.capacity) {
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(buffer.capacity), nullptr, GL_STREAM_DRAW);
+    }
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(buffer.capacity),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (!mapped) {
+        buffer.state = SlotState::Unmapped;
+        return false;
+    }
+    buffer.mapped = static_cast<unsigned char*>(mapped);
+    buffer.state = SlotState::Free;
+    return true;
+}
+
+bool PixelUploadRing::acquire(size_t bytes, Slot& slot) {
+    slot = Slot();
+    if (bytes == 0 || bytes > MAX_SLOT_BYTES) return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ready) return false;
+    // 选择能容纳数据的最小空闲缓冲区，大缓冲区留给大图
+    Buffer* best = nullptr;
+    int bestIndex = -1;
+    for (size_t i = 0; i < m_buffers.size(); ++i) {
+        Buffer& buffer = m_buffers[i];
+        if (buffer.state != SlotState::Free || buffer.capacity < bytes) continue;
+        if (!best || buffer.capacity < best->capacity) {
+            best = &buffer;
+            bestIndex = static_cast<int>(i);
+        }
+    }
+    if (!best) {
+        m_stats.misses++;
+        size_t wanted = m_wantedBytes.load();
+        while (bytes > wanted && !m_wantedBytes.compare_exchange_weak(wanted, bytes)) {
+        }
+        return false;
+    }
+
+    best->state = SlotState::Acquired;
+    slot.index = bestIndex;
+    slot.data = best->mapped;
+    slot.capacity = best->capacity;
+    m_stats.acquired++;
+    return true;
+}
+
+void PixelUploadRing::release(Slot& slot) {
+    if (slot.index < 0) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (slot.index < static_cast<int>(m_buffers.size())) {
+        Buffer& buffer = m_buffers[static_cast<size_t>(slot.index)];
+        if (buffer.state == SlotState::Acquired) {
+            buffer.state = SlotState::Free;
+        }
+    }
+    slot = Slot();
+}
+
+bool PixelUploadRing::unmapForUpload(Buffer& buffer) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.pbo);
+    GLboolean intact = glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    buffer.mapped = nullptr;
+    if (intact == GL_FALSE) {
+        // 映射期间显存内容丢失（如模式切换），数据不可用
+        std::cerr << "[PixelUploadRing] Pixel buffer contents lost" << std::endl;
+        buffer.state = SlotState::Unmapped;
+        return false;
+    }
+    return true;
+}
+
+void PixelUploadRing::finishUpload(Buffer& buffer, size_t bytes) {
+    buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    buffer.state = SlotState::InFlight;
+    m_stats.uploads++;
+    m_stats.uploadedBytes += bytes;
+}
+
+int PixelUploadRing::createImage(Slot& slot, int width, int height, int imageFlags) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ready || slot.index < 0 || slot.index >= static_cast<int>(m_buffers.size())) return -1;
+    Buffer& buffer = m_buffers[static_cast<size_t>(slot.index)];
+    slot = Slot();
+    if (buffer.state != SlotState::Acquired) return -1;
+
+    const size_t bytes = static_cast<size_t>(width) * height * 4;
+    TextureBindingGuard guard;
+    if (width <= 0 || height <= 0 || bytes > buffer.capacity) {
+        unmapForUpload(buffer);
+        buffer.state = SlotState::Unmapped;
+        return -1;
+    }
+    if (!unmapForUpload(buffer)) return -1;
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    // 绑定了 GL_PIXEL_UNPACK_BUFFER 时最后一个参数是缓冲区内的偏移，调用立即返回
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    // 与 nanovg 创建纹理时的采样参数保持一致
+    const bool nearest = (imageFlags & NVG_IMAGE_NEAREST) != 0;
+    if (imageFlags & NVG_IMAGE_GENERATE_MIPMAPS) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, nearest ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR);
+        glGenerateMipmap(GL_TEXTURE_2D);
+    } else {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, nearest ? GL_NEAREST : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, (imageFlags & NVG_IMAGE_REPEATX) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, (imageFlags & NVG_IMAGE_REPEATY) ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+
+    finishUpload(buffer, bytes);
+
+    // 纹理交给 nanovg 管理，nvgDeleteImage 时一并删除
+    int image = nvglCreateImageFromHandleGL3(m_vg, texture, width, height, imageFlags & ~NVG_IMAGE_NODELETE);
+    if (image <= 0) {
+        glDeleteTextures(1, &texture);
+        return -1;
+    }
+    return image;
+}
+
+bool PixelUploadRing::updateImage(int image, Slot& slot, int x, int y, int width, int height) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ready || slot.index < 0 || slot.index >= static_cast<int>(m_buffers.size())) return false;
+    Buffer& buffer = m_buffers[static_cast<size_t>(slot.index)];
+    slot = Slot();
+    if (buffer.state != SlotState::Acquired) return false;
+
+    const size_t bytes = static_cast<size_t>(width) * height * 4;
+    GLuint texture = nvglImageHandleGL3(m_vg, image);
+    TextureBindingGuard guard;
+    if (!texture || width <= 0 || height <= 0 || bytes > buffer.capacity) {
+        unmapForUpload(buffer);
+        buffer.state = SlotState::Unmapped;
+        return false;
+    }
+    if (!unmapForUpload(buffer)) return false;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    finishUpload(buffer, bytes);
+    return true;
+}
+
+void PixelUploadRing::pump() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_ready) return;
+
+    // 有请求因容量不足失败时，把回收的最小缓冲区扩大到该大小
+    size_t wanted = m_wantedBytes.exchange(0);
+    for (auto& buffer : m_buffers) {
+        if (buffer.state == SlotState::InFlight) {
+            GLenum status = glClientWaitSync(buffer.fence, 0, 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                m_stats.fenceWaits++;
+                continue;
+            }
+            glDeleteSync(buffer.fence);
+            buffer.fence = nullptr;
+            buffer.state = SlotState::Unmapped;
+        }
+    }
+
+    if (wanted > 0) {
+        Buffer* smallest = nullptr;
+        for (auto& buffer : m_buffers) {
+            if (buffer.state != SlotState::Unmapped && buffer.state != SlotState::Free) continue;
+            if (buffer.capacity >= wanted) {
+                smallest = nullptr;   // 已有足够大的空闲缓冲区
+                break;
+            }
+            if (!smallest || buffer.capacity < smallest->capacity) smallest = &buffer;
+        }
+        if (smallest) {
+            if (smallest->mapped) {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, smallest->pbo);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                smallest->mapped = nullptr;
+            }
+            m_stats.stagingBytes -= smallest->capacity;
+            smallest->capacity = std::min(roundUpBytes(wanted), MAX_SLOT_BYTES);
+            m_stats.stagingBytes += smallest->capacity;
+            smallest->state = SlotState::Unmapped;
+        }
+    }
+
+    for (auto& buffer : m_buffers) {
+        if (buffer.state == SlotState::Unmapped && !mapBuffer(buffer)) {
+            std::cerr << "[PixelUploadRing] Failed to map pixel buffer" << std::endl;
+        }
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+PixelUploadStats PixelUploadRing::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
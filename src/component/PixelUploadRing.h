@@ -0,0 +1,117 @@
+#pragma once
+#include <GL/glew.h>
+#include "nanovg.h"
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// 像素缓冲区上传统计
+struct PixelUploadStats {
+    uint64_t acquired = 0;        // 工作线程取得暂存块的次数
+    uint64_t misses = 0;          // 没有可用暂存块、退回普通上传的次数
+    uint64_t uploads = 0;         // 从暂存块发起的纹理上传次数
+    uint64_t uploadedBytes = 0;
+    uint64_t fenceWaits = 0;      // 回收时 GPU 尚未读完的次数
+    size_t stagingBytes = 0;      // 所有暂存缓冲区的容量之和
+};
+
+/**
+ * @class PixelUploadRing
+ * @brief 基于像素缓冲区对象（PBO）的异步纹理上传
+ * @description 一组可重复使用的 GL_PIXEL_UNPACK_BUFFER 轮流使用：
+ *              主线程预先映射空闲缓冲区，工作线程通过 acquire 直接把像素写入映射内存；
+ *              主线程的 createImage / updateImage 只解除映射并发出 glTexImage2D / glTexSubImage2D
+ *              （数据来自缓冲区，驱动异步复制），随后插入栅栏；pump 在 GPU 读完后重新映射缓冲区。
+ *              创建的纹理通过 nvglCreateImageFromHandleGL3 交给 nanovg，用 nvgDeleteImage 释放。
+ *
+ * 线程：acquire / release 可在任意线程调用，其余函数只能在 GL 上下文所在的主线程调用。
+ */
+class PixelUploadRing {
+public:
+    // 工作线程持有的暂存块
+    struct Slot {
+        int index = -1;
+        unsigned char* data = nullptr;   // 映射的暂存内存，只写
+        size_t capacity = 0;
+
+        bool valid() const { return index >= 0 && data != nullptr; }
+    };
+
+    static constexpr int DEFAULT_SLOT_COUNT = 4;
+    static constexpr size_t DEFAULT_SLOT_BYTES = 16ull * 1024 * 1024;
+    static constexpr size_t MAX_SLOT_BYTES = 256ull * 1024 * 1024;
+
+    PixelUploadRing(NVGcontext* vg, int slotCount = DEFAULT_SLOT_COUNT, size_t slotBytes = DEFAULT_SLOT_BYTES);
+    ~PixelUploadRing();
+
+    PixelUploadRing(const PixelUploadRing&) = delete;
+    PixelUploadRing& operator=(const PixelUploadRing&) = delete;
+
+    /**
+     * @brief 创建并映射缓冲区
+     * @return 上下文不支持映射缓冲区或栅栏时返回 false，调用方继续使用 nvgCreateImageRGBA
+     */
+    bool initialize();
+    void shutdown();
+    bool isReady() const { return m_ready; }
+
+    /**
+     * @brief 取得至少 bytes 字节的暂存内存（任意线程）
+     * @return 没有空闲缓冲区或容量不足时返回 false；容量不足会让 pump 在下次回收时扩容
+     */
+    bool acquire(size_t bytes, Slot& slot);
+    // 归还未提交的暂存块（任意线程）
+    void release(Slot& slot);
+
+    /**
+     * @brief 用暂存块中的 RGBA 像素创建 nanovg 图像（主线程）
+     * @param slot 数据按 width*4 行宽紧密排列；调用后 slot 失效
+     * @param imageFlags NVGimageFlags，支持 NVG_IMAGE_GENERATE_MIPMAPS / NVG_IMAGE_REPEATX/Y / NVG_IMAGE_NEAREST
+     * @return nanovg 图像句柄，失败返回 -1（暂存块仍会被回收）
+     */
+    int createImage(Slot& slot, int width, int height, int imageFlags = 0);
+
+    /**
+     * @brief 用暂存块更新已有 RGBA 图像的子矩形（主线程）
+     * @param slot 只包含该矩形的像素，按 width*4 行宽紧密排列；调用后 slot 失效
+     */
+    bool updateImage(int image, Slot& slot, int x, int y, int width, int height);
+
+    // 每帧调用（主线程）：回收 GPU 已读完的缓冲区并重新映射
+    void pump();
+
+    PixelUploadStats getStats() const;
+
+private:
+    enum class SlotState {
+        Unmapped,   // 已回收，等待主线程映射
+        Free,       // 已映射，可被 acquire
+        Acquired,   // 工作线程正在写入
+        InFlight    // 已提交上传，等待栅栏
+    };
+
+    struct Buffer {
+        GLuint pbo = 0;
+        size_t capacity = 0;
+        unsigned char* mapped = nullptr;
+        GLsync fence = nullptr;
+        SlotState state = SlotState::Unmapped;
+    };
+
+    bool mapBuffer(Buffer& buffer);
+    // 解除映射并绑定为 GL_PIXEL_UNPACK_BUFFER；调用方需持有 m_mutex
+    bool unmapForUpload(Buffer& buffer);
+    void finishUpload(Buffer& buffer, size_t bytes);
+
+    NVGcontext* m_vg = nullptr;
+    int m_slotCount = DEFAULT_SLOT_COUNT;
+    size_t m_slotBytes = DEFAULT_SLOT_BYTES;
+    bool m_ready = false;
+
+    mutable std::mutex m_mutex;
+    std::vector<Buffer> m_buffers;
+    std::atomic<size_t> m_wantedBytes{0};   // acquire 因容量不足失败时请求的大小
+    PixelUploadStats m_stats;
+};
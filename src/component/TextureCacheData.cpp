@@ -1,153 +1,351 @@
 #include "TextureCacheData.h"
+#define NANOVG_GL3
+#include "nanovg_gl.h"
 #include <iostream>
 #include <filesystem>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
 
-TextureCaches::TextureCaches(NVGcontext* vg) : nvgContext(vg) {
-    workerThread = std::thread(&TextureCaches::workerThreadFunc, this);
+///////////////////////////////////   TextureHandle   ///////////////////////////////
+
+TextureHandle::TextureHandle(const TextureHandle& other) : m_cache(other.m_cache), m_key(other.m_key) {
+    if (m_cache) {
+        m_cache->addRef(m_key);
+    }
 }
 
-TextureCaches::~TextureCaches() {
-    shouldStop = true;
-    queueCondition.notify_all();
-    if (workerThread.joinable()) {
-        workerThread.join();
+TextureHandle::TextureHandle(TextureHandle&& other) noexcept : m_cache(other.m_cache), m_key(std::move(other.m_key)) {
+    other.m_cache = nullptr;
+    other.m_key.clear();
+}
+
+TextureHandle& TextureHandle::operator=(TextureHandle other) noexcept {
+    std::swap(m_cache, other.m_cache);
+    std::swap(m_key, other.m_key);
+    return *this;
+}
+
+TextureHandle::~TextureHandle() {
+    reset();
+}
+
+void TextureHandle::reset() {
+    if (m_cache) {
+        m_cache->removeRef(m_key);
     }
+    m_cache = nullptr;
+    m_key.clear();
+}
+
+bool TextureHandle::isLoaded() const {
+    int width, height, frameCount;
+    std::vector<int> imageId;
+    return getData(width, height, frameCount, imageId);
+}
+
+bool TextureHandle::getTextureInfo(int& textureWidth, int& textureHeight, uint64_t& revision) const {
+    if (!m_cache) return false;
+    return m_cache->getEntryTextureInfo(m_key, textureWidth, textureHeight, revision);
+}
+
+ImageType TextureHandle::getType() const {
+    if (!m_cache) return UNKNOWN;
+    return m_cache->getEntryType(m_key);
+}
+
+bool TextureHandle::getData(int& width, int& height, int& frame_count, std::vector<int>& imageId,
+                            std::vector<int>* frameDelays) const {
+    if (!m_cache) return false;
+    return m_cache->getEntryData(m_key, width, height, frame_count, imageId, frameDelays);
+}
+
+///////////////////////////////////   TextureCaches   ///////////////////////////////
+
+TextureCaches::TextureCaches(NVGcontext* vg) : texturePool(vg), nvgContext(vg) {
+}
+
+TextureCaches::~TextureCaches() {
+    // 取消本缓存的解码任务并等待运行中的任务结束
+    DecodeScheduler::getInstance().cancelOwner(this, true);
     cleanup();
 }
 
-void TextureCaches::workerThreadFunc() {
-    while (!shouldStop) {
-        std::unique_lock<std::mutex> lock(queueMutex);
-        queueCondition.wait(lock, [this] { return !loadQueue.empty() || shouldStop; });
-        
-        if (shouldStop) break;
-        
-        fs::path path = loadQueue.front();
-        loadQueue.pop();
-        lock.unlock();
-        
-        // 检查是否已经在缓存中
-        {
-            std::lock_guard<std::mutex> cacheLock(cacheMutex);
-            auto it = cache.find(path);
-            if (it != cache.end() && (it->second.loaded || it->second.loading)) {
-                continue;
+std::string TextureCaches::makeKey(const fs::path& path) {
+    return path.lexically_normal().generic_string();
+}
+
+void TextureCaches::decodeJob(const std::string& key, const DecodeScheduler::CancelToken& token) {
+    bool isFocus = false;
+    {
+        std::lock_guard<std::mutex> cacheLock(cacheMutex);
+        auto it = cache.find(key);
+        isFocus = it != cache.end() &&
+                  (it->second.refCount > 0 || (it->second.index >= 0 && distanceToFocus(it->second.index) == 0));
+    }
+
+    // 被取消或被更新的浏览请求取代时，解码过程中随时放弃
+    auto cancelled = [this, &key, &token]() {
+        return token->load() || isSuperseded(key);
+    };
+    DecodeCancelScope cancelScope(cancelled);
+
+    // CPU 预算已满时放弃非当前图片的预读，下次进入预加载窗口时再请求
+    bool overBudget = !isFocus && cpuBytesPending.load() >= cpuBudgetBytes.load();
+    ImageData imageData;
+    if (!overBudget && !cancelled()) {
+        // 在后台线程中只加载图像数据
+        imageData = loadImageData(key, decodeMaxSide.load());
+    }
+
+    size_t bytes = 0;
+    if (imageData.data) {
+        bytes = static_cast<size_t>(imageData.width) * imageData.height * 4 * std::max(imageData.frames, 1)
+              + imageData.mips.bytes();
+        size_t pending = cpuBytesPending.load();
+        overBudget = !isFocus && pending > 0 && pending + bytes > cpuBudgetBytes.load();
+    }
+
+    const bool abandoned = cancelled();
+    if (imageData.data && (abandoned || overBudget)) {
+        // 解码期间被取消或超出预算，结果直接丢弃
+        FreeImage(imageData.data);
+    }
+
+    if (imageData.data) {
+        cpuBytesPending += bytes;
+        // 交给主线程按帧预算上传
+        PendingUpload upload;
+        upload.key = key;
+        upload.imageData = std::move(imageData);
+        upload.bytes = bytes;
+        // 有空闲的像素缓冲区时在工作线程复制好数据，主线程只需发起异步上传
+        PixelUploadRing* ring = uploadRing.load();
+        const size_t rgbaBytes = static_cast<size_t>(upload.imageData.width) * upload.imageData.height * 4;
+        if (ring && ring->acquire(rgbaBytes, upload.staging)) {
+            std::memcpy(upload.staging.data, upload.imageData.data, rgbaBytes);
+            FreeImage(upload.imageData.data);
+        }
+        std::lock_guard<std::mutex> mainLock(mainThreadMutex);
+        incomingUploads.push_back(std::move(upload));
+    } else {
+        std::lock_guard<std::mutex> cacheLock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end() && !it->second.loaded) {
+            it->second.loading = false;
+            if (it->second.refCount <= 0) {
+                cache.erase(it);
             }
-            cache[path].loading = true;
         }
-        
-        // 在后台线程中只加载图像数据
-        ImageData imageData = loadImageData(path);
-        
-        if (imageData.data) {
-            // 将纹理创建任务提交到主线程
-            std::lock_guard<std::mutex> mainLock(mainThreadMutex);
-            mainThreadTasks.push([this, path, imageData]() {
-                createTexturesFromData(path, imageData);
-            });
-        } else {
-            std::lock_guard<std::mutex> cacheLock(cacheMutex);
-            cache.erase(path);
-            std::cerr << "Failed to load image data: " << path << std::endl;
+        if (!abandoned && !overBudget) {
+            std::cerr << "Failed to load image data: " << key << std::endl;
         }
     }
 }
 
-ImageType TextureCaches::detectImageType(const fs::path& path) {
-    std::string ext = path.extension().string();
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
-    
-    if (ext == ".png") return PNG;
-    if (ext == ".jpg" || ext == ".jpeg") return JPG;
-    if (ext == ".gif") return GIF;
-    if (ext == ".bmp") return BMP;
-    if (ext == ".tiff" || ext == ".tif") return TIFF;
-    if (ext == ".hdr") return HDR;
-    if (ext == ".tga") return TGA;
-    
-    return UNKNOWN;
+bool TextureCaches::isSuperseded(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    return it != cache.end() && it->second.requestGeneration != 0 &&
+           it->second.requestGeneration != requestGeneration.load();
 }
 
-ImageData TextureCaches::loadImageData(const fs::path& path) {
+ImageData TextureCaches::loadImageData(const fs::path& path, int maxSide) {
     ImageData result;
-    result.type = detectImageType(path);
     std::string pathStr = path.generic_string();
-    
-    if (result.type == GIF) {
-        // result.data = loadGifImage(pathStr, result.width, result.height, result.channels, result.frames);
-    } else if (result.type != UNKNOWN) {
-        result.data = LoadImage(pathStr, result.width, result.height, result.channels);
-        result.frames = 1;
-    }
-    
+
+    // 单张纹理放不下原图时至少缩小到纹理上限
+    int textureLimit = maxTextureSize.load();
+    if (textureLimit > 0 && (maxSide <= 0 || maxSide > textureLimit)) {
+        maxSide = textureLimit;
+    }
+    // 格式由文件头决定；在工作线程中缩小到显示尺寸，上传量和显存按面积减少。
+    // GIF 只缓存第一帧作为封面，动画由 GifPlayer 边解码边播放
+    result.data = LoadImageScaled(pathStr, maxSide, result.width, result.height,
+                                  result.sourceWidth, result.sourceHeight, result.channels, &result.type);
+    result.frames = 1;
+
+    // 缩小层级在这里生成，主线程上传时不需要 glGenerateMipmap；GIF 封面很快会被动画帧替换
+    if (result.data && buildMipmaps.load() && result.type != GIF) {
+        BuildMipChain(result.data, result.width, result.height, result.mips);
+    }
+
     return result;
 }
 
-void TextureCaches::createTexturesFromData(const fs::path& path, const ImageData& imageData) {
+bool TextureCaches::hasEntry(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    return cache.find(key) != cache.end();
+}
+
+bool TextureCaches::isEntryLoaded(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    return it != cache.end() && it->second.loaded;
+}
+
+void TextureCaches::createTexturesFromData(const std::string& key, const ImageData& imageData) {
     if (!imageData.data) return;
-    
+
+    // 同步加载已经抢先完成时，丢弃后台解码的重复结果
+    if (isEntryLoaded(key)) {
+        unsigned char* mutableData = imageData.data;
+        FreeImage(mutableData);
+        return;
+    }
+
+    // 每个条目只有一张纹理；GIF 只缓存封面，动画帧由 GifPlayer 局部更新到单张纹理上
+    std::cout << "[TextureCache] Creating single GPU texture..." << std::endl;
+    int textureId = texturePool.acquire(imageData.width, imageData.height, poolFlags(imageData), imageData.data);
+    commitTexture(key, imageData, textureId);
+}
+
+int TextureCaches::poolFlags(const ImageData& imageData) {
+    return imageData.mips.empty() ? 0 : TexturePool::MIPMAPPED;
+}
+
+void TextureCaches::uploadMipChain(int image, const MipChain& mips) {
+    // nanovg 只上传第 0 级；其余各级直接写入同一纹理，并改用三线性过滤
+    GLuint texture = nvglImageHandleGL3(nvgContext, image);
+    if (!texture) return;
+
+    GLint previous = 0;
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &previous);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (size_t i = 0; i < mips.levels.size(); ++i) {
+        const MipChain::Level& level = mips.levels[i];
+        glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i + 1), GL_RGBA, level.width, level.height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, mips.pixels.data() + level.offset);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(mips.levels.size()));
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    // 恢复绑定，nanovg 缓存了当前绑定的纹理
+    glBindTexture(GL_TEXTURE_2D, static_cast<GLuint>(previous));
+}
+
+bool TextureCaches::commitTexture(const std::string& key, const ImageData& imageData, int textureId) {
+    fs::path path(key);
+    // 已有纹理，或条目已被移除（文件在磁盘上被修改或删除），丢弃这次解码结果
+    if (isEntryLoaded(key) || !hasEntry(key)) {
+        texturePool.release(textureId, poolFlags(imageData));
+        unsigned char* mutableData = imageData.data;
+        FreeImage(mutableData);
+        return false;
+    }
+
     TextureCacheData cacheData;
     cacheData.type = imageData.type;
-    cacheData.width = imageData.width;
-    cacheData.height = imageData.height;
+    cacheData.width = imageData.sourceWidth > 0 ? imageData.sourceWidth : imageData.width;
+    cacheData.height = imageData.sourceHeight > 0 ? imageData.sourceHeight : imageData.height;
+    cacheData.textureWidth = imageData.width;
+    cacheData.textureHeight = imageData.height;
     cacheData.channels = imageData.channels;
     cacheData.frame_count = imageData.frames;
+    cacheData.frameDelays = imageData.delays;
     cacheData.imageId.clear();
-    
-    if (imageData.type == GIF && imageData.frames > 1) {
-        // GIF 多帧处理
-        std::cout << "[TextureCache] Creating " << imageData.frames << " GPU textures for GIF..." << std::endl;
-        cacheData.imageId.reserve(imageData.frames);
-        size_t frameSize = imageData.width * imageData.height * 4; // RGBA
-        
-        for (int i = 0; i < imageData.frames; i++) {
-            unsigned char* frameData = imageData.data + (i * frameSize);
-            int textureId = nvgCreateImageRGBA(nvgContext, imageData.width, imageData.height, 0, frameData);
-            
-            if (textureId == -1) {
-                std::cerr << "[TextureCache] Failed to create texture for frame " << i  << " of " << path.filename() << std::endl;
-                // 清理已创建的纹理
-                for (int texId : cacheData.imageId) {
-                    nvgDeleteImage(nvgContext, texId);
-                }
-                cacheData.imageId.clear();
-                break;
-            }
-            cacheData.imageId.push_back(textureId);
-        }
-    } else {
-        // 普通图片处理
-        std::cout << "[TextureCache] Creating single GPU texture..." << std::endl;
-        int textureId = nvgCreateImageRGBA(nvgContext, imageData.width, imageData.height, 0, imageData.data);
-        if (textureId != -1) {
-            cacheData.imageId.push_back(textureId);
-            std::cout << "[TextureCache] GPU texture created successfully (ID: " << textureId << ")" << std::endl;
-        }else {
-            std::cerr << "[TextureCache] Failed to create GPU texture for: " << path.filename() << std::endl;
+
+    if (textureId != -1) {
+        if (!imageData.mips.empty()) {
+            uploadMipChain(textureId, imageData.mips);
+            cacheData.mipmapped = true;
         }
+        cacheData.imageId.push_back(textureId);
+        std::cout << "[TextureCache] GPU texture created successfully (ID: " << textureId << ")" << std::endl;
+    }else {
+        std::cerr << "[TextureCache] Failed to create GPU texture for: " << path.filename() << std::endl;
     }
-    
+
     // 释放图像数据
-    std::string pathStr = path.generic_string();
     unsigned char* mutableData = const_cast<unsigned char*>(imageData.data);
-    FreeImage(mutableData, pathStr);
+    FreeImage(mutableData);
     std::cout << "[TextureCache] Released image data memory for: " << path.filename() << std::endl;
     // 更新缓存
     {
         std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
         if (!cacheData.imageId.empty()) {
             cacheData.loading = false;
             cacheData.loaded = true;
-            cache[path] = cacheData;
-            std::cout << "[TextureCache] ✓ Successfully cached: " << path.filename() 
-                      << " (" << cacheData.width << "x" << cacheData.height << ", " 
+            cacheData.gpuBytes = static_cast<size_t>(cacheData.textureWidth) * cacheData.textureHeight * 4 * cacheData.imageId.size();
+            if (cacheData.mipmapped) cacheData.gpuBytes += imageData.mips.bytes();
+            cacheData.lastUsed = ++useTick;
+            if (it != cache.end()) {
+                // 保留预加载时记录的索引和引用计数
+                cacheData.index = it->second.index;
+                cacheData.refCount = it->second.refCount;
+                cacheData.revision = it->second.revision + 1;
+            }
+            gpuBytesResident += cacheData.gpuBytes;
+            cache[key] = cacheData;
+            std::cout << "[TextureCache] ✓ Successfully cached: " << path.filename()
+                      << " (" << cacheData.width << "x" << cacheData.height << ", "
                       << cacheData.imageId.size() << " textures)" << std::endl;
         } else {
-            cache.erase(path);
+            if (it != cache.end()) {
+                it->second.loading = false;
+                if (it->second.refCount <= 0) {
+                    cache.erase(it);
+                }
+            }
             std::cerr << "[TextureCache] ✗ Failed to create textures for: " << path.filename() << std::endl;
         }
     }
+    evictToBudget();
+    return textureId != -1;
+}
+
+size_t TextureCaches::distanceToFocus(long long index) const {
+    // 调用方需持有 cacheMutex
+    if (focusCount == 0) return 0;
+    if (index < 0) return focusCount;   // 没有索引的条目视为最远
+
+    size_t i = static_cast<size_t>(index);
+    size_t distance = i > focusIndex ? i - focusIndex : focusIndex - i;
+    if (focusCycle && distance < focusCount) {
+        distance = std::min(distance, focusCount - distance);
+    }
+    return distance;
+}
+
+void TextureCaches::releaseEntryTextures(TextureCacheData& data) {
+    // 调用方需持有 cacheMutex
+    // 纹理放回池中，下一张同尺寸的图片直接复用
+    for (int texId : data.imageId) {
+        texturePool.release(texId, data.mipmapped ? TexturePool::MIPMAPPED : 0);
+    }
+    data.imageId.clear();
+    data.loaded = false;
+    gpuBytesResident -= std::min(gpuBytesResident, data.gpuBytes);
+    data.gpuBytes = 0;
+}
+
+void TextureCaches::evictToBudget() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    while (gpuBytesResident > gpuBudgetBytes) {
+        // 闲置越久、离当前图片越远的条目越先淘汰
+        auto victim = cache.end();
+        uint64_t worstScore = 0;
+        for (auto it = cache.begin(); it != cache.end(); ++it) {
+            const TextureCacheData& data = it->second;
+            if (!data.loaded || data.refCount > 0) continue;
+            size_t distance = distanceToFocus(data.index);
+            if (data.index >= 0 && distance == 0) continue;  // 当前图片
+            uint64_t score = (useTick - data.lastUsed) + DISTANCE_WEIGHT * distance;
+            if (victim == cache.end() || score > worstScore) {
+                victim = it;
+                worstScore = score;
+            }
+        }
+        if (victim == cache.end()) break;   // 剩下的都在使用中
+
+        std::cout << "[TextureCache] Evicting " << fs::path(victim->first).filename()
+                  << " (" << victim->second.gpuBytes / (1024 * 1024) << " MB)" << std::endl;
+        releaseEntryTextures(victim->second);
+        cache.erase(victim);
+        evictions++;
+    }
 }
 
 void TextureCaches::processMainThreadTasks() {
@@ -156,7 +354,7 @@ void TextureCaches::processMainThreadTasks() {
         std::lock_guard<std::mutex> lock(mainThreadMutex);
         tasksToProcess = std::move(mainThreadTasks);
     }
-    
+
     while (!tasksToProcess.empty()) {
         auto task = std::move(tasksToProcess.front());
         tasksToProcess.pop();
@@ -166,30 +364,474 @@ void TextureCaches::processMainThreadTasks() {
             std::cerr << "Exception in main thread task: " << e.what() << std::endl;
         }
     }
+
+    processUploads();
+}
+
+///////////////////////////////////   上传   ///////////////////////////////
+
+bool TextureCaches::updateTextureRegion(NVGcontext* vg, int image, int x, int y, int width, int height,
+                                        const unsigned char* data) {
+    // nvgUpdateImage 只能整张替换；后端的纹理更新接口本身支持子矩形（按整图行宽读取源数据）
+    NVGparams* params = nvgInternalParams(vg);
+    if (!params || !params->renderUpdateTexture) return false;
+    return params->renderUpdateTexture(params->userPtr, image, x, y, width, height, data) != 0;
+}
+
+void TextureCaches::setUploadBudget(size_t bytesPerFrame, double msPerFrame) {
+    uploadBudgetBytes = std::max<size_t>(bytesPerFrame, UPLOAD_BAND_BYTES);
+    uploadBudgetMs = std::max(msPerFrame, 0.5);
+}
+
+size_t TextureCaches::uploadPriority(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it == cache.end()) return focusCount + 1;
+    if (it->second.refCount > 0) return 0;
+    if (it->second.index < 0) return focusCount + 1;
+    size_t distance = distanceToFocus(it->second.index);
+    return distance == 0 ? 0 : distance + 1;
+}
+
+void TextureCaches::processUploads() {
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        for (auto& upload : incomingUploads) {
+            pendingUploads.push_back(std::move(upload));
+        }
+        incomingUploads.clear();
+    }
+
+    uploadStats.frameBytes = 0;
+    uploadStats.frameBands = 0;
+    uploadStats.frameTextures = 0;
+    uploadStats.frameMs = 0.0;
+    if (pendingUploads.empty()) {
+        uploadStats.pendingUploads = 0;
+        uploadStats.pendingBytes = 0;
+        return;
+    }
+
+    // 当前图片排在预加载之前，其余按与当前图片的距离
+    for (auto& upload : pendingUploads) {
+        upload.priority = uploadPriority(upload.key);
+    }
+    std::stable_sort(pendingUploads.begin(), pendingUploads.end(),
+                     [](const PendingUpload& a, const PendingUpload& b) { return a.priority < b.priority; });
+
+    auto start = std::chrono::steady_clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto overBudget = [&]() {
+        return uploadStats.frameBytes >= uploadBudgetBytes || elapsedMs() >= uploadBudgetMs;
+    };
+
+    for (auto& upload : pendingUploads) {
+        const bool focus = upload.priority == 0;
+        if (!focus && overBudget()) break;
+        if (!upload.upgrade && isEntryLoaded(upload.key)) {
+            // 同步加载已经抢先完成，提交时丢弃
+            if (upload.staging.valid()) uploadRing.load()->release(upload.staging);
+            upload.done = true;
+            continue;
+        }
+
+        const ImageData& image = upload.imageData;
+        const size_t rowBytes = static_cast<size_t>(image.width) * 4;
+        const size_t totalBytes = rowBytes * image.height;
+        if (upload.staging.valid()) {
+            // 数据已在像素缓冲区中，驱动异步复制，不需要分行带
+            upload.textureId = texturePool.acquire(image.width, image.height, poolFlags(image), nullptr);
+            if (upload.textureId == -1) {
+                uploadRing.load()->release(upload.staging);
+            } else if (!uploadRing.load()->updateImage(upload.textureId, upload.staging, 0, 0, image.width, image.height)) {
+                texturePool.release(upload.textureId, poolFlags(image));
+                upload.textureId = -1;
+            }
+            upload.rowsUploaded = image.height;
+            uploadStats.frameBytes += totalBytes;
+            uploadStats.frameBands++;
+            upload.done = true;
+            continue;
+        }
+        if (upload.textureId == -1) {
+            if (focus || totalBytes <= UPLOAD_BAND_BYTES) {
+                // 当前图片和小图一次上传
+                upload.textureId = texturePool.acquire(image.width, image.height, poolFlags(image), image.data);
+                upload.rowsUploaded = image.height;
+                uploadStats.frameBytes += totalBytes;
+                uploadStats.frameBands++;
+            } else {
+                // 大图先只分配存储，再按行带填充
+                upload.textureId = texturePool.acquire(image.width, image.height, poolFlags(image), nullptr);
+            }
+            if (upload.textureId == -1) {
+                upload.done = true;
+                continue;
+            }
+        }
+
+        const int bandRows = std::max(1, static_cast<int>(UPLOAD_BAND_BYTES / std::max<size_t>(rowBytes, 1)));
+        while (upload.rowsUploaded < image.height) {
+            if (!focus && overBudget()) break;
+            // 预加载图片变成当前图片时，剩余部分一次传完
+            int rows = focus ? image.height - upload.rowsUploaded
+                             : std::min(bandRows, image.height - upload.rowsUploaded);
+            if (!updateTextureRegion(nvgContext, upload.textureId, 0, upload.rowsUploaded, image.width, rows, image.data)) {
+                nvgUpdateImage(nvgContext, upload.textureId, image.data);
+                rows = image.height - upload.rowsUploaded;
+            }
+            upload.rowsUploaded += rows;
+            uploadStats.frameBytes += rowBytes * rows;
+            uploadStats.frameBands++;
+        }
+        upload.done = upload.rowsUploaded >= image.height;
+    }
+
+    // 完整上传的纹理写入缓存
+    for (auto it = pendingUploads.begin(); it != pendingUploads.end();) {
+        if (!it->done) {
+            ++it;
+            continue;
+        }
+        cpuBytesPending -= it->bytes;
+        if (it->upgrade && it->textureId != -1) {
+            // 释放缩小的纹理，保留引用计数和索引，由 commitTexture 写入原始分辨率的纹理
+            std::lock_guard<std::mutex> lock(cacheMutex);
+            auto entry = cache.find(it->key);
+            if (entry != cache.end() && entry->second.loaded) {
+                releaseEntryTextures(entry->second);
+                std::cout << "[TextureCache] Upgrading to full resolution: " << fs::path(it->key).filename()
+                          << " (" << it->imageData.width << "x" << it->imageData.height << ")" << std::endl;
+            }
+        }
+        if (commitTexture(it->key, it->imageData, it->textureId)) {
+            uploadStats.frameBytes += it->imageData.mips.bytes();
+            uploadStats.frameTextures++;
+            uploadStats.totalTextures++;
+        }
+        it = pendingUploads.erase(it);
+    }
+
+    uploadStats.frameMs = elapsedMs();
+    uploadStats.maxFrameMs = std::max(uploadStats.maxFrameMs, uploadStats.frameMs);
+    uploadStats.totalBytes += uploadStats.frameBytes;
+    uploadStats.pendingUploads = pendingUploads.size();
+    uploadStats.pendingBytes = 0;
+    for (const auto& upload : pendingUploads) {
+        uploadStats.pendingBytes += static_cast<size_t>(upload.imageData.width) * upload.imageData.height * 4;
+    }
+}
+
+void TextureCaches::releasePendingUploads() {
+    {
+        std::lock_guard<std::mutex> lock(mainThreadMutex);
+        for (auto& upload : incomingUploads) {
+            pendingUploads.push_back(std::move(upload));
+        }
+        incomingUploads.clear();
+    }
+    for (auto& upload : pendingUploads) {
+        if (upload.staging.valid()) uploadRing.load()->release(upload.staging);
+        texturePool.release(upload.textureId, poolFlags(upload.imageData));
+        FreeImage(upload.imageData.data);
+        cpuBytesPending -= upload.bytes;
+    }
+    pendingUploads.clear();
+}
+
+///////////////////////////////////   引用计数   ///////////////////////////////
+
+void TextureCaches::addRef(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    TextureCacheData& entry = cache[key];
+    entry.refCount++;
+    entry.lastUsed = ++useTick;
+}
+
+void TextureCaches::removeRef(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it == cache.end()) return;
+    if (it->second.refCount > 0) {
+        it->second.refCount--;
+    }
+    // 引用归零后纹理留在缓存中，由预算淘汰；从未加载的空条目直接移除
+    if (it->second.refCount == 0 && !it->second.loaded && !it->second.loading) {
+        cache.erase(it);
+    }
+}
+
+bool TextureCaches::getEntryData(const std::string& key, int& width, int& height, int& frame_count,
+                                 std::vector<int>& imageId, std::vector<int>* frameDelays) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it == cache.end() || !it->second.loaded) return false;
+    width = it->second.width;
+    height = it->second.height;
+    frame_count = it->second.frame_count;
+    imageId = it->second.imageId;
+    if (frameDelays) {
+        *frameDelays = it->second.frameDelays;
+    }
+    it->second.lastUsed = ++useTick;
+    return true;
+}
+
+bool TextureCaches::getEntryTextureInfo(const std::string& key, int& textureWidth, int& textureHeight, uint64_t& revision) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it == cache.end() || !it->second.loaded) return false;
+    textureWidth = it->second.textureWidth;
+    textureHeight = it->second.textureHeight;
+    revision = it->second.revision;
+    return true;
+}
+
+ImageType TextureCaches::getEntryType(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it == cache.end() || !it->second.loaded) return UNKNOWN;
+    return it->second.type;
+}
+
+TextureHandle TextureCaches::acquire(const fs::path& path) {
+    std::string key = makeKey(path);
+    addRef(key);
+    return TextureHandle(this, key);
+}
+
+TextureHandle TextureCaches::acquireAsync(const fs::path& path, long long index, DecodeScheduler::Priority priority) {
+    std::string key = makeKey(path);
+    addRef(key);
+    bool needsLoad = false;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        TextureCacheData& entry = cache[key];
+        if (index >= 0) entry.index = index;
+        needsLoad = !entry.loaded && !entry.loading;
+        if (needsLoad) entry.loading = true;
+        if (entry.loaded) hits++; else misses++;
+    }
+    if (needsLoad) {
+        submitDecode(key, index, priority);
+    }
+    return TextureHandle(this, key);
 }
 
+TextureHandle TextureCaches::acquireSync(const fs::path& path, long long index) {
+    std::string key = makeKey(path);
+    addRef(key);
+    bool loaded = false;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        TextureCacheData& entry = cache[key];
+        if (index >= 0) entry.index = index;
+        loaded = entry.loaded;
+        if (loaded) hits++; else misses++;
+    }
+    if (!loaded) {
+        loadKeySync(key, index);
+    }
+    return TextureHandle(this, key);
+}
+
+///////////////////////////////////   加载   ///////////////////////////////
+
 bool TextureCaches::getImageCacheData(const fs::path& path, int& width, int& height, int& frame_count, std::vector<int>& imageId) {
     std::lock_guard<std::mutex> lock(cacheMutex);
-    auto it = cache.find(path);
+    auto it = cache.find(makeKey(path));
     if (it != cache.end() && it->second.loaded) {
         width = it->second.width;
         height = it->second.height;
         frame_count = it->second.frame_count;
         imageId = it->second.imageId;
+        it->second.lastUsed = ++useTick;
+        hits++;
         return true;
     }
+    misses++;
     return false;
 }
 
+bool TextureCaches::addImageCacheData(const fs::path& path, const TextureCacheData& data) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        std::string key = makeKey(path);
+        auto it = cache.find(key);
+        if (it != cache.end() && it->second.loaded) return false;
+
+        TextureCacheData entry = data;
+        entry.loaded = !entry.imageId.empty();
+        entry.loading = false;
+        if (entry.textureWidth <= 0 || entry.textureHeight <= 0) {
+            entry.textureWidth = entry.width;
+            entry.textureHeight = entry.height;
+        }
+        entry.refCount = it != cache.end() ? it->second.refCount : 0;
+        entry.gpuBytes = static_cast<size_t>(entry.textureWidth) * entry.textureHeight * 4 * entry.imageId.size();
+        entry.lastUsed = ++useTick;
+        gpuBytesResident += entry.gpuBytes;
+        cache[key] = entry;
+    }
+    evictToBudget();
+    return true;
+}
+
+bool TextureCaches::removeImageCacheData(const fs::path& path) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(makeKey(path));
+    if (it == cache.end()) return false;
+    // 仍被句柄引用的纹理不能删除
+    if (it->second.refCount > 0) return false;
+    releaseEntryTextures(it->second);
+    cache.erase(it);
+    return true;
+}
+
+bool TextureCaches::invalidateImage(const fs::path& path) {
+    std::string key = makeKey(path);
+    // 排队中的解码读到的是旧内容
+    DecodeScheduler::getInstance().cancelKey(this, key);
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it == cache.end()) return true;
+    if (it->second.refCount > 0) return false;
+    releaseEntryTextures(it->second);
+    cache.erase(it);
+    return true;
+}
+
 void TextureCaches::preloadImages(const std::vector<fs::path>& imagePaths) {
-    std::lock_guard<std::mutex> lock(queueMutex);
     for (const auto& path : imagePaths) {
-        loadQueue.push(path);
+        preloadImage(path);
+    }
+}
+
+void TextureCaches::preloadImage(const fs::path& path, long long index, DecodeScheduler::Priority priority) {
+    std::string key = makeKey(path);
+    // 检查是否已经在缓存中
+    {
+        std::lock_guard<std::mutex> cacheLock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end()) {
+            // 列表可能已重新扫描，更新索引
+            it->second.index = index;
+            // 仍在预加载窗口内的图片不再随浏览请求作废
+            it->second.requestGeneration = 0;
+            if (it->second.loaded || it->second.loading) {
+                return;
+            }
+        }
+        TextureCacheData& entry = cache[key];
+        entry.loading = true;
+        entry.index = index;
+    }
+
+    submitDecode(key, index, priority);
+}
+
+void TextureCaches::submitDecode(const std::string& key, long long index, DecodeScheduler::Priority priority) {
+    DecodeScheduler::getInstance().submit(this, key, index, priority,
+        [this, key](const DecodeScheduler::CancelToken& token) {
+            decodeJob(key, token);
+        },
+        [this, key]() {
+            std::lock_guard<std::mutex> cacheLock(cacheMutex);
+            auto it = cache.find(key);
+            if (it != cache.end() && !it->second.loaded) {
+                it->second.loading = false;
+                if (it->second.refCount <= 0) {
+                    cache.erase(it);
+                }
+            }
+        });
+}
+
+void TextureCaches::cancelPreload(const fs::path& path) {
+    DecodeScheduler::getInstance().cancelKey(this, makeKey(path));
+}
+
+bool TextureCaches::loadKeySync(const std::string& key, long long index) {
+    // 排队中的同一任务不再需要
+    DecodeScheduler::getInstance().cancelKey(this, key);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        TextureCacheData& entry = cache[key];
+        if (entry.loaded) return true;
+        entry.loading = true;
+        if (index >= 0) entry.index = index;
+    }
+
+    ImageData imageData = loadImageData(key, decodeMaxSide.load());
+    if (!imageData.data) {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if (it != cache.end() && !it->second.loaded) {
+            it->second.loading = false;
+            if (it->second.refCount <= 0) {
+                cache.erase(it);
+            }
+        }
+        return false;
+    }
+    createTexturesFromData(key, imageData);
+
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    return it != cache.end() && it->second.loaded;
+}
+
+uint64_t TextureCaches::requestImage(const fs::path& path, long long index) {
+    std::string key = makeKey(path);
+    uint64_t generation = ++requestGeneration;
+    bool needsLoad = false;
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        TextureCacheData& entry = cache[key];
+        if (index >= 0) entry.index = index;
+        needsLoad = !entry.loaded && !entry.loading;
+        if (needsLoad) {
+            entry.loading = true;
+            entry.requestGeneration = generation;
+        } else if (entry.loading && entry.requestGeneration != 0) {
+            // 同一图片的请求仍在解码（如来回切换），沿用它而不是让它作废
+            entry.requestGeneration = generation;
+        }
+    }
+    if (needsLoad) {
+        submitDecode(key, index, DecodeScheduler::VISIBLE);
     }
-    queueCondition.notify_all();
+    return generation;
+}
+
+void TextureCaches::cancelRequests() {
+    ++requestGeneration;
+}
+
+bool TextureCaches::isImageLoading(const fs::path& path) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(makeKey(path));
+    return it != cache.end() && !it->second.loaded && it->second.loading;
+}
+
+bool TextureCaches::isImageLoaded(const fs::path& path) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(makeKey(path));
+    return it != cache.end() && it->second.loaded;
+}
+
+int TextureCaches::getImageTexture(const fs::path& path, int frameIndex) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(makeKey(path));
+    if (it == cache.end() || !it->second.loaded) return -1;
+    if (frameIndex < 0 || frameIndex >= static_cast<int>(it->second.imageId.size())) return -1;
+    return it->second.imageId[frameIndex];
 }
 
 void TextureCaches::cleanup() {
+    releasePendingUploads();
     std::lock_guard<std::mutex> lock(cacheMutex);
     for (auto& pair : cache) {
         for (int texId : pair.second.imageId) {
@@ -199,4 +841,114 @@ void TextureCaches::cleanup() {
         }
     }
     cache.clear();
-}
\ No newline at end of file
+    gpuBytesResident = 0;
+    texturePool.clear();
+}
+
+void TextureCaches::setMemoryBudget(size_t gpuBytes, size_t cpuBytes) {
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        gpuBudgetBytes = gpuBytes;
+    }
+    cpuBudgetBytes = cpuBytes;
+    evictToBudget();
+}
+
+void TextureCaches::setFocus(size_t currentIndex, size_t count, bool cycle) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    focusIndex = currentIndex;
+    focusCount = count;
+    focusCycle = cycle;
+}
+
+TextureCacheStats TextureCaches::getStats() {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    TextureCacheStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.hitRate = (hits + misses) > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0;
+    stats.gpuBytesResident = gpuBytesResident;
+    stats.cpuBytesPending = cpuBytesPending.load();
+    stats.gpuBudgetBytes = gpuBudgetBytes;
+    stats.cpuBudgetBytes = cpuBudgetBytes.load();
+    stats.entries = cache.size();
+    stats.evictions = evictions;
+    return stats;
+}
+
+void TextureCaches::setDecodeTarget(int maxSide) {
+    decodeMaxSide = std::max(maxSide, 0);
+}
+
+bool TextureCaches::isFullResolution(const fs::path& path) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(makeKey(path));
+    if (it == cache.end() || !it->second.loaded) return false;
+    return it->second.textureWidth >= it->second.width && it->second.textureHeight >= it->second.height;
+}
+
+bool TextureCaches::requestFullResolution(const fs::path& path) {
+    std::string key = makeKey(path);
+    {
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        if (it == cache.end() || !it->second.loaded) return false;
+        TextureCacheData& entry = it->second;
+        if (entry.textureWidth >= entry.width && entry.textureHeight >= entry.height) return true;
+        if (entry.fullResolutionRequested) return true;
+        entry.fullResolutionRequested = true;
+    }
+
+    DecodeScheduler::getInstance().submit(this, key, -1, DecodeScheduler::VISIBLE,
+        [this, key](const DecodeScheduler::CancelToken& token) {
+            fullResolutionJob(key, token);
+        },
+        [this, key]() {
+            resetFullResolutionRequest(key);
+        });
+    return true;
+}
+
+void TextureCaches::resetFullResolutionRequest(const std::string& key) {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) it->second.fullResolutionRequested = false;
+}
+
+void TextureCaches::fullResolutionJob(const std::string& key, const DecodeScheduler::CancelToken& token) {
+    // 切到其他图片（没有控件再持有它）后放弃，下次放大时重新请求
+    auto cancelled = [this, &key, &token]() {
+        if (token->load()) return true;
+        std::lock_guard<std::mutex> lock(cacheMutex);
+        auto it = cache.find(key);
+        return it == cache.end() || it->second.refCount <= 0;
+    };
+    DecodeCancelScope cancelScope(cancelled);
+
+    ImageData imageData;
+    if (!cancelled()) {
+        imageData = loadImageData(key, 0);
+    }
+    const bool abandoned = cancelled();
+    if (imageData.data && abandoned) {
+        FreeImage(imageData.data);
+    }
+    if (!imageData.data) {
+        if (abandoned) {
+            resetFullResolutionRequest(key);
+        } else {
+            std::cerr << "[TextureCache] Failed to reload full resolution: " << key << std::endl;
+        }
+        return;
+    }
+
+    // 和普通解码一样交给主线程上传，上传完成后才替换缩小的纹理
+    PendingUpload upload;
+    upload.key = key;
+    upload.bytes = static_cast<size_t>(imageData.width) * imageData.height * 4 + imageData.mips.bytes();
+    upload.imageData = std::move(imageData);
+    upload.upgrade = true;
+    cpuBytesPending += upload.bytes;
+    std::lock_guard<std::mutex> mainLock(mainThreadMutex);
+    incomingUploads.push_back(std::move(upload));
+}
@@ -5,6 +5,7 @@
 #include <thread>
 #include <mutex>
 #include <queue>
+#include <deque>
 #include <functional>
 #include <algorithm>
 #include <filesystem>
@@ -12,14 +13,13 @@
 #include <condition_variable>
 #include <filesystem>
 #include "../utils/utils.h"
+#include "DecodeScheduler.h"
+#include "PixelUploadRing.h"
+#include "TexturePool.h"
 #include "nanovg.h"
 
 namespace fs = std::filesystem;
 
-enum ImageType {
-    PNG, JPG, GIF, BMP, TIFF, HDR, TGA, UNKNOWN
-};
-
 struct ImageData {
     unsigned char* data = nullptr;
     int width = 0;
@@ -27,6 +27,10 @@ struct ImageData {
     int channels = 0;
     int frames = 0;
     ImageType type = UNKNOWN;
+    std::vector<int> delays;    // GIF 每帧延迟（毫秒）
+    int sourceWidth = 0;        // 原图尺寸；按显示尺寸解码时大于 width/height
+    int sourceHeight = 0;
+    MipChain mips;              // 工作线程预生成的缩小层级，为空时纹理只有第 0 级
 };
 
 struct TextureCacheData {
@@ -34,47 +38,249 @@ struct TextureCacheData {
     int frame_count = 0;
     bool loading = false;
     bool loaded = false;
-    int width = 0;
+    int width = 0;              // 原图尺寸（布局使用）
     int height = 0;
     int channels = 0;
+    int textureWidth = 0;       // 实际纹理尺寸，按显示尺寸解码时小于原图
+    int textureHeight = 0;
+    uint64_t revision = 0;      // 纹理被替换（如升级到原始分辨率）时递增
+    bool fullResolutionRequested = false;   // 已提交原始分辨率解码（失败后不再重试）
     std::vector<int> imageId;
+    std::vector<int> frameDelays;   // GIF 每帧延迟（毫秒）
+    // 内存预算与淘汰
+    size_t gpuBytes = 0;        // 已上传纹理占用的显存（所有帧）
+    bool mipmapped = false;     // 纹理带有预生成的缩小层级
+    uint64_t lastUsed = 0;      // 最近一次使用的时间戳（单调递增计数）
+    long long index = -1;       // 在图片列表中的索引，用于按距离淘汰
+    int refCount = 0;           // 被 TextureHandle 持有时 >0，不会被淘汰
+    uint64_t requestGeneration = 0; // 由 requestImage 提交时的请求代号，被新请求取代后中途放弃；0 表示预加载
+};
+
+// 缓存统计
+struct TextureCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    double hitRate = 0.0;
+    size_t gpuBytesResident = 0;
+    size_t cpuBytesPending = 0;     // 已解码、等待上传的像素数据
+    size_t gpuBudgetBytes = 0;
+    size_t cpuBudgetBytes = 0;
+    size_t entries = 0;
+    uint64_t evictions = 0;
+};
+
+// 纹理上传统计（主线程每帧更新）
+struct TextureUploadStats {
+    size_t frameBytes = 0;        // 最近一帧上传的字节数
+    int frameBands = 0;           // 最近一帧上传的行带数
+    int frameTextures = 0;        // 最近一帧完成的纹理数
+    double frameMs = 0.0;         // 最近一帧上传耗时
+    double maxFrameMs = 0.0;      // 单帧最大上传耗时
+    size_t pendingUploads = 0;    // 等待上传的图片数
+    size_t pendingBytes = 0;      // 等待上传的字节数
+    uint64_t totalBytes = 0;
+    uint64_t totalTextures = 0;
+};
+
+class TextureCaches;
+
+/**
+ * @class TextureHandle
+ * @brief 缓存纹理的引用计数句柄
+ * @description 持有句柄期间对应的纹理不会被淘汰；多个控件显示同一文件时共享一次解码和上传。
+ *              句柄必须在所属 TextureCaches 析构前释放。
+ */
+class TextureHandle {
+public:
+    TextureHandle() = default;
+    TextureHandle(const TextureHandle& other);
+    TextureHandle(TextureHandle&& other) noexcept;
+    TextureHandle& operator=(TextureHandle other) noexcept;
+    ~TextureHandle();
+
+    void reset();
+    bool valid() const { return m_cache != nullptr; }
+    const std::string& key() const { return m_key; }
+
+    bool isLoaded() const;
+    bool getData(int& width, int& height, int& frame_count, std::vector<int>& imageId,
+                 std::vector<int>* frameDelays = nullptr) const;
+    // 实际纹理尺寸与版本号；版本变化说明纹理已被替换，需要重新 getData
+    bool getTextureInfo(int& textureWidth, int& textureHeight, uint64_t& revision) const;
+    // 解码时按文件头识别的格式，尚未加载时为 UNKNOWN
+    ImageType getType() const;
+
+private:
+    friend class TextureCaches;
+    // 接管一个已经增加过的引用
+    TextureHandle(TextureCaches* cache, std::string key) : m_cache(cache), m_key(std::move(key)) {}
+
+    TextureCaches* m_cache = nullptr;
+    std::string m_key;
 };
 
+/**
+ * @class TextureCaches
+ * @brief 纹理驻留引擎
+ * @description 统一管理图片的解码、上传和显存占用：
+ *              - 以规范化的路径字符串为键
+ *              - 后台解码走共享的 DecodeScheduler，纹理在主线程创建
+ *              - 同步/异步两种加载方式，返回引用计数句柄
+ *              - 按字节预算进行 LRU + 距离加权淘汰
+ */
 class TextureCaches {
 private:
-    std::unordered_map<fs::path, TextureCacheData> cache;
+    std::unordered_map<std::string, TextureCacheData> cache;
     std::mutex cacheMutex;
-    
-    // 后台线程相关
-    std::thread workerThread;
-    std::queue<fs::path> loadQueue;
-    std::mutex queueMutex;
-    std::condition_variable queueCondition;
-    std::atomic<bool> shouldStop{false};
-    
+
     // 主线程任务队列
     std::queue<std::function<void()>> mainThreadTasks;
     std::mutex mainThreadMutex;
-    
+
+    // 待上传的解码结果：工作线程放入 incomingUploads，主线程按每帧预算分行带上传
+    struct PendingUpload {
+        std::string key;
+        ImageData imageData;
+        size_t bytes = 0;           // 计入 cpuBytesPending 的字节数
+        size_t priority = 0;        // 0 为当前图片，其余为与当前图片的距离 + 1
+        int textureId = -1;         // 已分配存储、尚未填满的纹理
+        int rowsUploaded = 0;
+        bool done = false;
+        bool upgrade = false;       // 替换条目中已有的缩小纹理（升级到原始分辨率）
+        PixelUploadRing::Slot staging;  // 像素已写入像素缓冲区时有效，imageData.data 为空
+    };
+    std::vector<PendingUpload> incomingUploads;     // 由 mainThreadMutex 保护
+    std::deque<PendingUpload> pendingUploads;       // 仅主线程访问
+    size_t uploadBudgetBytes = 32ull * 1024 * 1024; // 每帧上传字节预算（当前图片不受限制）
+    double uploadBudgetMs = 4.0;                    // 每帧上传时间预算（毫秒）
+    static constexpr size_t UPLOAD_BAND_BYTES = 4ull * 1024 * 1024;  // 大图按约 4 MB 的行带分批上传
+    TextureUploadStats uploadStats;                 // 仅主线程访问
+    std::atomic<PixelUploadRing*> uploadRing{nullptr};  // 为空时用 nvgCreateImageRGBA 上传
+    TexturePool texturePool;                        // 淘汰的纹理按尺寸复用，仅主线程访问
+    std::atomic<bool> buildMipmaps{true};           // 解码后在工作线程生成缩小层级
+
     NVGcontext* nvgContext;
-    
-    void workerThreadFunc();
-    ImageType detectImageType(const fs::path& path);
-    ImageData loadImageData(const fs::path& path);
-    void createTexturesFromData(const fs::path& path, const ImageData& imageData);
+
+    // 内存预算（字节）
+    size_t gpuBudgetBytes = 512ull * 1024 * 1024;
+    std::atomic<size_t> cpuBudgetBytes{256ull * 1024 * 1024};
+    size_t gpuBytesResident = 0;
+    std::atomic<size_t> cpuBytesPending{0};
+    uint64_t useTick = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+
+    // 当前浏览位置，淘汰时按距离加权
+    size_t focusIndex = 0;
+    size_t focusCount = 0;
+    bool focusCycle = false;
+    static constexpr uint64_t DISTANCE_WEIGHT = 8;  // 距离每远一张相当于多闲置 8 次使用
+
+    // 按显示尺寸解码：长边上限，0 表示原始分辨率
+    std::atomic<int> decodeMaxSide{0};
+    // 单张纹理的长边上限（GL_MAX_TEXTURE_SIZE），0 表示未知
+    std::atomic<int> maxTextureSize{0};
+    // 最新的浏览请求代号，每次 requestImage/cancelRequests 递增
+    std::atomic<uint64_t> requestGeneration{0};
+
+    void decodeJob(const std::string& key, const DecodeScheduler::CancelToken& token);
+    void fullResolutionJob(const std::string& key, const DecodeScheduler::CancelToken& token);
+    void resetFullResolutionRequest(const std::string& key);
+    bool isSuperseded(const std::string& key);
+    ImageData loadImageData(const fs::path& path, int maxSide);
+    void createTexturesFromData(const std::string& key, const ImageData& imageData);
+    bool commitTexture(const std::string& key, const ImageData& imageData, int textureId);
+    static int poolFlags(const ImageData& imageData);
+    void uploadMipChain(int image, const MipChain& mips);
+    bool hasEntry(const std::string& key);
+    bool isEntryLoaded(const std::string& key);
+    size_t uploadPriority(const std::string& key);
+    void processUploads();
+    void releasePendingUploads();
+    bool loadKeySync(const std::string& key, long long index);
+    void submitDecode(const std::string& key, long long index, DecodeScheduler::Priority priority);
+    size_t distanceToFocus(long long index) const;
+    void releaseEntryTextures(TextureCacheData& data);
+    void evictToBudget();
+
+    // 引用计数（由 TextureHandle 调用）
+    friend class TextureHandle;
+    void addRef(const std::string& key);
+    void removeRef(const std::string& key);
+    bool getEntryData(const std::string& key, int& width, int& height, int& frame_count,
+                      std::vector<int>& imageId, std::vector<int>* frameDelays);
+    bool getEntryTextureInfo(const std::string& key, int& textureWidth, int& textureHeight, uint64_t& revision);
+    ImageType getEntryType(const std::string& key);
 
 public:
     TextureCaches(NVGcontext* vg);
     ~TextureCaches();
-    
-    // 处理主线程任务（必须在主线程调用）
+
+    // 统一的缓存键：规范化后的通用格式路径
+    static std::string makeKey(const fs::path& path);
+
+    // 处理主线程任务（必须在主线程调用），并按每帧预算上传解码完成的图片
     void processMainThreadTasks();
-    
+    // 每帧上传预算：超出后剩余的预加载图片留到下一帧，当前图片总是一次上传完
+    void setUploadBudget(size_t bytesPerFrame, double msPerFrame);
+    const TextureUploadStats& getUploadStats() const { return uploadStats; }
+    // 设置像素缓冲区上传环（需在开始解码前设置），工作线程直接把结果写入暂存内存
+    void setUploadRing(PixelUploadRing* ring) { uploadRing.store(ring); }
+    // 空闲纹理池上限（数量和字节），0 表示不复用
+    void setTexturePoolCapacity(size_t maxTextures, size_t maxBytes) { texturePool.setCapacity(maxTextures, maxBytes); }
+    TexturePoolStats getTexturePoolStats() const { return texturePool.getStats(); }
+    // 缩小显示时使用预生成的缩小层级（三线性过滤），显存增加约 1/3
+    void setMipmapsEnabled(bool enable) { buildMipmaps.store(enable); }
+    // 更新纹理的子矩形，data 为整张图像（按整图行宽读取）
+    static bool updateTextureRegion(NVGcontext* vg, int image, int x, int y, int width, int height,
+                                    const unsigned char* data);
+
+    // 句柄接口
+    TextureHandle acquire(const fs::path& path);     // 只增加引用，不触发加载
+    TextureHandle acquireAsync(const fs::path& path, long long index = -1,
+                               DecodeScheduler::Priority priority = DecodeScheduler::VISIBLE);
+    TextureHandle acquireSync(const fs::path& path, long long index = -1);  // 未命中时在主线程解码
+
     bool getImageCacheData(const fs::path& path, int& width, int& height, int& frame_count, std::vector<int>& imageId);
     bool addImageCacheData(const fs::path& path, const TextureCacheData& data);
     bool removeImageCacheData(const fs::path& path);
+    // 文件内容已变化：取消排队的解码并丢弃缓存；仍被引用时返回 false，需先释放引用
+    bool invalidateImage(const fs::path& path);
     void preloadImages(const std::vector<fs::path>& imagePaths);
+    // 按索引预加载，索引用于在当前图片变化时重排解码顺序
+    void preloadImage(const fs::path& path, long long index = -1,
+                      DecodeScheduler::Priority priority = DecodeScheduler::PREFETCH);
+    void cancelPreload(const fs::path& path);
     bool isImageLoaded(const fs::path& path);
+    bool isImageLoading(const fs::path& path);
+
+    /**
+     * @brief 请求显示某张图片（最新请求优先）
+     * @description 以最高优先级在后台解码；之后的 requestImage/cancelRequests 会让本次请求作废，
+     *              尚未完成的解码在下一次取消检查时放弃（JPEG 每行 MCU、PNG 每行像素检查一次）
+     * @return 本次请求的代号
+     */
+    uint64_t requestImage(const fs::path& path, long long index = -1);
+    // 当前图片已可直接显示时调用，使之前的请求作废
+    void cancelRequests();
+    uint64_t getRequestGeneration() const { return requestGeneration.load(); }
     int getImageTexture(const fs::path& path, int frameIndex = 0);
     void cleanup();
-};
\ No newline at end of file
+
+    // 内存预算：超出时按 LRU + 与当前图片的距离淘汰
+    void setMemoryBudget(size_t gpuBytes, size_t cpuBytes);
+    void setFocus(size_t currentIndex, size_t count, bool cycle);
+    TextureCacheStats getStats();
+
+    // 按显示尺寸解码：之后解码的图片长边不超过 maxSide（0 关闭），已缓存的纹理不受影响
+    void setDecodeTarget(int maxSide);
+    int getDecodeTarget() const { return decodeMaxSide.load(); }
+    // 放大查看时在后台按原始分辨率重新解码，上传后替换纹理，持有句柄的控件通过版本号感知；
+    // 完成前继续使用缩小的纹理。条目不存在时返回 false
+    bool requestFullResolution(const fs::path& path);
+    bool isFullResolution(const fs::path& path);
+    // 超过纹理上限的图片会被缩小到上限以内，需要更高分辨率时由 TiledImage 分块显示
+    void setMaxTextureSize(int size) { maxTextureSize = std::max(size, 0); }
+    int getMaxTextureSize() const { return maxTextureSize.load(); }
+};
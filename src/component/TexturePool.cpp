@@ -0,0 +1,91 @@
+#include "TexturePool.h"
+
+TexturePool::TexturePool(NVGcontext* vg, size_t maxTextures, size_t maxBytes)
+    : m_vg(vg), m_maxTextures(maxTextures), m_maxBytes(maxBytes) {
+}
+
+TexturePool::~TexturePool() {
+    clear();
+}
+
+int TexturePool::acquire(int width, int height, int imageFlags, const unsigned char* data) {
+    if (width <= 0 || height <= 0) return -1;
+
+    for (auto it = m_idle.begin(); it != m_idle.end(); ++it) {
+        if (it->width != width || it->height != height || it->flags != imageFlags) continue;
+        int image = it->image;
+        m_idleBytes -= it->bytes;
+        m_idle.erase(it);
+        m_hits++;
+        if (data) {
+            nvgUpdateImage(m_vg, image, data);
+        }
+        return image;
+    }
+
+    m_misses++;
+    return nvgCreateImageRGBA(m_vg, width, height, imageFlags & ~MIPMAPPED, data);
+}
+
+void TexturePool::release(int image, int imageFlags) {
+    if (image == -1) return;
+
+    Entry entry;
+    entry.image = image;
+    entry.flags = imageFlags;
+    nvgImageSize(m_vg, image, &entry.width, &entry.height);
+    entry.bytes = textureBytes(entry.width, entry.height, imageFlags);
+    if (entry.width <= 0 || entry.height <= 0 || m_maxTextures == 0 || entry.bytes > m_maxBytes) {
+        nvgDeleteImage(m_vg, image);
+        m_dropped++;
+        return;
+    }
+
+    m_idle.push_front(entry);
+    m_idleBytes += entry.bytes;
+    m_recycled++;
+    trim();
+}
+
+size_t TexturePool::textureBytes(int width, int height, int imageFlags) {
+    size_t bytes = static_cast<size_t>(width) * height * 4;
+    // 缩小层级合计约为第 0 级的 1/3
+    return (imageFlags & MIPMAPPED) ? bytes + bytes / 3 : bytes;
+}
+
+void TexturePool::setCapacity(size_t maxTextures, size_t maxBytes) {
+    m_maxTextures = maxTextures;
+    m_maxBytes = maxBytes;
+    trim();
+}
+
+void TexturePool::trim() {
+    while (!m_idle.empty() && (m_idle.size() > m_maxTextures || m_idleBytes > m_maxBytes)) {
+        const Entry& victim = m_idle.back();
+        nvgDeleteImage(m_vg, victim.image);
+        m_idleBytes -= victim.bytes;
+        m_idle.pop_back();
+        m_dropped++;
+    }
+}
+
+void TexturePool::clear() {
+    for (const auto& entry : m_idle) {
+        nvgDeleteImage(m_vg, entry.image);
+    }
+    m_idle.clear();
+    m_idleBytes = 0;
+}
+
+TexturePoolStats TexturePool::getStats() const {
+    TexturePoolStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.recycled = m_recycled;
+    stats.dropped = m_dropped;
+    stats.idleTextures = m_idle.size();
+    stats.idleBytes = m_idleBytes;
+    uint64_t total = m_hits + m_misses;
+    stats.hitRate = total > 0 ? static_cast<double>(m_hits) / total : 0.0;
+    return stats;
+}
@@ -0,0 +1,79 @@
+#pragma once
+#include "nanovg.h"
+#include <list>
+#include <cstddef>
+#include <cstdint>
+
+// 纹理池统计
+struct TexturePoolStats {
+    uint64_t hits = 0;            // 复用了空闲纹理
+    uint64_t misses = 0;          // 需要新建纹理
+    uint64_t recycled = 0;        // 放回池中的纹理数
+    uint64_t dropped = 0;         // 超出上限直接删除的纹理数
+    size_t idleTextures = 0;
+    size_t idleBytes = 0;
+    double hitRate = 0.0;
+};
+
+/**
+ * @class TexturePool
+ * @brief 按 (宽, 高, 标志) 复用 nanovg 纹理
+ * @description 同一目录的照片尺寸通常相同，切换图片时把旧纹理放回池中，
+ *              下一张同尺寸图片用 nvgUpdateImage 覆盖内容，避免反复分配显存。
+ *              空闲纹理按最近放回的顺序保存，超过数量或字节上限时删除最久未用的。
+ *              只能在 GL 上下文所在的主线程使用。
+ */
+class TexturePool {
+public:
+    static constexpr size_t DEFAULT_MAX_TEXTURES = 8;
+    static constexpr size_t DEFAULT_MAX_BYTES = 128ull * 1024 * 1024;
+    // 只用于区分池中纹理的标志（不传给 nanovg）：带有预生成缩小层级的纹理
+    static constexpr int MIPMAPPED = 1 << 24;
+
+    explicit TexturePool(NVGcontext* vg, size_t maxTextures = DEFAULT_MAX_TEXTURES,
+                         size_t maxBytes = DEFAULT_MAX_BYTES);
+    ~TexturePool();
+
+    TexturePool(const TexturePool&) = delete;
+    TexturePool& operator=(const TexturePool&) = delete;
+
+    /**
+     * @brief 取得一张 RGBA 纹理
+     * @param data 为空时只保证存储，内容由调用方随后填充
+     * @return nanovg 图像句柄，失败返回 -1
+     */
+    int acquire(int width, int height, int imageFlags, const unsigned char* data);
+
+    // 归还纹理；池已满时直接删除
+    void release(int image, int imageFlags = 0);
+
+    // 设置上限（0 表示不缓存空闲纹理），超出部分立即删除
+    void setCapacity(size_t maxTextures, size_t maxBytes);
+    // 删除所有空闲纹理
+    void clear();
+
+    TexturePoolStats getStats() const;
+
+private:
+    struct Entry {
+        int image = -1;
+        int width = 0;
+        int height = 0;
+        int flags = 0;
+        size_t bytes = 0;
+    };
+
+    static size_t textureBytes(int width, int height, int imageFlags);
+
+    void trim();
+
+    NVGcontext* m_vg = nullptr;
+    size_t m_maxTextures = DEFAULT_MAX_TEXTURES;
+    size_t m_maxBytes = DEFAULT_MAX_BYTES;
+    std::list<Entry> m_idle;      // 最近放回的在前
+    size_t m_idleBytes = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+    uint64_t m_recycled = 0;
+    uint64_t m_dropped = 0;
+};
@@ -0,0 +1,229 @@
+#include "TiledImage.h"
+#include "DecodeScheduler.h"
+#include "../utils/utils.h"
+#include "../utils/stb_image_resize2.h"
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+TiledImage::TiledImage(NVGcontext* vg, const std::string& path) : m_vg(vg), m_path(path) {
+}
+
+TiledImage::~TiledImage() {
+    // 等待正在构建的金字塔结束，之后才能释放内存
+    DecodeScheduler::getInstance().cancelOwner(this, true);
+
+    for (auto& pair : m_tiles) {
+        if (pair.second.image != -1) {
+            nvgDeleteImage(m_vg, pair.second.image);
+        }
+    }
+    m_tiles.clear();
+    releaseLevels();
+}
+
+void TiledImage::releaseLevels() {
+    for (size_t i = 0; i < m_levels.size(); i++) {
+        if (i == 0) {
+            FreeImage(m_levels[i].pixels);
+        } else {
+            free(m_levels[i].pixels);
+        }
+    }
+    m_levels.clear();
+}
+
+void TiledImage::startDecode() {
+    DecodeScheduler::getInstance().submit(this, m_path, -1, DecodeScheduler::VISIBLE,
+        [this](const DecodeScheduler::CancelToken& token) {
+            if (token->load()) return;
+            buildPyramid([&token]() { return token->load(); });
+        },
+        [this]() {
+            m_state.store(FAILED, std::memory_order_release);
+        });
+}
+
+bool TiledImage::takeReadyNotification() {
+    if (m_readyNotified || !isReady()) return false;
+    m_readyNotified = true;
+    return true;
+}
+
+void TiledImage::buildPyramid(const std::function<bool()>& isCancelled) {
+    Timer timer;
+    int channels = 0;
+    Level base;
+    {
+        // 切走后不必等整张大图解码完，析构时也不会长时间阻塞主线程
+        DecodeCancelScope cancelScope(isCancelled);
+        base.pixels = LoadImage(m_path, base.width, base.height, channels);
+    }
+    if (!base.pixels && isCancelled()) {
+        m_state.store(FAILED, std::memory_order_release);
+        return;
+    }
+    if (!base.pixels) {
+        std::cerr << "[TiledImage] Failed to decode: " << m_path << std::endl;
+        m_state.store(FAILED, std::memory_order_release);
+        return;
+    }
+    m_width = base.width;
+    m_height = base.height;
+    m_levels.push_back(base);
+
+    // 每级缩小一半，直到整张图放得进一个分块
+    while (std::max(m_levels.back().width, m_levels.back().height) > TILE_SIZE) {
+        if (isCancelled()) {
+            releaseLevels();
+            m_state.store(FAILED, std::memory_order_release);
+            return;
+        }
+        const Level& prev = m_levels.back();
+        Level next;
+        next.width = std::max(1, (prev.width + 1) / 2);
+        next.height = std::max(1, (prev.height + 1) / 2);
+        next.pixels = stbir_resize_uint8_srgb(prev.pixels, prev.width, prev.height, 0,
+                                              nullptr, next.width, next.height, 0, STBIR_RGBA);
+        if (!next.pixels) {
+            std::cerr << "[TiledImage] Failed to build level " << m_levels.size() << " of " << m_path << std::endl;
+            break;
+        }
+        m_levels.push_back(next);
+    }
+
+    for (auto& level : m_levels) {
+        level.tilesX = (level.width + TILE_SIZE - 1) / TILE_SIZE;
+        level.tilesY = (level.height + TILE_SIZE - 1) / TILE_SIZE;
+    }
+
+    std::cout << "[TiledImage] Built " << m_levels.size() << " levels for " << m_path
+              << " (" << m_width << "x" << m_height << ") in " << timer.elapsed() << std::endl;
+    m_state.store(READY, std::memory_order_release);
+}
+
+int TiledImage::chooseLevel(float screenPixelsPerSourcePixel) const {
+    // 选择分辨率不低于屏幕像素的最粗层级
+    int level = 0;
+    float ratio = screenPixelsPerSourcePixel;
+    while (level + 1 < static_cast<int>(m_levels.size()) && ratio * 2.0f <= 1.0f) {
+        ratio *= 2.0f;
+        level++;
+    }
+    return level;
+}
+
+int TiledImage::uploadTile(int level, int tx, int ty) {
+    const Level& source = m_levels[level];
+    int x0 = tx * TILE_SIZE;
+    int y0 = ty * TILE_SIZE;
+    int tileWidth = std::min(TILE_SIZE, source.width - x0);
+    int tileHeight = std::min(TILE_SIZE, source.height - y0);
+
+    // 分块在层级图像中不连续，逐行拷贝成紧凑数据再上传
+    std::vector<unsigned char> buffer(static_cast<size_t>(tileWidth) * tileHeight * 4);
+    for (int row = 0; row < tileHeight; row++) {
+        const unsigned char* src = source.pixels + (static_cast<size_t>(y0 + row) * source.width + x0) * 4;
+        std::copy(src, src + static_cast<size_t>(tileWidth) * 4, buffer.begin() + static_cast<size_t>(row) * tileWidth * 4);
+    }
+    return nvgCreateImageRGBA(m_vg, tileWidth, tileHeight, 0, buffer.data());
+}
+
+void TiledImage::evictTiles() {
+    while (m_tiles.size() > MAX_RESIDENT_TILES) {
+        auto victim = m_tiles.end();
+        for (auto it = m_tiles.begin(); it != m_tiles.end(); ++it) {
+            if (it->second.lastUsed == m_frame) continue;   // 本帧可见
+            if (victim == m_tiles.end() || it->second.lastUsed < victim->second.lastUsed) {
+                victim = it;
+            }
+        }
+        if (victim == m_tiles.end()) break;
+        if (victim->second.image != -1) {
+            nvgDeleteImage(m_vg, victim->second.image);
+        }
+        m_tiles.erase(victim);
+    }
+}
+
+bool TiledImage::render(NVGcontext* vg, float x, float y, float w, float h,
+                        float viewWidth, float viewHeight, float alpha) {
+    if (!isReady() || m_levels.empty() || w <= 0 || h <= 0) return false;
+    m_frame++;
+
+    // 当前变换下每个局部单位对应的屏幕像素
+    float xform[6], inverse[6];
+    nvgCurrentTransform(vg, xform);
+    float unitScale = std::sqrt(std::fabs(xform[0] * xform[3] - xform[1] * xform[2]));
+    int level = chooseLevel(unitScale * w / m_width);
+    const Level& current = m_levels[level];
+
+    // 视口四角反变换到局部坐标，得到可见区域
+    float visibleX0 = x, visibleY0 = y, visibleX1 = x + w, visibleY1 = y + h;
+    if (viewWidth > 0 && viewHeight > 0 && nvgTransformInverse(inverse, xform)) {
+        const float corners[4][2] = {{0, 0}, {viewWidth, 0}, {0, viewHeight}, {viewWidth, viewHeight}};
+        float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+        for (const auto& corner : corners) {
+            float lx, ly;
+            nvgTransformPoint(&lx, &ly, inverse, corner[0], corner[1]);
+            minX = std::min(minX, lx);
+            minY = std::min(minY, ly);
+            maxX = std::max(maxX, lx);
+            maxY = std::max(maxY, ly);
+        }
+        visibleX0 = std::max(visibleX0, minX);
+        visibleY0 = std::max(visibleY0, minY);
+        visibleX1 = std::min(visibleX1, maxX);
+        visibleY1 = std::min(visibleY1, maxY);
+        if (visibleX0 >= visibleX1 || visibleY0 >= visibleY1) return false;
+    }
+
+    // 可见区域换算成层级像素，再得到分块范围
+    float unitsPerPixelX = w / current.width;
+    float unitsPerPixelY = h / current.height;
+    int tx0 = std::clamp(static_cast<int>((visibleX0 - x) / unitsPerPixelX) / TILE_SIZE, 0, current.tilesX - 1);
+    int ty0 = std::clamp(static_cast<int>((visibleY0 - y) / unitsPerPixelY) / TILE_SIZE, 0, current.tilesY - 1);
+    int tx1 = std::clamp(static_cast<int>((visibleX1 - x) / unitsPerPixelX) / TILE_SIZE, 0, current.tilesX - 1);
+    int ty1 = std::clamp(static_cast<int>((visibleY1 - y) / unitsPerPixelY) / TILE_SIZE, 0, current.tilesY - 1);
+
+    bool pending = false;
+    int uploads = 0;
+    for (int ty = ty0; ty <= ty1; ty++) {
+        for (int tx = tx0; tx <= tx1; tx++) {
+            Tile& tile = m_tiles[tileKey(level, tx, ty)];
+            if (tile.image == -1) {
+                if (uploads >= MAX_UPLOADS_PER_FRAME) {
+                    // 本帧上传额度用完，先显示底图，下一帧继续
+                    pending = true;
+                    continue;
+                }
+                tile.image = uploadTile(level, tx, ty);
+                uploads++;
+                if (tile.image == -1) continue;
+            }
+            tile.lastUsed = m_frame;
+
+            float tileX = x + tx * TILE_SIZE * unitsPerPixelX;
+            float tileY = y + ty * TILE_SIZE * unitsPerPixelY;
+            float tileW = std::min(TILE_SIZE, current.width - tx * TILE_SIZE) * unitsPerPixelX;
+            float tileH = std::min(TILE_SIZE, current.height - ty * TILE_SIZE) * unitsPerPixelY;
+            NVGpaint paint = nvgImagePattern(vg, tileX, tileY, tileW, tileH, 0, tile.image, alpha);
+            nvgBeginPath(vg);
+            nvgRect(vg, tileX, tileY, tileW, tileH);
+            nvgFillPaint(vg, paint);
+            nvgFill(vg);
+        }
+    }
+
+    // 清理未上传成功的空条目后按 LRU 淘汰
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        if (it->second.image == -1 && it->second.lastUsed != m_frame) {
+            it = m_tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    evictTiles();
+    return pending;
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+#include "nanovg.h"
+
+/**
+ * @class TiledImage
+ * @brief 超大图像的分块金字塔
+ * @description 用于超过 GL_MAX_TEXTURE_SIZE 的全景图、扫描件：
+ *              - 工作线程解码原图并逐级缩小一半，生成多分辨率金字塔（只在内存中）
+ *              - 绘制时按当前缩放选择层级，只上传与视口相交的分块
+ *              - 分块纹理按最近使用淘汰，平移时旧分块自然被替换
+ */
+class TiledImage {
+public:
+    static constexpr int TILE_SIZE = 512;
+    static constexpr size_t MAX_RESIDENT_TILES = 192;     // 约 192 MB 显存
+    static constexpr int MAX_UPLOADS_PER_FRAME = 4;        // 每帧最多上传的分块数
+
+    TiledImage(NVGcontext* vg, const std::string& path);
+    ~TiledImage();
+
+    // 禁止拷贝和赋值
+    TiledImage(const TiledImage&) = delete;
+    TiledImage& operator=(const TiledImage&) = delete;
+
+    // 在解码线程池中构建金字塔
+    void startDecode();
+
+    bool isReady() const { return m_state.load(std::memory_order_acquire) == READY; }
+    bool isFailed() const { return m_state.load(std::memory_order_acquire) == FAILED; }
+    // 构建完成后第一次调用返回 true，用于触发重绘
+    bool takeReadyNotification();
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    size_t getResidentTiles() const { return m_tiles.size(); }
+
+    /**
+     * @brief 绘制视口内的分块
+     * @param x,y,w,h 整张图像在当前坐标系中的位置和大小
+     * @param viewWidth,viewHeight 视口大小（屏幕坐标），用于裁剪不可见分块
+     * @return 还有可见分块未上传时返回 true，调用方应继续重绘
+     */
+    bool render(NVGcontext* vg, float x, float y, float w, float h,
+                float viewWidth, float viewHeight, float alpha);
+
+private:
+    enum State { PENDING, READY, FAILED };
+
+    struct Level {
+        int width = 0;
+        int height = 0;
+        int tilesX = 0;
+        int tilesY = 0;
+        unsigned char* pixels = nullptr;   // RGBA
+    };
+
+    struct Tile {
+        int image = -1;
+        uint64_t lastUsed = 0;
+    };
+
+    // isCancelled 在解码过程中和每级之间检查，返回 true 时释放已生成的层级并标记失败
+    void buildPyramid(const std::function<bool()>& isCancelled);
+    void releaseLevels();
+    int chooseLevel(float screenPixelsPerSourcePixel) const;
+    int uploadTile(int level, int tx, int ty);
+    void evictTiles();
+    static uint64_t tileKey(int level, int tx, int ty) {
+        return (static_cast<uint64_t>(level) << 48) | (static_cast<uint64_t>(ty) << 24) | static_cast<uint64_t>(tx);
+    }
+
+    NVGcontext* m_vg;
+    std::string m_path;
+    std::atomic<int> m_state{PENDING};
+    bool m_readyNotified = false;
+
+    // 以下成员由工作线程写入，m_state 变为 READY 后主线程只读
+    int m_width = 0;
+    int m_height = 0;
+    std::vector<Level> m_levels;
+
+    // 仅主线程访问
+    std::unordered_map<uint64_t, Tile> m_tiles;
+    uint64_t m_frame = 0;
+};
@@ -1,9 +1,13 @@
 #include "UITexture.h"
+#include "TiledImage.h"
+#include "GifPlayer.h"
 #include <iostream>
 #include <algorithm>
 #include <cmath>
 
 std::vector<UITexture*> UITexture::s_instances;
+TextureCaches* UITexture::s_textureCache = nullptr;
+std::unique_ptr<TextureCaches> UITexture::s_ownedCache;
 
 UITexture::UITexture(float x, float y, float width, float height, const std::string& imagePath)
     : UIComponent(x, y, width, height)
@@ -31,10 +35,25 @@ UITexture::~UITexture() {
     }
 }
 
-void UITexture::cleanupAll(NVGcontext* vg) {
+void UITexture::cleanupAll() {
     for (auto* texture : s_instances) {
-        texture->unloadImage(vg);
+        texture->unloadImage();
     }
+    // 句柄全部释放后才能销毁控件自建的缓存
+    s_ownedCache.reset();
+}
+
+void UITexture::setTextureCache(TextureCaches* cache) {
+    s_textureCache = cache;
+}
+
+TextureCaches* UITexture::getTextureCache(NVGcontext* vg) {
+    if (s_textureCache) return s_textureCache;
+    // 未指定共享缓存时（如 UITest），按需创建一个
+    if (!s_ownedCache) {
+        s_ownedCache = std::make_unique<TextureCaches>(vg);
+    }
+    return s_ownedCache.get();
 }
 
 void UITexture::render(NVGcontext* vg) {
@@ -54,6 +73,14 @@ void UITexture::render(NVGcontext* vg) {
     if (m_nvgImage == -1) {
         return;
     }
+    // 其他控件可能已让缓存替换了同一图片的纹理
+    if (m_textureHandle.valid()) {
+        int textureWidth, textureHeight;
+        uint64_t revision;
+        if (m_textureHandle.getTextureInfo(textureWidth, textureHeight, revision) && revision != m_textureRevision) {
+            fetchTextureData();
+        }
+    }
 
     // 缩放变换（以中心为原点）#支持中心动画缩放   放在这个位置可以缩放整个texture
     if (m_animationScaleX != 1.0f || m_animationScaleY != 1.0f) {
@@ -100,12 +127,11 @@ void UITexture::render(NVGcontext* vg) {
     // 设置透明度（考虑动画透明度）
     nvgGlobalAlpha(vg, m_alpha * m_animationOpacity);
 
-    if(m_isGif){
-        bool is_cycle = true;
-        playGif(m_currentFrame,m_gifFramesCount,m_frameTimeAccumulator,m_deltaTime, m_gifDelays, is_cycle);
-        m_nvgImage = m_frameTextures[m_currentFrame];
-        m_paintValid= false;
-   
+    if(m_isGif && m_gifPlayer){
+        if (m_gifPlaying) {
+            m_gifPlayer->advance(m_deltaTime * 1000.0);
+        }
+        updateGifFrame();
     }
     if (!m_paintValid ) {
 
@@ -120,6 +146,14 @@ void UITexture::render(NVGcontext* vg) {
     nvgRoundedRect(vg, renderX, renderY, renderW, renderH, m_cornerRadius);
     nvgFillPaint(vg, imgPaint_cache);
     nvgFill(vg);
+
+    // 分块叠加在缩小的纹理上，未上传的分块先由底图顶替
+    if (m_tiledImage && m_tiledImage->isReady()) {
+        if (m_tiledImage->render(vg, renderX, renderY, renderW, renderH,
+                                 m_viewportWidth, m_viewportHeight, 1.0f)) {
+            m_paintValid = false;
+        }
+    }
     
 
     nvgRestore(vg);
@@ -138,6 +172,14 @@ void UITexture::render(NVGcontext* vg) {
 void UITexture::update(double deltaTime) {
     // 纹理控件通常不需要更新逻辑
     m_deltaTime = deltaTime;
+    if (m_tiledImage) {
+        if (m_tiledImage->takeReadyNotification()) {
+            m_paintValid = false;
+        } else if (m_tiledImage->isFailed()) {
+            m_tiledImage.reset();
+            m_tiledFailed = true;
+        }
+    }
 }
 void UITexture::updateSize() {
     // 纹理控件通常不需要更新逻辑
@@ -332,130 +374,150 @@ bool UITexture::loadImage(NVGcontext* vg, const std::string& imagePath) {
     }
     
     // 先卸载之前的图像
-    unloadImage(vg);
-    unsigned char* data = nullptr; // 取消注释，确保初始化data变量
-    // 使用 stb_image 加载图像
-    int channels;
+    unloadImage();
     Timer timer;
-        if(isGifPath(m_imagePath)){
-            //////////////////////////////////    GIF     ///////////////////////////////
-            m_isGif = true;
-            data = loadGifImage(m_imagePath,m_imageWidth, m_imageHeight , channels, m_gifFramesCount,m_gifDelays) ;
-
-            if (!data){
-                std::cerr << "Failed to load image: " << imagePath << std::endl;
-                // std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
-                m_isLoadError = true;
-                return false;
-            }
-           
-            try {
-                // 为每一帧创建纹理
-                for (int i = 0; i < m_gifFramesCount; i++) {
-                    // 计算当前帧的数据指针
-                    size_t frameSize = m_imageWidth * m_imageHeight * channels;
-                    unsigned char* frameData = data + (i * frameSize);
-                    
-                    // 创建当前帧的NanoVG纹理
-                    int textureId = nvgCreateImageRGBA(vg, m_imageWidth, m_imageHeight, 0, frameData);
-                    
-                    if (textureId == -1) {
-                        std::cerr << "Failed to create texture for frame " << i << std::endl;
-                    }
-                    m_frameTextures.push_back(textureId);
-                    // std::cout << "Preloaded frame " << i << " with texture ID: " << textureId << std::endl;
-                }
-                FreeImage(data,imagePath);
-                std::cout << "Successfully preloaded " << m_frameTextures.size() << " frames" << std::endl;
-                { 
-                    // for(auto it :m_gifDelays){
-                    //     std::cout << " delay: " << it << std::endl;
-                    // }
-                }
-                m_currentFrame = 0;
-                m_nvgImage = m_frameTextures[m_currentFrame];
-                // 释放 stb_image 分配的内存
-                 
-                FreeImage(data,imagePath); 
-                m_frameTimeAccumulator =0;
-            } catch (const std::exception& e) {
-                std::cerr << "Exception during frame preloading: " << e.what() << std::endl;
-                // clearFrameTextures(vg);
-                FreeImage(data,imagePath); 
-                return false;
-            }
-        }else{
-            /////////////////////////////     NO GIF    ///////////////////////////////////////////
-            try {
-                m_isGif = false;
-                data = LoadImage(imagePath.c_str(), m_imageWidth,m_imageHeight,  channels);
-                    if (!data){
-                        std::cerr << "Failed to load image: " << imagePath << std::endl;
-                        // std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
-                        m_isLoadError = true;
-                        return false;
-                    }
-                // 创建 NanoVG 图像
-                m_nvgImage = nvgCreateImageRGBA(vg, m_imageWidth, m_imageHeight, 0, data);
-                
-                // 释放 stb_image 分配的内存
-                FreeImage(data,imagePath); 
-            }catch (const std::exception& e) {
-                std::cerr << "Failed to load image:sssss   " << imagePath << " error: " << e.what() << std::endl;
-                FreeImage(data,imagePath); 
-                m_isLoadError = true;
-            return false;
-         }
-        }
+
+    // 解码和上传由缓存引擎完成，同一文件只解码一次
+    TextureCaches* cache = getTextureCache(vg);
+    m_textureHandle = cache->acquireSync(imagePath);
+    if (!fetchTextureData()) {
+        std::cerr << "Failed to load image: " << imagePath << std::endl;
+        m_textureHandle.reset();
+        m_imageWidth = 0;
+        m_imageHeight = 0;
+        m_isLoadError = true;
+        return false;
+    }
+    m_currentFrame = 0;
+    m_frameTimeAccumulator = 0;
+    m_nvgImage = m_frameTextures[m_currentFrame];
+
+    // 格式在解码时已按文件头识别，扩展名错误的 GIF 也能播放，不必再次打开文件
+    if (m_textureHandle.getType() == GIF) {
+        // 封面已经可以显示，其余帧在后台边解码边播放
+        // 文件头在后台读取，打开失败时 updateGifFrame 会释放播放器并停在封面
+        m_gifPlayer = std::make_unique<GifPlayer>(vg, imagePath);
+        m_gifPlayer->start();
+        m_isGif = true;
+        m_gifFramesCount = 0;
+        m_gifDelays.clear();
+    }
 
     m_isLoadError = false;
-    FreeImage(data,imagePath); 
     updateSize();
     setPaintValid(false);
 
     double read_time = timer.elapsed();
     timer.reset();
 
-    if (m_nvgImage == -1) {
-        std::cerr << "Failed to create NanoVG image from: " << imagePath << std::endl;
-        return false;
-    }
-    
     m_imagePath = imagePath;
-    std::cout << "Loaded image: " << imagePath << " (" << m_imageWidth << "x" << m_imageHeight << ")" <<"  channels:"<< channels <<" coding time:"<<read_time<< std::endl;
+    std::cout << "Loaded image: " << imagePath << " (" << m_imageWidth << "x" << m_imageHeight << ")" <<"  frames:"<< m_frameTextures.size() <<" coding time:"<<read_time<< std::endl;
     m_paintValid = false;
     return true;
 } 
 
-// 添加清理GIF帧纹理的实现
-void UITexture::clearFrameTextures(NVGcontext* vg) {
-    if (vg) {
-        for (int textureId : m_frameTextures) {
-            if (textureId != -1) {
-                nvgDeleteImage(vg, textureId);
-                // std::cout << "Deleted frame texture ID: " << textureId << std::endl;
-            }
+void UITexture::updateGifFrame() {
+    if (!m_gifPlayer) return;
+
+    if (m_gifPlayer->isFailed() || (m_gifPlayer->isStatic() && m_gifPlayer->getImage() != -1)) {
+        // 单帧或解码失败：封面就是最终画面，不再每帧重绘
+        m_gifPlayer.reset();
+        m_isGif = false;
+        m_currentFrame = 0;
+        m_nvgImage = m_frameTextures.empty() ? -1 : m_frameTextures[0];
+        m_paintValid = false;
+        return;
+    }
+
+    // 第一帧解码完成前显示缓存中的封面
+    int image = m_gifPlayer->getImage();
+    if (image != -1) {
+        m_nvgImage = image;
+        m_currentFrame = m_gifPlayer->getCurrentFrame();
+    }
+    if (m_gifFramesCount == 0) {
+        int count = m_gifPlayer->getFrameCount();
+        if (count > 0) {
+            m_gifFramesCount = count;
+            m_gifDelays = m_gifPlayer->getDelays();
         }
     }
-    m_frameTextures.clear();
+    m_paintValid = false;
 }
 
-void UITexture::unloadImage(NVGcontext* vg) {
+bool UITexture::fetchTextureData() {
+    int frameCount = 0;
+    if (!m_textureHandle.getData(m_imageWidth, m_imageHeight, frameCount, m_frameTextures, &m_gifDelays)
+        || m_frameTextures.empty()
+        || !m_textureHandle.getTextureInfo(m_textureWidth, m_textureHeight, m_textureRevision)) {
+        m_frameTextures.clear();
+        m_gifDelays.clear();
+        return false;
+    }
 
-    if (m_nvgImage != -1 && vg) {
-        clearFrameTextures(vg);
-        nvgDeleteImage(vg, m_nvgImage);
-        m_nvgImage = -1;
+    if (m_gifPlayer && m_isGif) {
+        // 缓存重建封面不影响正在播放的动画
+        int image = m_gifPlayer->getImage();
+        m_nvgImage = image != -1 ? image : m_frameTextures[0];
+        m_paintValid = false;
+        return true;
     }
+    m_currentFrame = 0;
+    m_nvgImage = m_frameTextures[0];
+    m_paintValid = false;
+    return true;
+}
+
+bool UITexture::isFullResolution() const {
+    return m_tiledImage || (m_textureWidth >= m_imageWidth && m_textureHeight >= m_imageHeight);
+}
+
+bool UITexture::loadFullResolution(NVGcontext* vg) {
+    if (!m_textureHandle.valid() || isFullResolution()) return true;
+
+    TextureCaches* cache = getTextureCache(vg);
+    int textureLimit = cache->getMaxTextureSize();
+    if (!m_isGif && textureLimit > 0 && std::max(m_imageWidth, m_imageHeight) > textureLimit) {
+        if (m_tiledFailed) return false;
+        // 单张纹理放不下：后台构建分块金字塔，完成前继续显示缩小的纹理
+        m_tiledImage = std::make_unique<TiledImage>(vg, m_imagePath);
+        m_tiledImage->startDecode();
+        return true;
+    }
+    // 新纹理上传后版本号变化，render 中重新获取
+    return cache->requestFullResolution(m_imagePath);
+}
+
+float UITexture::getDisplayedImageWidth() const {
+    if (m_imageWidth <= 0 || m_imageHeight <= 0) return 0.0f;
+    float renderX, renderY, renderW, renderH;
+    calculateRenderBounds(renderX, renderY, renderW, renderH);
+    return renderW;
+}
+
+void UITexture::unloadImage() {
+    // 纹理归缓存所有，这里只释放引用
+    m_tiledImage.reset();
+    m_tiledFailed = false;
+    m_gifPlayer.reset();
+    m_isGif = false;
+    m_gifFramesCount = 0;
+    m_gifDelays.clear();
+    m_textureHandle.reset();
+    m_frameTextures.clear();
+    m_nvgImage = -1;
     m_imageWidth = 0;
     m_imageHeight = 0;
+    m_textureWidth = 0;
+    m_textureHeight = 0;
+    m_textureRevision = 0;
 }
 
 void UITexture::setImagePath(NVGcontext* vg, const std::string& imagePath) {
     if (m_imagePath != imagePath) {
 
         // 先释放旧资源
-        unloadImage(vg);
+        unloadImage();
         // 设置新路径
         m_imagePath = imagePath;
         m_needsLoad = !imagePath.empty();
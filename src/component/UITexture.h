@@ -3,7 +3,12 @@
 #include <string>
 #include <functional>
 #include <vector>
+#include <memory>
 #include "../utils/utils.h"
+#include "TextureCacheData.h"
+
+class TiledImage;
+class GifPlayer;
 /**
  * @class UITexture
  * @brief 纹理/图像控件类
@@ -22,7 +27,7 @@ public:
     
     // 纹理特有接口
     bool loadImage(NVGcontext* vg, const std::string& imagePath);
-    void unloadImage(NVGcontext* vg);
+    void unloadImage();
     
     void setImagePath(const std::string& imagePath);
     const std::string& getImagePath() const { return m_imagePath; }
@@ -48,12 +53,25 @@ public:
     int getImageWidth() const { return m_imageWidth; }
     int getImageHeight() const { return m_imageHeight; }
     bool isImageLoaded() const { return m_nvgImage != -1; }
+    // 实际纹理尺寸（按显示尺寸解码时小于图像尺寸）
+    int getTextureWidth() const { return m_textureWidth; }
+    int getTextureHeight() const { return m_textureHeight; }
+    bool isFullResolution() const;
+    // 放大超过纹理分辨率时调用，在后台按原始分辨率重新解码，完成后自动替换；超过 GL 纹理上限时改为分块显示
+    bool loadFullResolution(NVGcontext* vg);
+    // 按当前显示模式绘制时图像的宽度（不含缩放动画）
+    float getDisplayedImageWidth() const;
+    bool isTiled() const { return m_tiledImage != nullptr; }
+    // 视口大小（屏幕坐标），分块显示时用于裁剪不可见分块
+    void setViewportSize(float width, float height) { m_viewportWidth = width; m_viewportHeight = height; }
     
     // 添加带NVGcontext的版本，可以立即释放资源
     void setImagePath(NVGcontext* vg, const std::string& imagePath);
     
-    // 添加静态清理方法
-    static void cleanupAll(NVGcontext* vg);
+    // 添加静态清理方法（同时释放所有缓存句柄）
+    static void cleanupAll();
+    // 指定共享的纹理缓存；未指定时首次加载会创建控件自己的缓存
+    static void setTextureCache(TextureCaches* cache);
     void setPaintValid(bool valid) { m_paintValid = valid; }
     bool isPaintValid(){ return m_paintValid;}
     // 事件回调函数类型定义
@@ -89,7 +107,7 @@ public:
     // GIF动画相关方法
     bool isGif() const { return m_isGif; }
     // bool loadGifImage(NVGcontext* vg, const std::string& path);
-    void updateGifFrame(NVGcontext* vg); 
+    void updateGifFrame();
     // GIF播放控制
     // void playGif() { m_gifPlaying = true; }
     // void pauseGif() { m_gifPlaying = false; }
@@ -100,7 +118,15 @@ public:
 private:
     // 基础纹理属性
     std::string m_imagePath;
-    int m_nvgImage;          // NanoVG 图像句柄
+    int m_nvgImage;          // NanoVG 图像句柄（归缓存所有）
+    TextureHandle m_textureHandle;  // 持有期间纹理不会被缓存淘汰
+    uint64_t m_textureRevision = 0; // 缓存中纹理的版本，变化时重新获取纹理句柄
+    int m_textureWidth = 0;
+    int m_textureHeight = 0;
+    std::unique_ptr<TiledImage> m_tiledImage;  // 超大图放大查看时的分块金字塔
+    bool m_tiledFailed = false;                // 分块构建失败后不再重试，直到切换图片
+    float m_viewportWidth = 0.0f;
+    float m_viewportHeight = 0.0f;
     int m_imageWidth;
     int m_imageHeight;
     ScaleMode m_scaleMode;
@@ -145,8 +171,7 @@ private:
     bool m_gifPlaying = true;
     //存储每一帧的NanoVG纹理ID
     std::vector<int> m_frameTextures;  // 每帧的纹理数组
-    // 添加清理GIF帧纹理
-    void clearFrameTextures(NVGcontext* vg);
+    std::unique_ptr<GifPlayer> m_gifPlayer;  // 动画帧流式解码，缓存中只有第一帧
     // 事件回调
     DragCallback m_onDrag;
     ScrollCallback m_onScroll;
@@ -157,6 +182,10 @@ private:
     
     // 静态实例管理
     static std::vector<UITexture*> s_instances;
+    static TextureCaches* s_textureCache;
+    static std::unique_ptr<TextureCaches> s_ownedCache;
+    static TextureCaches* getTextureCache(NVGcontext* vg);
+    bool fetchTextureData();
     
     // 私有方法
     void calculateRenderBounds(float& renderX, float& renderY, 
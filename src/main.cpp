@@ -434,6 +434,7 @@ int main() {
         window.swapBuffers();
     }
     
+    UITexture::cleanupAll();
     window.cleanup();
     return 0;
 }
@@ -0,0 +1,256 @@
+#include "DecodeBufferPool.h"
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+#endif
+
+namespace {
+
+constexpr uint32_t BLOCK_MAGIC = 0x56494D47;    // "VIMG"
+constexpr size_t HEADER_SIZE = 64;               // 保持返回指针按 64 字节对齐（相对块起点）
+
+struct BlockHeader {
+    uint32_t magic;
+    uint32_t pooled;        // 1: 池中的大块；0: malloc 的小块
+    size_t slabBytes;       // 包含头部的块大小
+    size_t requested;       // 最近一次请求的大小（realloc 时复制这么多）
+};
+static_assert(sizeof(BlockHeader) <= HEADER_SIZE, "BlockHeader too large");
+
+BlockHeader* headerOf(void* ptr) {
+    return reinterpret_cast<BlockHeader*>(static_cast<unsigned char*>(ptr) - HEADER_SIZE);
+}
+
+void* payloadOf(void* base) {
+    return static_cast<unsigned char*>(base) + HEADER_SIZE;
+}
+
+size_t roundUp(size_t value, size_t step) {
+    return (value + step - 1) / step * step;
+}
+
+} // namespace
+
+DecodeBufferPool& DecodeBufferPool::getInstance() {
+    static DecodeBufferPool instance;
+    return instance;
+}
+
+DecodeBufferPool::~DecodeBufferPool() {
+    trim();
+}
+
+size_t DecodeBufferPool::slabBytes(size_t size) {
+    // 16 MB 以内按 2 MB 分级；更大的按约 1.25 倍递增，相近尺寸的图片落在同一级
+    size_t bytes = size + HEADER_SIZE;
+    const size_t linearLimit = 16ull * 1024 * 1024;
+    if (bytes <= linearLimit) return roundUp(bytes, SLAB_ALIGN);
+    size_t slab = linearLimit;
+    while (slab < bytes) {
+        slab = roundUp(slab + slab / 4, SLAB_ALIGN);
+    }
+    return slab;
+}
+
+void* DecodeBufferPool::mapSlab(size_t bytes) {
+#if defined(_WIN32)
+    return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) return nullptr;
+#ifdef MADV_HUGEPAGE
+    // 大块按 2 MB 分配，允许内核用透明大页映射，减少缺页次数
+    madvise(base, bytes, MADV_HUGEPAGE);
+#endif
+    return base;
+#endif
+}
+
+void DecodeBufferPool::unmapSlab(void* base, size_t bytes) {
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(base, 0, MEM_RELEASE);
+#else
+    munmap(base, bytes);
+#endif
+}
+
+void* DecodeBufferPool::allocate(size_t size) {
+    if (size < POOL_THRESHOLD) {
+        void* base = std::malloc(size + HEADER_SIZE);
+        if (!base) return nullptr;
+        BlockHeader* header = static_cast<BlockHeader*>(base);
+        header->magic = BLOCK_MAGIC;
+        header->pooled = 0;
+        header->slabBytes = size + HEADER_SIZE;
+        header->requested = size;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.allocations++;
+        m_stats.smallAllocations++;
+        return payloadOf(base);
+    }
+
+    const size_t wanted = slabBytes(size);
+    void* base = nullptr;
+    size_t bytes = wanted;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.allocations++;
+        // 取同级或稍大（不超过 1.5 倍）的空闲块中最小的一个
+        auto best = m_free.end();
+        for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+            if (it->bytes < wanted || it->bytes > wanted + wanted / 2) continue;
+            if (best == m_free.end() || it->bytes < best->bytes) best = it;
+            if (it->bytes == wanted) break;
+        }
+        if (best != m_free.end()) {
+            base = best->base;
+            bytes = best->bytes;
+            m_stats.cachedBytes -= bytes;
+            m_free.erase(best);
+            m_stats.cachedBlocks = m_free.size();
+            m_stats.poolHits++;
+        }
+    }
+
+    if (!base) {
+        base = mapSlab(bytes);
+        if (!base) {
+            // 缓存的空闲块可能占着地址空间，全部归还后再试一次
+            trim();
+            base = mapSlab(bytes);
+            if (!base) return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.osAllocations++;
+        m_stats.mappedBytes += bytes;
+    }
+
+    BlockHeader* header = static_cast<BlockHeader*>(base);
+    header->magic = BLOCK_MAGIC;
+    header->pooled = 1;
+    header->slabBytes = bytes;
+    header->requested = size;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.liveBytes += bytes;
+    m_stats.peakLiveBytes = std::max(m_stats.peakLiveBytes, m_stats.liveBytes);
+    return payloadOf(base);
+}
+
+void* DecodeBufferPool::reallocate(void* ptr, size_t size) {
+    if (!ptr) return allocate(size);
+    BlockHeader* header = headerOf(ptr);
+    if (header->magic != BLOCK_MAGIC) {
+        std::cerr << "[DecodeBufferPool] realloc of a foreign pointer" << std::endl;
+        return nullptr;
+    }
+
+    // 块内还有空间时原地增长（zlib 输出缓冲区按倍数扩大，这很常见）
+    if (header->pooled && size + HEADER_SIZE <= header->slabBytes) {
+        header->requested = size;
+        return ptr;
+    }
+    if (!header->pooled && size < POOL_THRESHOLD) {
+        void* base = std::realloc(header, size + HEADER_SIZE);
+        if (!base) return nullptr;
+        header = static_cast<BlockHeader*>(base);
+        header->slabBytes = size + HEADER_SIZE;
+        header->requested = size;
+        return payloadOf(base);
+    }
+
+    void* moved = allocate(size);
+    if (!moved) return nullptr;
+    std::memcpy(moved, ptr, std::min(header->requested, size));
+    release(ptr);
+    return moved;
+}
+
+void DecodeBufferPool::release(void* ptr) {
+    if (!ptr) return;
+    BlockHeader* header = headerOf(ptr);
+    if (header->magic != BLOCK_MAGIC) {
+        // 不是本池分配的内存，释放会破坏堆；宁可泄漏
+        std::cerr << "[DecodeBufferPool] free of a foreign pointer" << std::endl;
+        return;
+    }
+    header->magic = 0;
+
+    if (!header->pooled) {
+        std::free(header);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.releases++;
+        return;
+    }
+
+    Block block;
+    block.base = header;
+    block.bytes = header->slabBytes;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.releases++;
+    m_stats.liveBytes -= block.bytes;
+    m_free.push_front(block);
+    m_stats.cachedBytes += block.bytes;
+    m_stats.cachedBlocks = m_free.size();
+    trimTo(m_cacheLimit);
+}
+
+void DecodeBufferPool::trimTo(size_t limit) {
+    while (!m_free.empty() && m_stats.cachedBytes > limit) {
+        const Block& victim = m_free.back();
+        unmapSlab(victim.base, victim.bytes);
+        m_stats.cachedBytes -= victim.bytes;
+        m_stats.mappedBytes -= victim.bytes;
+        m_stats.osReleases++;
+        m_free.pop_back();
+    }
+    m_stats.cachedBlocks = m_free.size();
+}
+
+void DecodeBufferPool::setCacheLimit(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cacheLimit = bytes;
+    trimTo(m_cacheLimit);
+}
+
+void DecodeBufferPool::trim() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    trimTo(0);
+}
+
+DecodeBufferStats DecodeBufferPool::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void DecodeBufferPool::printStats() const {
+    DecodeBufferStats stats = getStats();
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "\n=== Decode Buffer Pool ===" << std::endl;
+    std::cout << "allocations: " << stats.allocations << " (" << stats.poolHits << " reused, "
+              << stats.osAllocations << " new, " << stats.smallAllocations << " small)" << std::endl;
+    std::cout << "live: " << stats.liveBytes / mb << " MB (peak " << stats.peakLiveBytes / mb << " MB), cached: "
+              << stats.cachedBytes / mb << " MB in " << stats.cachedBlocks << " blocks, mapped: "
+              << stats.mappedBytes / mb << " MB, returned to OS: " << stats.osReleases << std::endl;
+    std::cout << "==========================" << std::endl;
+}
+
+void* decodeBufferMalloc(size_t size) {
+    return DecodeBufferPool::getInstance().allocate(size);
+}
+
+void* decodeBufferRealloc(void* ptr, size_t size) {
+    return DecodeBufferPool::getInstance().reallocate(ptr, size);
+}
+
+void decodeBufferFree(void* ptr) {
+    DecodeBufferPool::getInstance().release(ptr);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <list>
+#include <mutex>
+#include <cstddef>
+#include <cstdint>
+
+// 解码缓冲池统计
+struct DecodeBufferStats {
+    uint64_t allocations = 0;       // 所有分配请求
+    uint64_t poolHits = 0;          // 复用缓存块
+    uint64_t osAllocations = 0;     // 向系统申请新块
+    uint64_t smallAllocations = 0;  // 低于阈值、直接 malloc 的分配
+    uint64_t releases = 0;
+    uint64_t osReleases = 0;        // 超出缓存上限、归还系统的块
+    size_t liveBytes = 0;           // 正在使用的大块容量
+    size_t peakLiveBytes = 0;
+    size_t cachedBytes = 0;         // 空闲、等待复用的大块容量
+    size_t cachedBlocks = 0;
+    size_t mappedBytes = 0;         // 向系统申请的大块总量（使用中 + 空闲）
+};
+
+/**
+ * @class DecodeBufferPool
+ * @brief stb_image 解码缓冲区的分级缓存池
+ * @description utils.cpp 通过 STBI_MALLOC / STBI_REALLOC / STBI_FREE 使用本池。
+ *              大于阈值的请求按尺寸分级，直接向系统申请按 2 MB 对齐的内存块（Linux 上提示使用大页），
+ *              释放后留在池中供下一张图片复用，快速翻页时不再反复缺页、RSS 保持平稳；
+ *              空闲块超过上限时归还最久未用的。小块直接使用 malloc。
+ *              每块前有一个头部记录来源和容量，所以本池分配的内存只能用本池释放。
+ */
+class DecodeBufferPool {
+public:
+    static constexpr size_t POOL_THRESHOLD = 1ull * 1024 * 1024;     // 小于该值直接 malloc
+    static constexpr size_t SLAB_ALIGN = 2ull * 1024 * 1024;         // 大页尺寸
+    static constexpr size_t DEFAULT_CACHE_LIMIT = 256ull * 1024 * 1024;
+
+    // 单例模式
+    static DecodeBufferPool& getInstance();
+
+    // 禁止拷贝和赋值
+    DecodeBufferPool(const DecodeBufferPool&) = delete;
+    DecodeBufferPool& operator=(const DecodeBufferPool&) = delete;
+
+    void* allocate(size_t size);
+    void* reallocate(void* ptr, size_t size);
+    void release(void* ptr);
+
+    // 空闲块的缓存上限，0 表示释放后立即归还系统
+    void setCacheLimit(size_t bytes);
+    // 归还所有空闲块
+    void trim();
+
+    DecodeBufferStats getStats() const;
+    void printStats() const;
+
+private:
+    DecodeBufferPool() = default;
+    ~DecodeBufferPool();
+
+    struct Block {
+        void* base = nullptr;
+        size_t bytes = 0;           // 包含头部的映射大小
+    };
+
+    static size_t slabBytes(size_t size);
+    static void* mapSlab(size_t bytes);
+    static void unmapSlab(void* base, size_t bytes);
+    // 调用方需持有 m_mutex
+    void trimTo(size_t limit);
+
+    mutable std::mutex m_mutex;
+    std::list<Block> m_free;        // 最近释放的在前
+    size_t m_cacheLimit = DEFAULT_CACHE_LIMIT;
+    DecodeBufferStats m_stats;
+};
+
+// 供 stb_image 的分配宏使用
+void* decodeBufferMalloc(size_t size);
+void* decodeBufferRealloc(void* ptr, size_t size);
+void decodeBufferFree(void* ptr);
@@ -0,0 +1,479 @@
+#include "DirectoryIndex.h"
+#include "DirectoryScanner.h"
+#include "ImageCatalog.h"
+#include "FileBuffer.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+// 索引文件布局：文件头 | 目录记录 | 图片记录 | 字符串区（根目录路径在最前）
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t directoryCount;
+    uint32_t imageCount;
+    uint64_t stringBytes;
+    uint32_t rootLength;
+    uint32_t reserved;
+};
+
+struct DiskDirectory {
+    uint32_t keyOffset;
+    uint32_t keyLength;
+    int64_t mtime;
+    uint32_t firstImage;
+    uint32_t imageCount;
+};
+
+struct DiskImage {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    int32_t width;
+    int32_t height;
+    int32_t orientation;
+    uint32_t reserved;
+    int64_t mtime;
+    uint64_t size;
+};
+
+static_assert(sizeof(FileHeader) == 32, "unexpected FileHeader layout");
+static_assert(sizeof(DiskDirectory) == 24, "unexpected DiskDirectory layout");
+static_assert(sizeof(DiskImage) == 40, "unexpected DiskImage layout");
+
+constexpr char INDEX_MAGIC[4] = {'V', 'I', 'D', 'X'};
+
+std::string normalizedRoot(const fs::path& root) {
+    std::error_code ec;
+    fs::path absolute = fs::absolute(root, ec);
+    std::string key = (ec ? root : absolute).lexically_normal().generic_u8string();
+    while (key.size() > 1 && key.back() == '/') key.pop_back();
+    return key;
+}
+
+uint64_t hashString(const std::string& text) {
+    // FNV-1a
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char c : text) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int64_t DirectoryIndex::toTicks(fs::file_time_type time) {
+    return static_cast<int64_t>(time.time_since_epoch().count());
+}
+
+fs::path DirectoryIndex::cacheDirectory() {
+#if defined(_WIN32)
+    if (const char* local = std::getenv("LOCALAPPDATA"); local && *local) {
+        return fs::path(local) / "Vimag" / "index";
+    }
+#else
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return fs::path(xdg) / "vimag" / "index";
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return fs::path(home) / ".cache" / "vimag" / "index";
+    }
+#endif
+    std::error_code ec;
+    fs::path temp = fs::temp_directory_path(ec);
+    return (ec ? fs::path(".") : temp) / "vimag-index";
+}
+
+fs::path DirectoryIndex::indexFileFor(const fs::path& root) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.vidx", static_cast<unsigned long long>(hashString(normalizedRoot(root))));
+    return cacheDirectory() / name;
+}
+
+bool DirectoryIndex::isOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_open;
+}
+
+std::string DirectoryIndex::relativeKey(const fs::path& directory) const {
+    std::string key = directory.lexically_normal().lexically_relative(m_root.lexically_normal()).generic_u8string();
+    if (key == ".") key.clear();
+    return key;
+}
+
+fs::path DirectoryIndex::directoryPath(const std::string& key) const {
+    return key.empty() ? m_root : m_root / fs::u8path(key);
+}
+
+bool DirectoryIndex::open(const fs::path& root, int threads) {
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) return false;
+
+    if (load(root)) {
+        refresh();
+        return true;
+    }
+
+    // 没有可用的索引：并行完整扫描一次
+    auto start = std::chrono::steady_clock::now();
+    reset(root);
+    ImageCatalog images;
+    std::mutex imagesMutex;
+    DirectoryScanner scanner;
+    scanner.setDirectoryCallback([this](const fs::path& directory) { recordDirectory(directory); });
+    if (scanner.start(root, [&](std::vector<fs::path>&& batch) {
+            std::lock_guard<std::mutex> lock(imagesMutex);
+            for (const auto& path : batch) images.add(path);
+        }, nullptr, threads)) {
+        scanner.wait();
+    }
+    assign(images);
+    std::cout << "[DirectoryIndex] built index for " << root << ": " << images.size() << " images in "
+              << elapsedMs(start) << " ms" << std::endl;
+    return true;
+}
+
+bool DirectoryIndex::load(const fs::path& root) {
+    auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_root = root;
+    m_rootKey = normalizedRoot(root);
+    m_directories.clear();
+    m_recorded.clear();
+    m_open = false;
+    m_dirty = false;
+
+    const fs::path indexPath = indexFileFor(root);
+    std::error_code ec;
+    if (!fs::is_regular_file(indexPath, ec)) return false;
+    FileBuffer file;
+    // 索引只会被改名替换，映射后不会被截断
+    if (!file.open(indexPath.string(), FileBuffer::Access::Map)) return false;
+
+    const unsigned char* data = file.data();
+    const size_t size = file.size();
+    FileHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC)) != 0 || header.version != FORMAT_VERSION) {
+        std::cerr << "[DirectoryIndex] ignoring incompatible index " << indexPath << std::endl;
+        return false;
+    }
+
+    const size_t directoriesOffset = sizeof(FileHeader);
+    const size_t imagesOffset = directoriesOffset + size_t(header.directoryCount) * sizeof(DiskDirectory);
+    const size_t stringsOffset = imagesOffset + size_t(header.imageCount) * sizeof(DiskImage);
+    if (header.stringBytes > size || stringsOffset + header.stringBytes != size) {
+        std::cerr << "[DirectoryIndex] ignoring truncated index " << indexPath << std::endl;
+        return false;
+    }
+    const char* strings = reinterpret_cast<const char*>(data + stringsOffset);
+    auto readString = [&](uint32_t offset, uint32_t length, std::string& out) {
+        if (uint64_t(offset) + length > header.stringBytes) return false;
+        out.assign(strings + offset, length);
+        return true;
+    };
+
+    // 哈希冲突或索引来自其他目录
+    std::string storedRoot;
+    if (!readString(0, header.rootLength, storedRoot) || storedRoot != m_rootKey) return false;
+
+    for (uint32_t i = 0; i < header.directoryCount; ++i) {
+        DiskDirectory disk;
+        std::memcpy(&disk, data + directoriesOffset + size_t(i) * sizeof(DiskDirectory), sizeof(disk));
+        std::string key;
+        if (!readString(disk.keyOffset, disk.keyLength, key) ||
+            uint64_t(disk.firstImage) + disk.imageCount > header.imageCount) {
+            m_directories.clear();
+            return false;
+        }
+        DirectoryRecord& record = m_directories[key];
+        record.mtime = disk.mtime;
+        record.images.resize(disk.imageCount);
+        for (uint32_t j = 0; j < disk.imageCount; ++j) {
+            DiskImage image;
+            std::memcpy(&image, data + imagesOffset + size_t(disk.firstImage + j) * sizeof(DiskImage), sizeof(image));
+            ImageRecord& target = record.images[j];
+            if (!readString(image.nameOffset, image.nameLength, target.name)) {
+                m_directories.clear();
+                return false;
+            }
+            target.info.mtime = image.mtime;
+            target.info.size = image.size;
+            target.info.width = image.width;
+            target.info.height = image.height;
+            target.info.orientation = image.orientation;
+        }
+    }
+
+    m_open = true;
+    std::cout << "[DirectoryIndex] loaded " << header.imageCount << " images in " << header.directoryCount
+              << " directories from " << indexPath << " in " << elapsedMs(start) << " ms" << std::endl;
+    return true;
+}
+
+bool DirectoryIndex::refresh() {
+    auto start = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_open) return false;
+
+    std::vector<std::string> stale;
+    std::vector<std::string> missing;
+    for (const auto& [key, record] : m_directories) {
+        std::error_code ec;
+        auto time = fs::last_write_time(directoryPath(key), ec);
+        if (ec) {
+            missing.push_back(key);
+        } else if (toTicks(time) != record.mtime) {
+            stale.push_back(key);
+        }
+    }
+
+    for (const auto& key : missing) {
+        m_directories.erase(key);
+        // 目录被删除时父目录的修改时间也会变化；读取失败的情况同样重新列出父目录，不会永久丢失
+        if (!key.empty()) {
+            auto slash = key.find_last_of('/');
+            std::string parent = slash == std::string::npos ? std::string() : key.substr(0, slash);
+            if (m_directories.count(parent) && std::find(stale.begin(), stale.end(), parent) == stale.end()) {
+                stale.push_back(parent);
+            }
+        }
+    }
+
+    std::vector<std::string> added;
+    size_t rescanned = 0;
+    for (const auto& key : stale) {
+        if (!m_directories.count(key)) continue;
+        rescanDirectory(key, added);
+        rescanned++;
+    }
+    // 新出现的子目录递归加入
+    while (!added.empty()) {
+        std::string key = std::move(added.back());
+        added.pop_back();
+        rescanDirectory(key, added);
+        rescanned++;
+    }
+
+    const bool changed = rescanned > 0 || !missing.empty();
+    if (changed) m_dirty = true;
+    std::cout << "[DirectoryIndex] checked " << m_directories.size() << " directories, rescanned " << rescanned
+              << ", removed " << missing.size() << " in " << elapsedMs(start) << " ms" << std::endl;
+    return changed;
+}
+
+void DirectoryIndex::rescanDirectory(const std::string& key, std::vector<std::string>& added) {
+    const fs::path directory = directoryPath(key);
+    DirectoryRecord& record = m_directories[key];
+
+    // 先记录修改时间再列出内容，列出期间发生的变化下次仍能发现
+    std::error_code ec;
+    auto time = fs::last_write_time(directory, ec);
+    record.mtime = ec ? 0 : toTicks(time);
+
+    std::vector<ImageRecord> previous = std::move(record.images);
+    record.images.clear();
+
+    fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec);
+    if (ec) return;
+    for (fs::directory_iterator end; it != end; it.increment(ec)) {
+        if (ec) break;
+        const fs::directory_entry& entry = *it;
+        std::error_code typeError;
+        if (entry.is_directory(typeError)) {
+            if (!entry.is_symlink(typeError)) {
+                std::string name = entry.path().filename().generic_u8string();
+                std::string child = key.empty() ? name : key + "/" + name;
+                if (!m_directories.count(child)) added.push_back(std::move(child));
+            }
+            continue;
+        }
+        if (DirectoryScanner::isImageExtension(entry.path()) && entry.is_regular_file(typeError)) {
+            ImageRecord image;
+            image.name = entry.path().filename().u8string();
+            // 沿用已记录的信息，使用方按修改时间和大小判断是否仍然有效
+            auto old = std::lower_bound(previous.begin(), previous.end(), image.name,
+                                        [](const ImageRecord& r, const std::string& name) { return r.name < name; });
+            if (old != previous.end() && old->name == image.name) image.info = old->info;
+            record.images.push_back(std::move(image));
+        }
+    }
+    std::sort(record.images.begin(), record.images.end(),
+              [](const ImageRecord& a, const ImageRecord& b) { return a.name < b.name; });
+}
+
+void DirectoryIndex::reset(const fs::path& root) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_root = root;
+    m_rootKey = normalizedRoot(root);
+    m_directories.clear();
+    m_recorded.clear();
+    m_open = false;
+    m_dirty = false;
+}
+
+void DirectoryIndex::recordDirectory(const fs::path& directory) {
+    std::error_code ec;
+    auto time = fs::last_write_time(directory, ec);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_recorded.emplace_back(directory, ec ? 0 : toTicks(time));
+}
+
+void DirectoryIndex::assign(const ImageCatalog& images) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directories.clear();
+    for (const auto& [directory, mtime] : m_recorded) {
+        m_directories[relativeKey(directory)].mtime = mtime;
+    }
+    m_recorded.clear();
+
+    // 图片列表中的目录已经去重，每个目录只计算一次相对路径
+    std::vector<DirectoryRecord*> records(images.directoryCount(), nullptr);
+    for (size_t i = 0; i < images.size(); ++i) {
+        DirectoryRecord*& record = records[images.directoryId(i)];
+        if (!record) {
+            record = &m_directories[relativeKey(fs::u8path(images.directoryString(images.directoryId(i))))];
+        }
+        ImageRecord image;
+        image.name = std::string(images.name(i));
+        record->images.push_back(std::move(image));
+    }
+    for (auto& [key, record] : m_directories) {
+        std::sort(record.images.begin(), record.images.end(),
+                  [](const ImageRecord& a, const ImageRecord& b) { return a.name < b.name; });
+    }
+    m_open = true;
+    m_dirty = true;
+}
+
+bool DirectoryIndex::save() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_open || !m_dirty) return true;
+
+    std::string strings = m_rootKey;
+    std::vector<DiskDirectory> directories;
+    std::vector<DiskImage> images;
+    directories.reserve(m_directories.size());
+    for (const auto& [key, record] : m_directories) {
+        DiskDirectory disk{};
+        disk.keyOffset = static_cast<uint32_t>(strings.size());
+        disk.keyLength = static_cast<uint32_t>(key.size());
+        disk.mtime = record.mtime;
+        disk.firstImage = static_cast<uint32_t>(images.size());
+        disk.imageCount = static_cast<uint32_t>(record.images.size());
+        strings += key;
+        for (const auto& image : record.images) {
+            DiskImage diskImage{};
+            diskImage.nameOffset = static_cast<uint32_t>(strings.size());
+            diskImage.nameLength = static_cast<uint32_t>(image.name.size());
+            diskImage.width = image.info.width;
+            diskImage.height = image.info.height;
+            diskImage.orientation = image.info.orientation;
+            diskImage.mtime = image.info.mtime;
+            diskImage.size = image.info.size;
+            strings += image.name;
+            images.push_back(diskImage);
+        }
+        directories.push_back(disk);
+    }
+    if (strings.size() > UINT32_MAX) {
+        std::cerr << "[DirectoryIndex] index too large, not saved" << std::endl;
+        return false;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.directoryCount = static_cast<uint32_t>(directories.size());
+    header.imageCount = static_cast<uint32_t>(images.size());
+    header.stringBytes = strings.size();
+    header.rootLength = static_cast<uint32_t>(m_rootKey.size());
+
+    std::error_code ec;
+    fs::create_directories(cacheDirectory(), ec);
+    const fs::path indexPath = indexFileFor(m_root);
+    fs::path tempPath = indexPath;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(directories.data()), directories.size() * sizeof(DiskDirectory));
+        out.write(reinterpret_cast<const char*>(images.data()), images.size() * sizeof(DiskImage));
+        out.write(strings.data(), strings.size());
+        if (!out) {
+            std::cerr << "[DirectoryIndex] failed to write " << tempPath << std::endl;
+            out.close();
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+    // 写完再替换，异常退出时不会留下半个索引
+    fs::rename(tempPath, indexPath, ec);
+    if (ec) {
+        std::cerr << "[DirectoryIndex] failed to replace " << indexPath << ": " << ec.message() << std::endl;
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
+
+void DirectoryIndex::getImages(ImageCatalog& images) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t total = 0;
+    for (const auto& entry : m_directories) total += entry.second.images.size();
+    images.clear();
+    images.reserve(total);
+    for (const auto& [key, record] : m_directories) {
+        if (record.images.empty()) continue;
+        const uint32_t directory = images.addDirectory(directoryPath(key).generic_u8string());
+        for (const auto& image : record.images) {
+            size_t index = images.add(directory, image.name);
+            if (image.info.width > 0) images.setMetadata(index, image.info);
+        }
+    }
+    images.sort();
+}
+
+DirectoryIndex::ImageRecord* DirectoryIndex::findRecord(const fs::path& path) {
+    auto directory = m_directories.find(relativeKey(path.parent_path()));
+    if (directory == m_directories.end()) return nullptr;
+    const std::string name = path.filename().u8string();
+    auto& images = directory->second.images;
+    auto it = std::lower_bound(images.begin(), images.end(), name,
+                               [](const ImageRecord& r, const std::string& n) { return r.name < n; });
+    if (it == images.end() || it->name != name) return nullptr;
+    return &*it;
+}
+
+bool DirectoryIndex::getImageInfo(const fs::path& path, ImageIndexInfo& info) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const ImageRecord* record = const_cast<DirectoryIndex*>(this)->findRecord(path);
+    if (!record) return false;
+    info = record->info;
+    return true;
+}
+
+void DirectoryIndex::setImageInfo(const fs::path& path, const ImageIndexInfo& info) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ImageRecord* record = findRecord(path);
+    if (!record) return;
+    const ImageIndexInfo& old = record->info;
+    if (old.mtime == info.mtime && old.size == info.size && old.width == info.width &&
+        old.height == info.height && old.orientation == info.orientation) {
+        return;
+    }
+    record->info = info;
+    m_dirty = true;
+}
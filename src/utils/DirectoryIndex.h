@@ -0,0 +1,100 @@
+#pragma once
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+class ImageCatalog;
+
+// 索引中单张图片的附加信息（未知的字段为 0）
+struct ImageIndexInfo {
+    int64_t mtime = 0;          // 记录信息时文件的修改时间
+    uint64_t size = 0;          // 记录信息时的文件大小
+    int width = 0;
+    int height = 0;
+    int orientation = 0;        // EXIF 旋转角度
+};
+
+/**
+ * @class DirectoryIndex
+ * @brief 目录扫描结果的持久化索引
+ * @description 每个根目录一个二进制索引文件，保存在用户缓存目录下（文件名是根目录路径的哈希）。
+ *              索引按目录记录修改时间和其中的图片（相对路径、修改时间、大小、尺寸、旋转）。
+ *              再次打开时映射索引文件一次读入，只比较各目录的修改时间：
+ *              未变化的目录直接沿用，变化的目录单独重新列出，新出现的子目录递归加入，
+ *              大目录重新打开时不必再遍历整棵目录树。
+ */
+class DirectoryIndex {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+
+    DirectoryIndex() = default;
+
+    DirectoryIndex(const DirectoryIndex&) = delete;
+    DirectoryIndex& operator=(const DirectoryIndex&) = delete;
+
+    /**
+     * @brief 读取并校验 root 的索引；没有可用索引时完整扫描一次
+     * @return root 不是目录时返回 false
+     */
+    bool open(const fs::path& root, int threads = 0);
+
+    // 读取已保存的索引（不校验目录是否变化），没有或已损坏返回 false
+    bool load(const fs::path& root);
+    // 按目录修改时间校验并增量更新，返回索引内容是否有变化
+    bool refresh();
+
+    // 清空索引并设置根目录，准备接收一次完整扫描的结果
+    void reset(const fs::path& root);
+    // 作为 DirectoryScanner 的目录回调，记录目录读取前的修改时间（线程安全）
+    void recordDirectory(const fs::path& directory);
+    // 用完整扫描找到的图片替换索引内容（目录来自 recordDirectory）
+    void assign(const ImageCatalog& images);
+
+    // 有未保存的修改时写入索引文件
+    bool save();
+
+    bool isOpen() const;
+    const fs::path& getRoot() const { return m_root; }
+
+    // 取出全部图片（按路径排序）
+    void getImages(ImageCatalog& images) const;
+
+    bool getImageInfo(const fs::path& path, ImageIndexInfo& info) const;
+    // 更新图片信息，内容不变时不会标记为需要保存
+    void setImageInfo(const fs::path& path, const ImageIndexInfo& info);
+
+    // 索引文件所在目录
+    static fs::path cacheDirectory();
+    static fs::path indexFileFor(const fs::path& root);
+    // 文件系统时间转为可比较的整数
+    static int64_t toTicks(fs::file_time_type time);
+
+private:
+    struct ImageRecord {
+        std::string name;       // 文件名（UTF-8）
+        ImageIndexInfo info;
+    };
+    struct DirectoryRecord {
+        int64_t mtime = 0;
+        std::vector<ImageRecord> images;
+    };
+
+    // 调用方需持有 m_mutex
+    std::string relativeKey(const fs::path& directory) const;
+    fs::path directoryPath(const std::string& key) const;
+    ImageRecord* findRecord(const fs::path& path);
+    void rescanDirectory(const std::string& key, std::vector<std::string>& added);
+
+    mutable std::mutex m_mutex;
+    fs::path m_root;
+    std::string m_rootKey;                               // 规范化的绝对路径，用于校验索引文件
+    std::map<std::string, DirectoryRecord> m_directories; // 键为相对根目录的路径，"" 表示根目录
+    std::vector<std::pair<fs::path, int64_t>> m_recorded; // 完整扫描期间记录的目录
+    bool m_open = false;
+    bool m_dirty = false;
+};
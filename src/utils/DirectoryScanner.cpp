@@ -0,0 +1,213 @@
+#include "DirectoryScanner.h"
+#include "utils.h"
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <type_traits>
+
+DirectoryScanner::~DirectoryScanner() {
+    cancel();
+    wait();
+}
+
+bool DirectoryScanner::isImageExtension(const fs::path& path) {
+    // 直接比较扩展名，避免为每个文件复制并转换整个字符串
+    const auto& native = path.native();
+    auto dot = native.find_last_of(static_cast<fs::path::value_type>('.'));
+    if (dot == fs::path::string_type::npos) return false;
+    const size_t length = native.size() - dot;
+    if (length < 4 || length > 5) return false;
+
+    std::string ext;
+    ext.reserve(length);
+    for (size_t i = dot; i < native.size(); ++i) {
+        auto c = native[i];
+        // Linux 上 value_type 是有符号的 char，按无符号比较才能排除非 ASCII 字符
+        if (static_cast<std::make_unsigned_t<fs::path::value_type>>(c) > 0x7F) return false;
+        ext.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    return imageExtensions.count(ext) > 0;
+}
+
+bool DirectoryScanner::start(const fs::path& root, BatchCallback onBatch, DoneCallback onDone,
+                             int threads, size_t batchSize) {
+    if (m_running.load()) return false;
+    wait();
+
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) {
+        std::cerr << "[DirectoryScanner] Not a directory: " << root << std::endl;
+        return false;
+    }
+
+    if (threads <= 0) {
+        threads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 4, 16);
+    }
+    m_onBatch = std::move(onBatch);
+    m_onDone = std::move(onDone);
+    m_batchSize = std::max<size_t>(batchSize, 1);
+    m_cancelled = false;
+    m_directories = 0;
+    m_files = 0;
+    m_images = 0;
+    m_batches = 0;
+    m_steals = 0;
+    m_startTime = std::chrono::steady_clock::now();
+
+    m_queues.clear();
+    for (int i = 0; i < threads; ++i) {
+        m_queues.push_back(std::make_unique<WorkQueue>());
+    }
+    m_pendingDirectories = 1;
+    m_queues[0]->directories.push_back(root);
+
+    m_running = true;
+    m_activeWorkers = static_cast<size_t>(threads);
+    for (int i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&DirectoryScanner::workerLoop, this, static_cast<size_t>(i));
+    }
+    return true;
+}
+
+void DirectoryScanner::cancel() {
+    m_cancelled = true;
+    m_idleCondition.notify_all();
+}
+
+void DirectoryScanner::wait() {
+    for (auto& thread : m_threads) {
+        if (thread.joinable()) thread.join();
+    }
+    m_threads.clear();
+}
+
+void DirectoryScanner::pushDirectory(size_t self, fs::path directory) {
+    m_pendingDirectories++;
+    {
+        std::lock_guard<std::mutex> lock(m_queues[self]->mutex);
+        m_queues[self]->directories.push_back(std::move(directory));
+    }
+    m_idleCondition.notify_one();
+}
+
+bool DirectoryScanner::popDirectory(size_t self, fs::path& directory) {
+    // 先处理自己最近发现的目录（深度优先，局部性好）
+    {
+        WorkQueue& own = *m_queues[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.directories.empty()) {
+            directory = std::move(own.directories.back());
+            own.directories.pop_back();
+            return true;
+        }
+    }
+    // 从其他线程的队首窃取（较浅的目录，通常包含更多子目录）
+    for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+        WorkQueue& victim = *m_queues[(self + offset) % m_queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.directories.empty()) {
+            directory = std::move(victim.directories.front());
+            victim.directories.pop_front();
+            m_steals++;
+            return true;
+        }
+    }
+    return false;
+}
+
+void DirectoryScanner::scanDirectory(size_t self, const fs::path& directory, std::vector<fs::path>& found) {
+    std::error_code ec;
+    if (m_onDirectory) m_onDirectory(directory);
+    fs::directory_iterator it(directory, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        std::cerr << "跳过无法访问的目录: " << directory << " (" << ec.message() << ")" << std::endl;
+        return;
+    }
+    m_directories++;
+
+    for (fs::directory_iterator end; it != end && !m_cancelled.load(); it.increment(ec)) {
+        if (ec) break;
+        const fs::directory_entry& entry = *it;
+        std::error_code typeError;
+        // 目录项自带类型时不需要额外的 stat；不跟随指向目录的符号链接，避免循环
+        if (entry.is_directory(typeError)) {
+            if (!entry.is_symlink(typeError)) {
+                pushDirectory(self, entry.path());
+            }
+            continue;
+        }
+        m_files++;
+        if (isImageExtension(entry.path()) && entry.is_regular_file(typeError)) {
+            found.push_back(entry.path());
+            if (found.size() >= m_batchSize) publish(found);
+        }
+    }
+    if (ec) {
+        std::cerr << "跳过无法读取的目录项: " << directory << " (" << ec.message() << ")" << std::endl;
+    }
+}
+
+void DirectoryScanner::publish(std::vector<fs::path>& found) {
+    if (found.empty()) return;
+    m_images += found.size();
+    m_batches++;
+    if (m_onBatch && !m_cancelled.load()) {
+        m_onBatch(std::move(found));
+    }
+    found.clear();
+}
+
+void DirectoryScanner::workerLoop(size_t self) {
+    std::vector<fs::path> found;
+    fs::path directory;
+
+    while (!m_cancelled.load()) {
+        if (popDirectory(self, directory)) {
+            scanDirectory(self, directory, found);
+            // 每个目录扫描完就交出结果，大目录中途按批次交出
+            if (!found.empty()) publish(found);
+            if (--m_pendingDirectories == 0) {
+                m_idleCondition.notify_all();
+                break;
+            }
+            continue;
+        }
+        if (m_pendingDirectories.load() == 0) break;
+
+        // 暂时没有可窃取的目录：等待其他线程发现新目录
+        std::unique_lock<std::mutex> lock(m_idleMutex);
+        m_idleCondition.wait_for(lock, std::chrono::milliseconds(5));
+    }
+
+    publish(found);
+    if (--m_activeWorkers == 0) {
+        DirectoryScanStats stats;
+        stats.directories = m_directories.load();
+        stats.files = m_files.load();
+        stats.images = m_images.load();
+        stats.batches = m_batches.load();
+        stats.steals = m_steals.load();
+        stats.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_startTime).count();
+        stats.cancelled = m_cancelled.load();
+        std::cout << "[DirectoryScanner] " << stats.images << " images in " << stats.directories << " directories ("
+                  << stats.files << " files, " << stats.steals << " steals) in " << stats.elapsedMs << " ms"
+                  << (stats.cancelled ? " (cancelled)" : "") << std::endl;
+        m_running = false;
+        if (m_onDone) m_onDone(stats);
+    }
+}
+
+std::vector<fs::path> DirectoryScanner::scan(const fs::path& root, int threads) {
+    std::vector<fs::path> result;
+    std::mutex mutex;
+    DirectoryScanner scanner;
+    if (!scanner.start(root, [&](std::vector<fs::path>&& batch) {
+            std::lock_guard<std::mutex> lock(mutex);
+            result.insert(result.end(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+        }, nullptr, threads)) {
+        return result;
+    }
+    scanner.wait();
+    std::sort(result.begin(), result.end());
+    return result;
+}
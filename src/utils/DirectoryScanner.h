@@ -0,0 +1,104 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <filesystem>
+#include <chrono>
+
+namespace fs = std::filesystem;
+
+// 扫描统计
+struct DirectoryScanStats {
+    size_t directories = 0;
+    size_t files = 0;
+    size_t images = 0;
+    size_t batches = 0;
+    size_t steals = 0;          // 从其他线程的队列取走的目录数
+    double elapsedMs = 0.0;
+    bool cancelled = false;
+};
+
+/**
+ * @class DirectoryScanner
+ * @brief 并行递归扫描目录中的图片
+ * @description 每个线程维护自己的目录队列：新发现的子目录放入自己的队尾并优先处理，
+ *              队列空了从其他线程的队首窃取，深层目录和慢速网络共享都能分摊到所有线程。
+ *              找到的图片按批次交给回调（通常每个目录一批），调用方可以边扫描边使用结果。
+ *              只看目录项自带的类型信息和扩展名，不再为每个文件单独查询文件状态。
+ */
+class DirectoryScanner {
+public:
+    using BatchCallback = std::function<void(std::vector<fs::path>&& batch)>;
+    using DoneCallback = std::function<void(const DirectoryScanStats& stats)>;
+    using DirectoryCallback = std::function<void(const fs::path& directory)>;
+
+    static constexpr size_t DEFAULT_BATCH_SIZE = 256;
+
+    DirectoryScanner() = default;
+    ~DirectoryScanner();
+
+    DirectoryScanner(const DirectoryScanner&) = delete;
+    DirectoryScanner& operator=(const DirectoryScanner&) = delete;
+
+    /**
+     * @brief 开始后台扫描
+     * @param onBatch 在扫描线程中调用，需自行加锁
+     * @param onDone 扫描结束或被取消后调用一次（在扫描线程中）
+     * @param threads 线程数，0 表示按 CPU 核数（网络共享以等待 IO 为主，至少 4 个）
+     */
+    bool start(const fs::path& root, BatchCallback onBatch, DoneCallback onDone = nullptr,
+               int threads = 0, size_t batchSize = DEFAULT_BATCH_SIZE);
+    void cancel();
+    // 等待所有扫描线程结束
+    void wait();
+    bool isRunning() const { return m_running.load(); }
+    // 每个目录开始读取前调用（在扫描线程中，需自行加锁），须在 start 之前设置
+    void setDirectoryCallback(DirectoryCallback onDirectory) { m_onDirectory = std::move(onDirectory); }
+
+    /**
+     * @brief 同步扫描并返回全部图片（按路径排序）
+     */
+    static std::vector<fs::path> scan(const fs::path& root, int threads = 0);
+
+    // 扩展名是否为支持的图片格式（不区分大小写）
+    static bool isImageExtension(const fs::path& path);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<fs::path> directories;
+    };
+
+    void workerLoop(size_t self);
+    bool popDirectory(size_t self, fs::path& directory);
+    void pushDirectory(size_t self, fs::path directory);
+    void scanDirectory(size_t self, const fs::path& directory, std::vector<fs::path>& found);
+    void publish(std::vector<fs::path>& found);
+
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+    std::vector<std::thread> m_threads;
+    BatchCallback m_onBatch;
+    DoneCallback m_onDone;
+    DirectoryCallback m_onDirectory;
+    size_t m_batchSize = DEFAULT_BATCH_SIZE;
+
+    std::atomic<bool> m_running{false};
+    std::atomic<bool> m_cancelled{false};
+    std::atomic<size_t> m_pendingDirectories{0};   // 已入队但尚未处理完的目录
+    std::atomic<size_t> m_activeWorkers{0};
+    std::mutex m_idleMutex;
+    std::condition_variable m_idleCondition;
+
+    std::atomic<size_t> m_directories{0};
+    std::atomic<size_t> m_files{0};
+    std::atomic<size_t> m_images{0};
+    std::atomic<size_t> m_batches{0};
+    std::atomic<size_t> m_steals{0};
+    std::chrono::steady_clock::time_point m_startTime;
+};
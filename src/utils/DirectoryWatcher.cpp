@@ -0,0 +1,469 @@
+#include "DirectoryWatcher.h"
+#include "DirectoryScanner.h"
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/inotify.h>
+    #include <unistd.h>
+    #include <cerrno>
+    #include <cstring>
+#endif
+
+namespace {
+
+bool isSameOrUnder(const fs::path& path, const fs::path& directory) {
+    const auto& a = path.native();
+    const auto& b = directory.native();
+    if (a.size() < b.size() || a.compare(0, b.size(), b) != 0) return false;
+    return a.size() == b.size() || a[b.size()] == fs::path::preferred_separator;
+}
+
+} // namespace
+
+DirectoryWatcher::~DirectoryWatcher() {
+    stop();
+}
+
+void DirectoryWatcher::startTreeWalker() {
+    m_treeWalker = std::thread(&DirectoryWatcher::treeWalkerLoop, this);
+}
+
+void DirectoryWatcher::stopTreeWalker() {
+    {
+        std::lock_guard<std::mutex> lock(m_treeMutex);
+        m_stopping = true;
+    }
+    m_treeCondition.notify_all();
+    if (m_treeWalker.joinable()) {
+        m_treeWalker.join();
+    }
+    std::lock_guard<std::mutex> lock(m_treeMutex);
+    m_treeQueue.clear();
+    m_treeChanges.clear();
+}
+
+void DirectoryWatcher::queueTree(const fs::path& directory, bool report) {
+    {
+        std::lock_guard<std::mutex> lock(m_treeMutex);
+        m_treeQueue.push_back({directory, report});
+    }
+    m_treeCondition.notify_one();
+}
+
+void DirectoryWatcher::dropTreeResultsUnder(const fs::path& directory) {
+    std::lock_guard<std::mutex> lock(m_treeMutex);
+    m_treeQueue.erase(std::remove_if(m_treeQueue.begin(), m_treeQueue.end(),
+                                     [&](const TreeRequest& r) { return isSameOrUnder(r.directory, directory); }),
+                      m_treeQueue.end());
+    m_treeChanges.erase(std::remove_if(m_treeChanges.begin(), m_treeChanges.end(),
+                                       [&](const DirectoryChange& c) { return isSameOrUnder(c.path, directory); }),
+                        m_treeChanges.end());
+}
+
+void DirectoryWatcher::treeWalkerLoop() {
+    std::unique_lock<std::mutex> lock(m_treeMutex);
+    for (;;) {
+        m_treeCondition.wait(lock, [this]() { return m_stopping.load() || !m_treeQueue.empty(); });
+        if (m_stopping.load()) return;
+        TreeRequest request = std::move(m_treeQueue.front());
+        m_treeQueue.pop_front();
+        lock.unlock();
+
+        // 遍历期间不持有锁，poll 照常取出其他变化
+        auto start = std::chrono::steady_clock::now();
+        std::vector<DirectoryChange> found;
+        addTree(request.directory, request.report ? &found : nullptr);
+#if !defined(_WIN32)
+        if (!request.report) {
+            size_t watches;
+            {
+                std::lock_guard<std::mutex> watchLock(m_watchMutex);
+                watches = m_watches.size();
+            }
+            std::cout << "[DirectoryWatcher] Watching " << request.directory << " (" << watches << " directories, "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+                      << " ms)" << std::endl;
+        }
+#endif
+
+        lock.lock();
+        m_treeChanges.insert(m_treeChanges.end(), std::make_move_iterator(found.begin()),
+                             std::make_move_iterator(found.end()));
+    }
+}
+
+void DirectoryWatcher::addTree(const fs::path& directory, std::vector<DirectoryChange>* changes) {
+    std::vector<fs::path> pending{directory};
+    while (!pending.empty() && !m_stopping.load()) {
+        fs::path current = std::move(pending.back());
+        pending.pop_back();
+#if !defined(_WIN32)
+        // 先添加监视再列出内容，两者之间新建的文件不会漏掉（重复的新增由调用方忽略）
+        addWatch(current);
+#endif
+        std::error_code ec;
+        fs::directory_iterator it(current, fs::directory_options::skip_permission_denied, ec);
+        if (ec) continue;
+        for (fs::directory_iterator end; it != end; it.increment(ec)) {
+            if (ec) break;
+            const fs::directory_entry& entry = *it;
+            std::error_code typeError;
+            if (entry.is_directory(typeError)) {
+                if (!entry.is_symlink(typeError)) pending.push_back(entry.path());
+                continue;
+            }
+            if (changes && DirectoryScanner::isImageExtension(entry.path()) && entry.is_regular_file(typeError)) {
+                DirectoryChange change;
+                change.type = DirectoryChange::Type::Added;
+                change.path = entry.path();
+                changes->push_back(std::move(change));
+            }
+        }
+    }
+}
+
+#if defined(_WIN32)
+
+bool DirectoryWatcher::start(const fs::path& root) {
+    stop();
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) return false;
+
+    HANDLE handle = CreateFileW(root.wstring().c_str(), FILE_LIST_DIRECTORY,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING,
+                                FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::cerr << "[DirectoryWatcher] Cannot open " << root << " (error " << GetLastError() << ")" << std::endl;
+        return false;
+    }
+    m_directoryHandle = handle;
+    m_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    OVERLAPPED* overlapped = new OVERLAPPED{};
+    overlapped->hEvent = static_cast<HANDLE>(m_event);
+    m_overlapped = overlapped;
+    // ReadDirectoryChangesW 要求缓冲区按 DWORD 对齐，vector 的存储满足这一点
+    m_buffer.assign(64 * 1024, 0);
+    m_root = root;
+    m_stopping = false;
+    startTreeWalker();
+
+    if (!issueRead()) {
+        stop();
+        return false;
+    }
+    m_watching = true;
+    std::cout << "[DirectoryWatcher] Watching " << root << std::endl;
+    return true;
+}
+
+bool DirectoryWatcher::issueRead() {
+    OVERLAPPED* overlapped = static_cast<OVERLAPPED*>(m_overlapped);
+    ResetEvent(overlapped->hEvent);
+    BOOL ok = ReadDirectoryChangesW(static_cast<HANDLE>(m_directoryHandle), m_buffer.data(),
+                                    static_cast<DWORD>(m_buffer.size()), TRUE,
+                                    FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE,
+                                    nullptr, overlapped, nullptr);
+    if (!ok) {
+        std::cerr << "[DirectoryWatcher] ReadDirectoryChangesW failed (error " << GetLastError() << ")" << std::endl;
+    }
+    return ok != FALSE;
+}
+
+void DirectoryWatcher::stop() {
+    stopTreeWalker();
+    if (m_directoryHandle) {
+        HANDLE handle = static_cast<HANDLE>(m_directoryHandle);
+        OVERLAPPED* overlapped = static_cast<OVERLAPPED*>(m_overlapped);
+        DWORD bytes = 0;
+        if (CancelIoEx(handle, overlapped) || GetLastError() != ERROR_NOT_FOUND) {
+            GetOverlappedResult(handle, overlapped, &bytes, TRUE);
+        }
+        CloseHandle(handle);
+        m_directoryHandle = nullptr;
+    }
+    if (m_event) {
+        CloseHandle(static_cast<HANDLE>(m_event));
+        m_event = nullptr;
+    }
+    delete static_cast<OVERLAPPED*>(m_overlapped);
+    m_overlapped = nullptr;
+    m_pendingRenameFrom.clear();
+    m_watching = false;
+}
+
+void DirectoryWatcher::poll(std::vector<DirectoryChange>& changes) {
+    if (!m_directoryHandle) return;
+    {
+        // 后台遍历新目录找到的图片
+        std::lock_guard<std::mutex> lock(m_treeMutex);
+        changes.insert(changes.end(), std::make_move_iterator(m_treeChanges.begin()),
+                       std::make_move_iterator(m_treeChanges.end()));
+        m_treeChanges.clear();
+    }
+    HANDLE handle = static_cast<HANDLE>(m_directoryHandle);
+    OVERLAPPED* overlapped = static_cast<OVERLAPPED*>(m_overlapped);
+
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(handle, overlapped, &bytes, FALSE)) {
+        DWORD error = GetLastError();
+        if (error == ERROR_IO_INCOMPLETE) return;
+        if (error == ERROR_NOTIFY_ENUM_DIR) {
+            DirectoryChange overflow;
+            overflow.type = DirectoryChange::Type::Overflow;
+            changes.push_back(std::move(overflow));
+            issueRead();
+            return;
+        }
+        // 目录被删除或句柄失效
+        std::cerr << "[DirectoryWatcher] Stopped watching " << m_root << " (error " << error << ")" << std::endl;
+        stop();
+        return;
+    }
+    if (bytes == 0) {
+        // 缓冲区放不下这段时间的事件
+        DirectoryChange overflow;
+        overflow.type = DirectoryChange::Type::Overflow;
+        changes.push_back(std::move(overflow));
+        issueRead();
+        return;
+    }
+
+    size_t offset = 0;
+    for (;;) {
+        const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(m_buffer.data() + offset);
+        fs::path path = m_root / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR));
+        std::error_code ec;
+        DirectoryChange change;
+        change.path = path;
+
+        switch (info->Action) {
+        case FILE_ACTION_ADDED:
+            if (fs::is_directory(path, ec)) {
+                queueTree(path, true);
+            } else if (DirectoryScanner::isImageExtension(path)) {
+                change.type = DirectoryChange::Type::Added;
+                changes.push_back(std::move(change));
+            }
+            break;
+        case FILE_ACTION_REMOVED:
+            // 已删除的路径无法判断是否为目录：非图片按目录处理，移除其下所有图片
+            change.type = DirectoryChange::Type::Removed;
+            change.directory = !DirectoryScanner::isImageExtension(path);
+            if (change.directory) dropTreeResultsUnder(path);
+            changes.push_back(std::move(change));
+            break;
+        case FILE_ACTION_MODIFIED:
+            if (DirectoryScanner::isImageExtension(path) && !fs::is_directory(path, ec)) {
+                change.type = DirectoryChange::Type::Modified;
+                changes.push_back(std::move(change));
+            }
+            break;
+        case FILE_ACTION_RENAMED_OLD_NAME:
+            m_pendingRenameFrom = path;
+            break;
+        case FILE_ACTION_RENAMED_NEW_NAME: {
+            fs::path from = std::move(m_pendingRenameFrom);
+            m_pendingRenameFrom.clear();
+            if (fs::is_directory(path, ec)) {
+                if (!from.empty()) {
+                    DirectoryChange removed;
+                    removed.type = DirectoryChange::Type::Removed;
+                    removed.path = from;
+                    removed.directory = true;
+                    dropTreeResultsUnder(from);
+                    changes.push_back(std::move(removed));
+                }
+                queueTree(path, true);
+                break;
+            }
+            const bool wasImage = !from.empty() && DirectoryScanner::isImageExtension(from);
+            const bool isImage = DirectoryScanner::isImageExtension(path);
+            if (wasImage && isImage) {
+                change.type = DirectoryChange::Type::Renamed;
+                change.oldPath = from;
+                changes.push_back(std::move(change));
+            } else if (wasImage) {
+                change.type = DirectoryChange::Type::Removed;
+                change.path = from;
+                changes.push_back(std::move(change));
+            } else if (isImage) {
+                change.type = DirectoryChange::Type::Added;
+                changes.push_back(std::move(change));
+            }
+            break;
+        }
+        default:
+            break;
+        }
+
+        if (info->NextEntryOffset == 0) break;
+        offset += info->NextEntryOffset;
+    }
+    issueRead();
+}
+
+#else
+
+namespace {
+
+constexpr uint32_t WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+                                IN_DELETE_SELF | IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+} // namespace
+
+bool DirectoryWatcher::start(const fs::path& root) {
+    stop();
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) return false;
+
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0) {
+        std::cerr << "[DirectoryWatcher] inotify_init1 failed: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    m_root = root;
+    m_stopping = false;
+    m_limitReported = false;
+    if (!addWatch(root)) {
+        stop();
+        return false;
+    }
+    m_watching = true;
+
+    // 子目录的监视在后台添加，大目录树不阻塞启动
+    startTreeWalker();
+    queueTree(root, false);
+    return true;
+}
+
+void DirectoryWatcher::stop() {
+    stopTreeWalker();
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    m_watches.clear();
+    m_watching = false;
+}
+
+bool DirectoryWatcher::addWatch(const fs::path& directory) {
+    int wd = inotify_add_watch(m_fd, directory.c_str(), WATCH_MASK);
+    int error = errno;
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    if (wd < 0) {
+        if (error == ENOSPC && !m_limitReported) {
+            m_limitReported = true;
+            std::cerr << "[DirectoryWatcher] inotify watch limit reached, some directories are not watched "
+                         "(raise fs.inotify.max_user_watches)" << std::endl;
+        }
+        return false;
+    }
+    // 同一目录重复添加返回相同的描述符
+    m_watches[wd] = directory;
+    return true;
+}
+
+void DirectoryWatcher::removeWatchesUnder(const fs::path& directory) {
+    std::lock_guard<std::mutex> lock(m_watchMutex);
+    for (auto it = m_watches.begin(); it != m_watches.end();) {
+        if (isSameOrUnder(it->second, directory)) {
+            inotify_rm_watch(m_fd, it->first);
+            it = m_watches.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void DirectoryWatcher::poll(std::vector<DirectoryChange>& changes) {
+    if (m_fd < 0) return;
+    {
+        // 后台遍历新目录找到的图片
+        std::lock_guard<std::mutex> lock(m_treeMutex);
+        changes.insert(changes.end(), std::make_move_iterator(m_treeChanges.begin()),
+                       std::make_move_iterator(m_treeChanges.end()));
+        m_treeChanges.clear();
+    }
+
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    std::unordered_map<uint32_t, size_t> moves;     // cookie -> changes 中对应的移出事件
+    for (;;) {
+        ssize_t length = read(m_fd, buffer, sizeof(buffer));
+        if (length < 0 && errno == EINTR) continue;
+        if (length <= 0) break;
+
+        for (char* p = buffer; p < buffer + length;) {
+            const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(p);
+            p += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                DirectoryChange overflow;
+                overflow.type = DirectoryChange::Type::Overflow;
+                changes.push_back(std::move(overflow));
+                continue;
+            }
+            fs::path directory;
+            {
+                std::lock_guard<std::mutex> lock(m_watchMutex);
+                auto it = m_watches.find(event->wd);
+                if (it == m_watches.end()) continue;
+                if (event->mask & IN_IGNORED) {
+                    m_watches.erase(it);
+                    continue;
+                }
+                directory = it->second;
+            }
+            // 目录自身被删除时由父目录的事件报告
+            if (event->len == 0) continue;
+
+            DirectoryChange change;
+            change.path = directory / event->name;
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+                    queueTree(change.path, true);
+                } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+                    if (event->mask & IN_MOVED_FROM) removeWatchesUnder(change.path);
+                    dropTreeResultsUnder(change.path);
+                    change.type = DirectoryChange::Type::Removed;
+                    change.directory = true;
+                    changes.push_back(std::move(change));
+                }
+                continue;
+            }
+            if (!DirectoryScanner::isImageExtension(change.path)) continue;
+
+            if (event->mask & IN_CLOSE_WRITE) {
+                change.type = DirectoryChange::Type::Modified;
+            } else if (event->mask & IN_DELETE) {
+                change.type = DirectoryChange::Type::Removed;
+            } else if (event->mask & IN_MOVED_FROM) {
+                change.type = DirectoryChange::Type::Removed;
+                moves[event->cookie] = changes.size();
+            } else if (event->mask & IN_MOVED_TO) {
+                auto move = moves.find(event->cookie);
+                if (move != moves.end()) {
+                    // 同一次改名的两半：合并为改名
+                    DirectoryChange& removed = changes[move->second];
+                    removed.type = DirectoryChange::Type::Renamed;
+                    removed.oldPath = std::move(removed.path);
+                    removed.path = std::move(change.path);
+                    moves.erase(move);
+                    continue;
+                }
+                change.type = DirectoryChange::Type::Added;
+            } else {
+                continue;   // 新建的空文件等写完后再报告
+            }
+            changes.push_back(std::move(change));
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <unordered_map>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// 目录中的一次变化
+struct DirectoryChange {
+    enum class Type {
+        Added,          // 新图片（创建或移入）
+        Removed,        // 图片或目录被删除、移出；directory 为 true 时移除其下所有图片
+        Modified,       // 图片内容被改写（不在列表中时视为新增）
+        Renamed,        // 图片在监视范围内改名：oldPath -> path
+        Overflow        // 事件太多被系统丢弃，需要重新扫描
+    };
+    Type type = Type::Added;
+    fs::path path;
+    fs::path oldPath;
+    bool directory = false;
+};
+
+/**
+ * @class DirectoryWatcher
+ * @brief 递归监视目录中图片的增删改
+ * @description Linux 使用 inotify：每个子目录一个监视；Windows 使用 ReadDirectoryChangesW 监视整棵目录树。
+ *              两者都以非阻塞方式读取事件，由主线程每帧调用 poll 取出变化，不需要额外加锁同步图片列表。
+ *              只报告支持的图片扩展名；新出现的子目录（如复制进来的大文件夹）在后台线程中遍历，
+ *              其中已有的图片在之后的 poll 中作为新增报告。初始的子目录遍历也在这个线程中完成。
+ */
+class DirectoryWatcher {
+public:
+    DirectoryWatcher() = default;
+    ~DirectoryWatcher();
+
+    DirectoryWatcher(const DirectoryWatcher&) = delete;
+    DirectoryWatcher& operator=(const DirectoryWatcher&) = delete;
+
+    bool start(const fs::path& root);
+    void stop();
+    bool isWatching() const { return m_watching; }
+    const fs::path& getRoot() const { return m_root; }
+
+    // 取出上次调用以来的变化（非阻塞，在主线程调用）
+    void poll(std::vector<DirectoryChange>& changes);
+
+private:
+    struct TreeRequest {
+        fs::path directory;
+        bool report = true;     // 是否把其中已有的图片作为新增报告
+    };
+
+    // 列出新目录中已有的图片；Linux 上同时为其中的子目录添加监视
+    void addTree(const fs::path& directory, std::vector<DirectoryChange>* changes);
+    // 把目录交给后台线程遍历
+    void queueTree(const fs::path& directory, bool report);
+    // 目录被删除或移出后，丢弃其下尚未报告的遍历结果
+    void dropTreeResultsUnder(const fs::path& directory);
+    void startTreeWalker();
+    void stopTreeWalker();
+    void treeWalkerLoop();
+
+    fs::path m_root;
+    bool m_watching = false;
+    std::atomic<bool> m_stopping{false};
+
+    std::thread m_treeWalker;
+    std::mutex m_treeMutex;
+    std::condition_variable m_treeCondition;
+    std::deque<TreeRequest> m_treeQueue;            // 由 m_treeMutex 保护
+    std::vector<DirectoryChange> m_treeChanges;     // 遍历找到、尚未报告的图片（由 m_treeMutex 保护）
+
+#if defined(_WIN32)
+    bool issueRead();
+
+    void* m_directoryHandle = nullptr;
+    void* m_event = nullptr;
+    void* m_overlapped = nullptr;           // OVERLAPPED
+    std::vector<unsigned char> m_buffer;
+    fs::path m_pendingRenameFrom;
+#else
+    bool addWatch(const fs::path& directory);
+    void removeWatchesUnder(const fs::path& directory);
+
+    int m_fd = -1;
+    std::mutex m_watchMutex;
+    std::unordered_map<int, fs::path> m_watches;     // 监视描述符 -> 目录
+    bool m_limitReported = false;
+#endif
+};
@@ -0,0 +1,314 @@
+#include "ExifCache.h"
+#include "DirectoryIndex.h"
+#include "FileBuffer.h"
+#include "../TinyEXIF/EXIF.h"
+#include "../component/DecodeScheduler.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+const char CACHE_MAGIC[4] = { 'V', 'E', 'X', 'F' };
+
+// 缓存文件布局：文件头 | 条目 | 字符串区（每个条目的路径、厂商、型号、时间依次存放）
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+    uint64_t stringBytes;
+};
+
+struct DiskEntry {
+    int64_t mtime;
+    uint64_t size;
+    double fNumber;
+    double exposureTime;
+    int32_t orientation;
+    int32_t iso;
+    int32_t width;
+    int32_t height;
+    uint32_t stringOffset;
+    uint32_t flags;             // 1: 有 EXIF
+    uint16_t pathLength;
+    uint16_t makeLength;
+    uint16_t modelLength;
+    uint16_t dateLength;
+};
+
+static_assert(sizeof(FileHeader) == 24, "unexpected FileHeader layout");
+static_assert(sizeof(DiskEntry) == 64, "unexpected DiskEntry layout");
+
+constexpr size_t MAX_STRING = 0xFFFF;
+
+} // namespace
+
+ExifCache& ExifCache::getInstance() {
+    static ExifCache instance;
+    return instance;
+}
+
+fs::path ExifCache::cacheFileFor(const fs::path& root) {
+    fs::path file = DirectoryIndex::indexFileFor(root);
+    file.replace_extension(".vexif");
+    return file;
+}
+
+bool ExifCache::statFile(const std::string& path, int64_t& mtime, uint64_t& size) {
+    std::error_code ec;
+    const fs::path file(path);
+    auto time = fs::last_write_time(file, ec);
+    if (ec) return false;
+    size = fs::file_size(file, ec);
+    if (ec) return false;
+    mtime = DirectoryIndex::toTicks(time);
+    return true;
+}
+
+void ExifCache::readSummary(const std::string& path, ExifSummary& summary) {
+    summary = ExifSummary();
+    TinyEXIF::EXIFInfo info;
+    FileEXIFStream stream(path);
+    if (info.parseFrom(stream) != TinyEXIF::PARSE_SUCCESS) return;
+
+    summary.valid = true;
+    summary.orientation = info.Orientation;
+    summary.fNumber = info.FNumber;
+    summary.exposureTime = info.ExposureTime;
+    summary.iso = info.ISOSpeedRatings;
+    summary.width = static_cast<int>(info.ImageWidth);
+    summary.height = static_cast<int>(info.ImageHeight);
+    summary.make = info.Make.substr(0, MAX_STRING);
+    summary.model = info.Model.substr(0, MAX_STRING);
+    summary.dateTime = (info.DateTimeOriginal.empty() ? info.DateTime : info.DateTimeOriginal).substr(0, MAX_STRING);
+}
+
+bool ExifCache::get(const std::string& path, ExifSummary& summary) {
+    int64_t mtime = 0;
+    uint64_t size = 0;
+    if (!statFile(path, mtime, size)) {
+        summary = ExifSummary();
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(path);
+        if (it != m_entries.end() && it->second.mtime == mtime && it->second.size == size) {
+            it->second.lastUsed = ++m_useTick;
+            summary = it->second.summary;
+            return summary.valid;
+        }
+    }
+
+    // 解析时不持有锁，预读线程和主线程可以同时解析不同的文件
+    Entry entry;
+    entry.mtime = mtime;
+    entry.size = size;
+    readSummary(path, entry.summary);
+    summary = entry.summary;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.size() >= MAX_ENTRIES && m_entries.find(path) == m_entries.end()) {
+        evictOldest();
+    }
+    entry.lastUsed = ++m_useTick;
+    m_entries[path] = std::move(entry);
+    m_dirty = true;
+    return summary.valid;
+}
+
+void ExifCache::evictOldest() {
+    const size_t count = std::min(EVICT_BATCH, m_entries.size());
+    if (count == 0) return;
+    std::vector<uint64_t> ticks;
+    ticks.reserve(m_entries.size());
+    for (const auto& item : m_entries) {
+        ticks.push_back(item.second.lastUsed);
+    }
+    // 序号各不相同，不大于第 count 小的序号的条目正好有 count 个
+    std::nth_element(ticks.begin(), ticks.begin() + (count - 1), ticks.end());
+    const uint64_t cutoff = ticks[count - 1];
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->second.lastUsed <= cutoff) {
+            it = m_entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void ExifCache::prefetch(const std::vector<std::string>& paths, const std::vector<long long>& indices) {
+    auto& scheduler = DecodeScheduler::getInstance();
+    scheduler.cancelOwner(this);
+    for (size_t i = 0; i < paths.size(); ++i) {
+        {
+            // 已缓存的不再提交（文件是否变化在显示时由 get 校验）
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_entries.count(paths[i])) continue;
+        }
+        const long long index = i < indices.size() ? indices[i] : -1;
+        scheduler.submit(this, paths[i], index, DecodeScheduler::PREFETCH,
+                         [this, path = paths[i]](const DecodeScheduler::CancelToken& token) {
+                             if (token && token->load()) return;
+                             ExifSummary summary;
+                             get(path, summary);
+                         });
+    }
+}
+
+void ExifCache::cancelPrefetch() {
+    DecodeScheduler::getInstance().cancelOwner(this, true);
+}
+
+void ExifCache::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_useTick = 0;
+    m_dirty = false;
+}
+
+bool ExifCache::load(const fs::path& root) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_useTick = 0;
+    m_dirty = false;
+    m_file = cacheFileFor(root);
+
+    std::error_code ec;
+    if (!fs::is_regular_file(m_file, ec)) return false;
+    FileBuffer file;
+    if (!file.open(m_file.string(), FileBuffer::Access::Map)) return false;
+
+    const unsigned char* data = file.data();
+    const size_t size = file.size();
+    FileHeader header;
+    if (size < sizeof(header)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != FORMAT_VERSION) {
+        std::cerr << "[ExifCache] ignoring incompatible cache " << m_file << std::endl;
+        return false;
+    }
+    const size_t stringsOffset = sizeof(FileHeader) + size_t(header.entryCount) * sizeof(DiskEntry);
+    if (header.stringBytes > size || stringsOffset + header.stringBytes != size) {
+        std::cerr << "[ExifCache] ignoring truncated cache " << m_file << std::endl;
+        return false;
+    }
+
+    const char* strings = reinterpret_cast<const char*>(data + stringsOffset);
+    m_entries.reserve(header.entryCount);
+    for (uint32_t i = 0; i < header.entryCount; ++i) {
+        DiskEntry disk;
+        std::memcpy(&disk, data + sizeof(FileHeader) + size_t(i) * sizeof(DiskEntry), sizeof(disk));
+        const uint64_t total = uint64_t(disk.pathLength) + disk.makeLength + disk.modelLength + disk.dateLength;
+        if (uint64_t(disk.stringOffset) + total > header.stringBytes) {
+            std::cerr << "[ExifCache] ignoring corrupt cache " << m_file << std::endl;
+            m_entries.clear();
+            return false;
+        }
+        const char* text = strings + disk.stringOffset;
+        Entry entry;
+        entry.mtime = disk.mtime;
+        entry.size = disk.size;
+        // 文件中按使用先后排列，依次编号即可恢复上次的使用顺序
+        entry.lastUsed = ++m_useTick;
+        entry.summary.valid = (disk.flags & 1) != 0;
+        entry.summary.orientation = disk.orientation;
+        entry.summary.fNumber = disk.fNumber;
+        entry.summary.exposureTime = disk.exposureTime;
+        entry.summary.iso = disk.iso;
+        entry.summary.width = disk.width;
+        entry.summary.height = disk.height;
+        std::string path(text, disk.pathLength);
+        text += disk.pathLength;
+        entry.summary.make.assign(text, disk.makeLength);
+        text += disk.makeLength;
+        entry.summary.model.assign(text, disk.modelLength);
+        text += disk.modelLength;
+        entry.summary.dateTime.assign(text, disk.dateLength);
+        m_entries.emplace(std::move(path), std::move(entry));
+    }
+    return true;
+}
+
+bool ExifCache::save() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_dirty || m_file.empty()) return true;
+
+    // 按使用先后写出，最久未使用的在前
+    std::vector<const std::pair<const std::string, Entry>*> ordered;
+    ordered.reserve(m_entries.size());
+    for (const auto& item : m_entries) {
+        ordered.push_back(&item);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const auto* a, const auto* b) {
+        return a->second.lastUsed < b->second.lastUsed;
+    });
+
+    std::string strings;
+    std::vector<DiskEntry> entries;
+    entries.reserve(ordered.size());
+    for (const auto* item : ordered) {
+        const std::string& path = item->first;
+        const Entry& entry = item->second;
+        if (path.size() > MAX_STRING) continue;
+        const ExifSummary& summary = entry.summary;
+        DiskEntry disk{};
+        disk.mtime = entry.mtime;
+        disk.size = entry.size;
+        disk.fNumber = summary.fNumber;
+        disk.exposureTime = summary.exposureTime;
+        disk.orientation = summary.orientation;
+        disk.iso = summary.iso;
+        disk.width = summary.width;
+        disk.height = summary.height;
+        disk.stringOffset = static_cast<uint32_t>(strings.size());
+        disk.flags = summary.valid ? 1 : 0;
+        disk.pathLength = static_cast<uint16_t>(path.size());
+        disk.makeLength = static_cast<uint16_t>(summary.make.size());
+        disk.modelLength = static_cast<uint16_t>(summary.model.size());
+        disk.dateLength = static_cast<uint16_t>(summary.dateTime.size());
+        strings += path;
+        strings += summary.make;
+        strings += summary.model;
+        strings += summary.dateTime;
+        entries.push_back(disk);
+    }
+    if (strings.size() > UINT32_MAX) {
+        std::cerr << "[ExifCache] cache too large, not saved" << std::endl;
+        return false;
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.stringBytes = strings.size();
+
+    std::error_code ec;
+    fs::create_directories(m_file.parent_path(), ec);
+    fs::path tempPath = m_file;
+    tempPath += ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(DiskEntry));
+        out.write(strings.data(), strings.size());
+        if (!out) {
+            std::cerr << "[ExifCache] failed to write " << tempPath << std::endl;
+            out.close();
+            fs::remove(tempPath, ec);
+            return false;
+        }
+    }
+    // 写完再替换，异常退出时不会留下半个缓存文件
+    fs::rename(tempPath, m_file, ec);
+    if (ec) {
+        std::cerr << "[ExifCache] failed to replace " << m_file << ": " << ec.message() << std::endl;
+        fs::remove(tempPath, ec);
+        return false;
+    }
+    m_dirty = false;
+    return true;
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// 界面用到的 EXIF 字段
+struct ExifSummary {
+    bool valid = false;         // 文件带有可解析的 EXIF
+    int orientation = 0;        // EXIF Orientation 原始值（1~8），0 表示未知
+    double fNumber = 0.0;
+    double exposureTime = 0.0;
+    int iso = 0;
+    int width = 0;
+    int height = 0;
+    std::string make;
+    std::string model;
+    std::string dateTime;       // 拍摄时间，没有时为修改时间（EXIF 中的写法）
+};
+
+/**
+ * @class ExifCache
+ * @brief 按 (路径, 修改时间, 大小) 缓存解析好的 EXIF
+ * @description 切换图片、定时刷新、扫描结束和修改设置时都会重新显示 EXIF，
+ *              缓存命中时只需查询一次文件状态，文件被改写后自动重新解析；没有 EXIF 的文件也会记录下来。
+ *              相邻图片的 EXIF 在解码线程池中以预读优先级提前解析。
+ *              条目数超过上限时按最近使用时间淘汰；缓存文件按使用先后写出，下次读入后保持同样的顺序。
+ *              启用目录索引时缓存保存在索引旁边（同名，扩展名 .vexif），下次打开同一目录时读入。
+ */
+class ExifCache {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 1;
+    static constexpr size_t MAX_ENTRIES = 100000;
+    // 缓存满时一次淘汰最久未使用的条目数，避免每次插入都查找最旧的条目
+    static constexpr size_t EVICT_BATCH = MAX_ENTRIES / 8;
+
+    // 单例模式
+    static ExifCache& getInstance();
+
+    // 禁止拷贝和赋值
+    ExifCache(const ExifCache&) = delete;
+    ExifCache& operator=(const ExifCache&) = delete;
+
+    // 取得 path 的 EXIF：缓存有效时直接返回，否则解析并写入缓存。返回 summary.valid
+    bool get(const std::string& path, ExifSummary& summary);
+
+    // 在解码线程池中解析这些图片的 EXIF（已缓存的跳过），之前提交、尚未执行的预读会被取消
+    void prefetch(const std::vector<std::string>& paths, const std::vector<long long>& indices);
+    // 取消预读并等待正在执行的任务结束
+    void cancelPrefetch();
+
+    // 读入 root 对应的缓存文件（替换当前内容）
+    bool load(const fs::path& root);
+    // 有修改时写回 load 时的缓存文件
+    bool save();
+    void clear();
+
+    static fs::path cacheFileFor(const fs::path& root);
+
+private:
+    ExifCache() = default;
+
+    struct Entry {
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        uint64_t lastUsed = 0;      // 最近一次使用的序号，越大越新
+        ExifSummary summary;
+    };
+
+    static bool statFile(const std::string& path, int64_t& mtime, uint64_t& size);
+    static void readSummary(const std::string& path, ExifSummary& summary);
+    // 移除最久未使用的 EVICT_BATCH 个条目；调用方需持有 m_mutex
+    void evictOldest();
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Entry> m_entries;
+    uint64_t m_useTick = 0;
+    fs::path m_file;
+    bool m_dirty = false;
+};
@@ -0,0 +1,176 @@
+#include "FileBuffer.h"
+#include "DecodeBufferPool.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <utility>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+#endif
+
+FileBuffer::~FileBuffer() {
+    close();
+}
+
+FileBuffer::FileBuffer(FileBuffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+FileBuffer& FileBuffer::operator=(FileBuffer&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_mapped, other.m_mapped);
+#if defined(_WIN32)
+        std::swap(m_fileHandle, other.m_fileHandle);
+        std::swap(m_mappingHandle, other.m_mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+bool FileBuffer::open(const std::string& path, Access access) {
+    close();
+    if (access == Access::Read) {
+        return readAll(path);
+    }
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(std::filesystem::path(path).wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0) {
+        CloseHandle(file);
+        return false;
+    }
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view) {
+        m_fileHandle = file;
+        m_mappingHandle = mapping;
+        m_data = static_cast<const unsigned char*>(view);
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        m_mapped = true;
+        return true;
+    }
+    if (mapping) CloseHandle(mapping);
+    CloseHandle(file);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射建立后描述符即可关闭
+    ::close(fd);
+    if (view != MAP_FAILED) {
+        madvise(view, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+        m_data = static_cast<const unsigned char*>(view);
+        m_size = static_cast<size_t>(st.st_size);
+        m_mapped = true;
+        return true;
+    }
+#endif
+
+    // 无法映射时一次读入内存
+    return readAll(path);
+}
+
+bool FileBuffer::readAll(const std::string& path) {
+    DecodeBufferPool& pool = DecodeBufferPool::getInstance();
+#if defined(_WIN32)
+    std::ifstream stream(std::filesystem::path(path), std::ios::binary | std::ios::ate);
+    if (!stream.is_open()) {
+        return false;
+    }
+    std::streamoff size = stream.tellg();
+    if (size <= 0) {
+        return false;
+    }
+    unsigned char* buffer = static_cast<unsigned char*>(pool.allocate(static_cast<size_t>(size)));
+    if (!buffer) {
+        return false;
+    }
+    stream.seekg(0);
+    if (!stream.read(reinterpret_cast<char*>(buffer), size)) {
+        pool.release(buffer);
+        return false;
+    }
+    m_size = static_cast<size_t>(size);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(st.st_size);
+    unsigned char* buffer = static_cast<unsigned char*>(pool.allocate(size));
+    if (!buffer) {
+        ::close(fd);
+        return false;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    // 文件在读取期间被截断或读取出错时放弃，只返回失败
+    size_t done = 0;
+    while (done < size) {
+        ssize_t bytes = ::pread(fd, buffer + done, size - done, static_cast<off_t>(done));
+        if (bytes < 0 && errno == EINTR) continue;
+        if (bytes <= 0) break;
+        done += static_cast<size_t>(bytes);
+    }
+    ::close(fd);
+    if (done != size) {
+        std::cerr << "[FileBuffer] short read (" << done << "/" << size << " bytes): " << path << std::endl;
+        pool.release(buffer);
+        return false;
+    }
+    m_size = size;
+#endif
+    m_data = buffer;
+    m_mapped = false;
+    return true;
+}
+
+void FileBuffer::close() {
+    if (m_data) {
+        if (m_mapped) {
+#if defined(_WIN32)
+            UnmapViewOfFile(m_data);
+#else
+            munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+        } else {
+            DecodeBufferPool::getInstance().release(const_cast<unsigned char*>(m_data));
+        }
+    }
+#if defined(_WIN32)
+    if (m_mappingHandle) CloseHandle(m_mappingHandle);
+    if (m_fileHandle) CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+}
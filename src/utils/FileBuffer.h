@@ -0,0 +1,49 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/**
+ * @class FileBuffer
+ * @brief 读入内存的整个文件内容（只读）
+ * @description 打开一次文件，探测和解码都直接读取同一块内存，不再重复打开文件。
+ *              默认会复制：按位置读入解码缓冲池分配的缓冲区，open 返回时文件已全部读完。
+ *              不映射图片文件是因为图片文件可能正在被改写或位于网络共享上，
+ *              映射区在文件被截断或读取出错时访问会触发 SIGBUS 使整个程序崩溃，读入则只会返回失败。
+ *              程序自己写入、只通过改名替换的缓存文件（目录索引、EXIF 缓存）可以使用映射，
+ *              映射失败时同样退回为读入。
+ */
+class FileBuffer {
+public:
+    enum class Access {
+        Read,   // 读入缓冲区
+        Map     // 内存映射，只用于不会被原地改写的文件
+    };
+
+    FileBuffer() = default;
+    explicit FileBuffer(const std::string& path, Access access = Access::Read) { open(path, access); }
+    ~FileBuffer();
+
+    // 禁止拷贝，允许移动
+    FileBuffer(const FileBuffer&) = delete;
+    FileBuffer& operator=(const FileBuffer&) = delete;
+    FileBuffer(FileBuffer&& other) noexcept;
+    FileBuffer& operator=(FileBuffer&& other) noexcept;
+
+    bool open(const std::string& path, Access access = Access::Read);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    bool readAll(const std::string& path);
+
+    const unsigned char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;      // true: 映射区；false: 解码缓冲池分配的缓冲区
+#if defined(_WIN32)
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+};
@@ -0,0 +1,374 @@
+#include "HeaderProbe.h"
+#include "FileBuffer.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include <cerrno>
+#include <filesystem>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#if defined(VIMAG_IO_URING) && defined(__linux__)
+    #include <liburing.h>
+#endif
+
+namespace {
+
+uint16_t be16(const unsigned char* p) { return static_cast<uint16_t>((p[0] << 8) | p[1]); }
+uint32_t be32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) | (p[2] << 8) | p[3];
+}
+uint16_t le16(const unsigned char* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+uint32_t le32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+bool hasTgaExtension(const std::string& path) {
+    if (path.size() < 4) return false;
+    std::string ext = path.substr(path.size() - 4);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".tga";
+}
+
+// 单个文件的解析状态：offset() 给出下一次读取的位置，读到的数据交给 feed
+class ProbeState {
+public:
+    explicit ProbeState(bool tgaHint = false) : m_tgaHint(tgaHint) {}
+
+    bool done() const { return m_done; }
+    bool needsFallback() const { return m_fallback; }
+    uint64_t offset() const { return m_offset; }
+    ImageHeader& header() { return m_header; }
+
+    void fail() { m_done = true; }
+    // 数据可能是合法的，只是不在快速路径的处理范围内：交给解码器读取文件头
+    void fallback() {
+        m_fallback = true;
+        m_done = true;
+    }
+
+    // data 为从 offset() 开始读到的 size 字节（到文件末尾时可能不足 READ_SIZE）
+    void feed(const unsigned char* data, size_t size) {
+        m_header.reads++;
+        m_header.bytesRead += static_cast<uint32_t>(size);
+        if (m_header.reads == 1) {
+            parseFirst(data, size);
+        } else {
+            parseJpeg(data, size, m_offset);
+        }
+    }
+
+private:
+    void finish(uint32_t width, uint32_t height) {
+        m_header.width = static_cast<int>(std::min<uint32_t>(width, INT32_MAX));
+        m_header.height = static_cast<int>(std::min<uint32_t>(height, INT32_MAX));
+        m_header.valid = width > 0 && height > 0;
+        m_done = true;
+    }
+
+    void parseFirst(const unsigned char* data, size_t size) {
+        static const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+        if (size >= 24 && std::memcmp(data, PNG_SIGNATURE, 8) == 0) {
+            m_header.type = PNG;
+            if (std::memcmp(data + 12, "IHDR", 4) != 0) return fail();
+            return finish(be32(data + 16), be32(data + 20));
+        }
+        if (size >= 10 && std::memcmp(data, "GIF8", 4) == 0) {
+            m_header.type = GIF;
+            return finish(le16(data + 6), le16(data + 8));
+        }
+        if (size >= 26 && data[0] == 'B' && data[1] == 'M') {
+            m_header.type = BMP;
+            if (le32(data + 14) == 12) {
+                return finish(le16(data + 18), le16(data + 20));      // OS/2 BITMAPCOREHEADER
+            }
+            const int32_t width = static_cast<int32_t>(le32(data + 18));
+            const int32_t height = static_cast<int32_t>(le32(data + 22));  // 负数表示自上而下
+            return finish(static_cast<uint32_t>(std::abs(width)), static_cast<uint32_t>(std::abs(height)));
+        }
+        if (size >= 22 && std::memcmp(data, "8BPS", 4) == 0) {
+            m_header.type = PSD;
+            return finish(be32(data + 18), be32(data + 14));
+        }
+        if (size >= 4 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF) {
+            m_header.type = JPG;
+            m_offset = 2;
+            return parseJpeg(data, size, 0);
+        }
+        // TGA 没有魔数：扩展名为 .tga 且文件头的类型字段合理时才直接解析
+        if (m_tgaHint && size >= 18 && data[1] <= 1) {
+            const unsigned char imageType = data[2];
+            if (imageType == 1 || imageType == 2 || imageType == 3 || imageType == 9 || imageType == 10 || imageType == 11) {
+                m_header.type = TGA;
+                return finish(le16(data + 12), le16(data + 14));
+            }
+        }
+        fallback();
+    }
+
+    // 从 m_offset 开始逐段查找 SOF；base 为 data[0] 在文件中的偏移。数据不够时留给下一次读取
+    void parseJpeg(const unsigned char* data, size_t size, uint64_t base) {
+        for (;;) {
+            if (m_offset < base) return fail();
+            const size_t pos = static_cast<size_t>(m_offset - base);
+            auto need = [&](size_t bytes) {
+                if (pos + bytes <= size) return true;
+                // 刚从这里读取过仍然不够：已到文件末尾
+                if (pos == 0) fail();
+                return false;
+            };
+            if (!need(2)) return;
+            if (data[pos] != 0xFF) return fail();
+            const unsigned char marker = data[pos + 1];
+            if (marker == 0xFF) {           // 填充字节
+                m_offset += 1;
+                continue;
+            }
+            if (marker == 0xD8 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+                m_offset += 2;              // 没有长度字段的标记
+                continue;
+            }
+            if (marker == 0xD9 || marker == 0xDA) return fail();     // 扫描数据之前没有 SOF
+
+            const bool sof = marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC;
+            if (sof) {
+                // FF Cn 长度(2) 精度(1) 高(2) 宽(2)
+                if (!need(9)) return;
+                return finish(be16(data + pos + 7), be16(data + pos + 5));
+            }
+            if (!need(4)) return;
+            const uint16_t length = be16(data + pos + 2);
+            if (length < 2) return fail();
+            m_offset += 2 + length;
+            // 超过查找上限（如很大的 EXIF 或 ICC 段）不代表文件损坏
+            if (++m_segments > HeaderProbe::MAX_JPEG_SEGMENTS || m_offset > HeaderProbe::MAX_JPEG_OFFSET) return fallback();
+        }
+    }
+
+    ImageHeader m_header;
+    uint64_t m_offset = 0;
+    int m_segments = 0;
+    bool m_tgaHint = false;
+    bool m_done = false;
+    bool m_fallback = false;
+};
+
+// 只读打开，按偏移读取（不移动共享的文件位置）
+class ProbeFile {
+public:
+    ProbeFile() = default;
+    ~ProbeFile() { close(); }
+    ProbeFile(const ProbeFile&) = delete;
+    ProbeFile& operator=(const ProbeFile&) = delete;
+
+    bool open(const std::string& path) {
+#if defined(_WIN32)
+        m_handle = CreateFileW(std::filesystem::path(path).wstring().c_str(), GENERIC_READ,
+                               FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+        return m_handle != INVALID_HANDLE_VALUE;
+#else
+        m_fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        return m_fd >= 0;
+#endif
+    }
+
+    void close() {
+#if defined(_WIN32)
+        if (m_handle != INVALID_HANDLE_VALUE) CloseHandle(m_handle);
+        m_handle = INVALID_HANDLE_VALUE;
+#else
+        if (m_fd >= 0) ::close(m_fd);
+        m_fd = -1;
+#endif
+    }
+
+    // 返回读到的字节数，出错时返回 -1
+    long long read(uint64_t offset, unsigned char* buffer, uint32_t length) {
+#if defined(_WIN32)
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFu);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        DWORD bytes = 0;
+        if (!ReadFile(m_handle, buffer, length, &bytes, &overlapped)) {
+            return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+        }
+        return bytes;
+#else
+        ssize_t bytes;
+        do {
+            bytes = ::pread(m_fd, buffer, length, static_cast<off_t>(offset));
+        } while (bytes < 0 && errno == EINTR);
+        return bytes;
+#endif
+    }
+
+#if !defined(_WIN32)
+    int fd() const { return m_fd; }
+#endif
+
+private:
+#if defined(_WIN32)
+    HANDLE m_handle = INVALID_HANDLE_VALUE;
+#else
+    int m_fd = -1;
+#endif
+};
+
+// 逐步读取直到解析完成
+void runProbe(ProbeState& state, ProbeFile& file) {
+    unsigned char buffer[HeaderProbe::READ_SIZE];
+    while (!state.done()) {
+        long long bytes = file.read(state.offset(), buffer, HeaderProbe::READ_SIZE);
+        if (bytes <= 0) {
+            state.fail();
+            break;
+        }
+        state.feed(buffer, static_cast<size_t>(bytes));
+    }
+}
+
+// 其他格式：读入文件后交给解码器的 info
+bool probeWithDecoder(const std::string& path, ImageHeader& header) {
+    FileBuffer file;
+    if (!file.open(path)) return false;
+    const ImageDecoder* decoder = ImageDecoderRegistry::getInstance().find(file.data(), file.size());
+    if (!decoder || !decoder->info) return false;
+    int channels = 0;
+    header.type = decoder->type;
+    header.valid = decoder->info(file.data(), file.size(), header.width, header.height, channels);
+    return header.valid;
+}
+
+#if defined(VIMAG_IO_URING) && defined(__linux__)
+// 同一批文件每一步的读取一起提交，一次系统调用完成一批
+void probeBatchUring(io_uring& ring, const std::vector<std::string>& paths, std::vector<ImageHeader>& headers,
+                     size_t begin, size_t end) {
+    const size_t count = end - begin;
+    std::vector<ProbeState> states;
+    states.reserve(count);
+    std::vector<ProbeFile> files(count);
+    std::vector<unsigned char> buffers(count * HeaderProbe::READ_SIZE);
+    std::vector<size_t> pending;
+    for (size_t k = 0; k < count; ++k) {
+        states.emplace_back(hasTgaExtension(paths[begin + k]));
+        if (files[k].open(paths[begin + k])) {
+            pending.push_back(k);
+        } else {
+            states[k].fail();
+        }
+    }
+
+    while (!pending.empty()) {
+        for (size_t k : pending) {
+            io_uring_sqe* sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_read(sqe, files[k].fd(), buffers.data() + k * HeaderProbe::READ_SIZE,
+                               HeaderProbe::READ_SIZE, states[k].offset());
+            io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(static_cast<uintptr_t>(k)));
+        }
+        if (io_uring_submit_and_wait(&ring, static_cast<unsigned>(pending.size())) < 0) {
+            // 提交失败：剩下的改为逐个读取
+            for (size_t k : pending) runProbe(states[k], files[k]);
+            break;
+        }
+        for (size_t n = 0; n < pending.size(); ++n) {
+            io_uring_cqe* cqe = nullptr;
+            if (io_uring_wait_cqe(&ring, &cqe) < 0 || !cqe) break;
+            const size_t k = static_cast<size_t>(reinterpret_cast<uintptr_t>(io_uring_cqe_get_data(cqe)));
+            const int result = cqe->res;
+            io_uring_cqe_seen(&ring, cqe);
+            if (result <= 0) {
+                states[k].fail();
+            } else {
+                states[k].feed(buffers.data() + k * HeaderProbe::READ_SIZE, static_cast<size_t>(result));
+            }
+        }
+        pending.erase(std::remove_if(pending.begin(), pending.end(), [&](size_t k) { return states[k].done(); }),
+                      pending.end());
+    }
+
+    for (size_t k = 0; k < count; ++k) {
+        files[k].close();
+        headers[begin + k] = states[k].header();
+        if (states[k].needsFallback()) probeWithDecoder(paths[begin + k], headers[begin + k]);
+    }
+}
+#endif
+
+} // namespace
+
+bool HeaderProbe::probe(const std::string& path, ImageHeader& header) {
+    header = ImageHeader();
+    ProbeState state(hasTgaExtension(path));
+    {
+        ProbeFile file;
+        if (!file.open(path)) return false;
+        runProbe(state, file);
+    }
+    header = state.header();
+    if (state.needsFallback()) return probeWithDecoder(path, header);
+    return header.valid;
+}
+
+void HeaderProbe::probeAll(const std::vector<std::string>& paths, std::vector<ImageHeader>& headers, int threads) {
+    headers.assign(paths.size(), ImageHeader());
+    if (paths.empty()) return;
+    const size_t batches = (paths.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+    const unsigned threadCount = static_cast<unsigned>(std::min<size_t>(
+        threads > 0 ? static_cast<size_t>(threads) : std::max(2u, std::thread::hardware_concurrency()), batches));
+    std::atomic<size_t> next{0};
+
+    auto worker = [&]() {
+#if defined(VIMAG_IO_URING) && defined(__linux__)
+        io_uring ring;
+        const bool uring = io_uring_queue_init(static_cast<unsigned>(BATCH_SIZE), &ring, 0) == 0;
+#endif
+        for (;;) {
+            const size_t batch = next.fetch_add(1);
+            if (batch >= batches) break;
+            const size_t begin = batch * BATCH_SIZE;
+            const size_t end = std::min(begin + BATCH_SIZE, paths.size());
+#if defined(VIMAG_IO_URING) && defined(__linux__)
+            if (uring) {
+                probeBatchUring(ring, paths, headers, begin, end);
+                continue;
+            }
+#endif
+            for (size_t i = begin; i < end; ++i) {
+                probe(paths[i], headers[i]);
+            }
+        }
+#if defined(VIMAG_IO_URING) && defined(__linux__)
+        if (uring) io_uring_queue_exit(&ring);
+#endif
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned t = 1; t < threadCount; ++t) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) thread.join();
+}
+
+bool HeaderProbe::ioUringAvailable() {
+#if defined(VIMAG_IO_URING) && defined(__linux__)
+    static const bool available = []() {
+        io_uring ring;
+        if (io_uring_queue_init(4, &ring, 0) != 0) return false;
+        io_uring_queue_exit(&ring);
+        return true;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
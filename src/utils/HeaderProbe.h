@@ -0,0 +1,45 @@
+#pragma once
+#include "ImageDecoder.h"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// 从文件头读到的图片信息
+struct ImageHeader {
+    ImageType type = UNKNOWN;
+    int width = 0;
+    int height = 0;
+    bool valid = false;
+    uint32_t bytesRead = 0;     // 实际读取的字节数
+    uint32_t reads = 0;         // 读取次数
+};
+
+/**
+ * @class HeaderProbe
+ * @brief 只读取文件头取得图片尺寸，不解码
+ * @description 按格式只读需要的字节：PNG 读到 IHDR，GIF、BMP、PSD、TGA 读固定长度的文件头，
+ *              JPEG 从 SOI 开始逐段跳过，只读每段开头几个字节，直到 SOF 段（段数和偏移都有上限）。
+ *              解析是一个状态机，每一步给出下一次要读的偏移和长度：
+ *              单个文件用普通的定位读取逐步完成；批量时各文件同一步的读取一起提交，
+ *              编译时启用 VIMAG_IO_URING（xmake f --io_uring=y）后在 Linux 上用 io_uring 一次提交一批。
+ *              HDR、TIFF 等其他格式退回到读入整个文件后用解码器的 info 解析。
+ */
+class HeaderProbe {
+public:
+    static constexpr uint32_t READ_SIZE = 64;               // 每次读取的字节数
+    static constexpr uint32_t MAX_JPEG_OFFSET = 1u << 20;   // JPEG 查找 SOF 的最大偏移
+    static constexpr int MAX_JPEG_SEGMENTS = 64;
+    static constexpr size_t BATCH_SIZE = 64;                // 批量时每个线程同时处理的文件数
+
+    // 读取单个文件的尺寸
+    static bool probe(const std::string& path, ImageHeader& header);
+    /**
+     * @brief 批量读取尺寸
+     * @param headers 与 paths 一一对应
+     * @param threads 线程数，0 表示按 CPU 核数
+     */
+    static void probeAll(const std::vector<std::string>& paths, std::vector<ImageHeader>& headers, int threads = 0);
+
+    // 编译时启用了 io_uring 且当前系统可用
+    static bool ioUringAvailable();
+};
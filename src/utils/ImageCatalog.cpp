@@ -0,0 +1,419 @@
+#include "ImageCatalog.h"
+#include <algorithm>
+#include <numeric>
+
+namespace {
+
+// 目录 + 分隔符 + 文件名，不拼接字符串就能逐字符比较
+struct JoinedPath {
+    std::string_view directory;
+    bool separator;
+    std::string_view name;
+
+    JoinedPath(std::string_view dir, std::string_view file)
+        : directory(dir), separator(!dir.empty() && dir.back() != '/'), name(file) {}
+
+    size_t size() const { return directory.size() + (separator ? 1 : 0) + name.size(); }
+    unsigned char at(size_t i) const {
+        if (i < directory.size()) return static_cast<unsigned char>(directory[i]);
+        i -= directory.size();
+        if (separator) {
+            if (i == 0) return '/';
+            i -= 1;
+        }
+        return static_cast<unsigned char>(name[i]);
+    }
+};
+
+// '/' 排在所有字符之前，结果与 fs::path 逐个路径元素比较的顺序一致
+int compareJoined(const JoinedPath& a, const JoinedPath& b) {
+    const size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; ++i) {
+        unsigned char ca = a.at(i);
+        unsigned char cb = b.at(i);
+        if (ca == cb) continue;
+        int ka = ca == '/' ? 0 : ca + 1;
+        int kb = cb == '/' ? 0 : cb + 1;
+        return ka < kb ? -1 : 1;
+    }
+    if (a.size() == b.size()) return 0;
+    return a.size() < b.size() ? -1 : 1;
+}
+
+template <typename T>
+void permuteColumn(std::vector<T>& column, const std::vector<uint32_t>& order) {
+    if (column.empty()) return;
+    std::vector<T> sorted(column.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted[i] = column[order[i]];
+    }
+    column.swap(sorted);
+}
+
+template <typename T>
+void eraseColumn(std::vector<T>& column, size_t begin, size_t end) {
+    if (column.empty()) return;
+    column.erase(column.begin() + begin, column.begin() + end);
+}
+
+template <typename T>
+void insertColumn(std::vector<T>& column, size_t index, T value) {
+    column.insert(column.begin() + index, value);
+}
+
+} // namespace
+
+void ImageCatalog::clear() {
+    m_directories.clear();
+    m_directoryIds.clear();
+    m_names.clear();
+    m_directory.clear();
+    m_nameOffset.clear();
+    m_nameLength.clear();
+    m_extension.clear();
+    m_mtime.clear();
+    m_fileSize.clear();
+    m_width.clear();
+    m_height.clear();
+    m_orientation.clear();
+    m_hasMetadata.clear();
+    m_captureTime.clear();
+    m_slots.clear();
+    m_lookupValid = true;
+}
+
+void ImageCatalog::reserve(size_t count) {
+    m_directory.reserve(count);
+    m_nameOffset.reserve(count);
+    m_nameLength.reserve(count);
+    m_extension.reserve(count);
+    m_names.reserve(count * 16);
+}
+
+std::string ImageCatalog::normalizeDirectory(std::string directory) {
+    // 去掉末尾的分隔符（"./" -> "."），保留根目录 "/" 和 "C:/"
+    while (directory.size() > 1 && directory.back() == '/' &&
+           !(directory.size() == 3 && directory[1] == ':')) {
+        directory.pop_back();
+    }
+    return directory;
+}
+
+void ImageCatalog::splitPath(const fs::path& path, std::string& directory, std::string& name) {
+    name = path.filename().u8string();
+    directory = normalizeDirectory(path.parent_path().generic_u8string());
+}
+
+uint64_t ImageCatalog::hashEntry(uint32_t directory, std::string_view name) {
+    // FNV-1a，混入目录编号
+    uint64_t hash = 1469598103934665603ull ^ (static_cast<uint64_t>(directory) * 0x9E3779B97F4A7C15ull);
+    for (unsigned char c : name) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint32_t ImageCatalog::addDirectory(std::string_view directory) {
+    std::string key = normalizeDirectory(std::string(directory));
+    auto it = m_directoryIds.find(key);
+    if (it != m_directoryIds.end()) return it->second;
+    uint32_t id = static_cast<uint32_t>(m_directories.size());
+    m_directories.push_back(key);
+    m_directoryIds.emplace(std::move(key), id);
+    return id;
+}
+
+size_t ImageCatalog::add(const fs::path& path) {
+    std::string directory, name;
+    splitPath(path, directory, name);
+    return add(addDirectory(directory), name);
+}
+
+size_t ImageCatalog::add(uint32_t directory, std::string_view name) {
+    size_t existing = lookup(directory, name);
+    if (existing != npos) return existing;
+
+    const size_t index = size();
+    const size_t dot = name.rfind('.');
+    m_directory.push_back(directory);
+    m_nameOffset.push_back(static_cast<uint32_t>(m_names.size()));
+    m_nameLength.push_back(static_cast<uint16_t>(name.size()));
+    m_extension.push_back(static_cast<uint16_t>(dot == std::string_view::npos ? name.size() : dot));
+    m_names.append(name.data(), name.size());
+    if (!m_hasMetadata.empty()) {
+        m_mtime.push_back(0);
+        m_fileSize.push_back(0);
+        m_width.push_back(0);
+        m_height.push_back(0);
+        m_orientation.push_back(0);
+        m_hasMetadata.push_back(0);
+    }
+    if (!m_captureTime.empty()) m_captureTime.push_back(0);
+    if (m_lookupValid) insertSlot(index);
+    return index;
+}
+
+void ImageCatalog::assign(const std::vector<fs::path>& paths) {
+    clear();
+    reserve(paths.size());
+    for (const auto& path : paths) {
+        add(path);
+    }
+    sort();
+}
+
+bool ImageCatalog::less(size_t a, size_t b) const {
+    if (m_directory[a] == m_directory[b]) return name(a) < name(b);
+    return compareJoined(JoinedPath(m_directories[m_directory[a]], name(a)),
+                         JoinedPath(m_directories[m_directory[b]], name(b))) < 0;
+}
+
+int ImageCatalog::compare(size_t index, std::string_view directory, std::string_view file) const {
+    return compareJoined(JoinedPath(m_directories[m_directory[index]], name(index)), JoinedPath(directory, file));
+}
+
+void ImageCatalog::sort() {
+    const size_t count = size();
+    bool sorted = true;
+    for (size_t i = 1; i < count && sorted; ++i) {
+        sorted = !less(i, i - 1);
+    }
+    if (sorted) return;
+
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return less(a, b); });
+    permute(order);
+}
+
+void ImageCatalog::permute(const std::vector<uint32_t>& order) {
+    if (order.size() != size()) return;
+    permuteColumn(m_directory, order);
+    permuteColumn(m_nameOffset, order);
+    permuteColumn(m_nameLength, order);
+    permuteColumn(m_extension, order);
+    permuteColumn(m_mtime, order);
+    permuteColumn(m_fileSize, order);
+    permuteColumn(m_width, order);
+    permuteColumn(m_height, order);
+    permuteColumn(m_orientation, order);
+    permuteColumn(m_hasMetadata, order);
+    permuteColumn(m_captureTime, order);
+    m_lookupValid = false;
+}
+
+size_t ImageCatalog::lowerBound(const fs::path& path) const {
+    std::string directory, file;
+    splitPath(path, directory, file);
+    size_t low = 0;
+    size_t high = size();
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (compare(mid, directory, file) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+bool ImageCatalog::insertSorted(const fs::path& path) {
+    std::string directory, file;
+    splitPath(path, directory, file);
+    const uint32_t directoryId = addDirectory(directory);
+    if (lookup(directoryId, file) != npos) return false;
+
+    const size_t index = lowerBound(path);
+    const size_t dot = file.rfind('.');
+    insertColumn(m_directory, index, directoryId);
+    insertColumn(m_nameOffset, index, static_cast<uint32_t>(m_names.size()));
+    insertColumn(m_nameLength, index, static_cast<uint16_t>(file.size()));
+    insertColumn(m_extension, index, static_cast<uint16_t>(dot == std::string::npos ? file.size() : dot));
+    m_names += file;
+    if (!m_hasMetadata.empty()) {
+        insertColumn<int64_t>(m_mtime, index, 0);
+        insertColumn<uint64_t>(m_fileSize, index, 0);
+        insertColumn<int32_t>(m_width, index, 0);
+        insertColumn<int32_t>(m_height, index, 0);
+        insertColumn<int16_t>(m_orientation, index, 0);
+        insertColumn<uint8_t>(m_hasMetadata, index, 0);
+    }
+    if (!m_captureTime.empty()) insertColumn<int64_t>(m_captureTime, index, 0);
+
+    if (m_lookupValid) {
+        // 后面的项整体后移一位
+        for (auto& slot : m_slots) {
+            if (slot > index) slot++;
+        }
+        insertSlot(index);
+    }
+    return true;
+}
+
+void ImageCatalog::erase(size_t begin, size_t end) {
+    end = std::min(end, size());
+    if (begin >= end) return;
+    // 文件名留在字符串区中，下次整体替换列表时回收
+    eraseColumn(m_directory, begin, end);
+    eraseColumn(m_nameOffset, begin, end);
+    eraseColumn(m_nameLength, begin, end);
+    eraseColumn(m_extension, begin, end);
+    eraseColumn(m_mtime, begin, end);
+    eraseColumn(m_fileSize, begin, end);
+    eraseColumn(m_width, begin, end);
+    eraseColumn(m_height, begin, end);
+    eraseColumn(m_orientation, begin, end);
+    eraseColumn(m_hasMetadata, begin, end);
+    eraseColumn(m_captureTime, begin, end);
+    m_lookupValid = false;
+}
+
+void ImageCatalog::insertSlot(size_t index) const {
+    // 装载率保持在一半以下
+    if ((size() + 1) * 2 > m_slots.size()) {
+        rebuildLookup();
+        return;
+    }
+    const size_t mask = m_slots.size() - 1;
+    size_t slot = hashEntry(m_directory[index], name(index)) & mask;
+    while (m_slots[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    m_slots[slot] = static_cast<uint32_t>(index + 1);
+}
+
+void ImageCatalog::rebuildLookup() const {
+    size_t capacity = 16;
+    while (capacity < (size() + 1) * 2) capacity <<= 1;
+    m_slots.assign(capacity, 0);
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < size(); ++i) {
+        size_t slot = hashEntry(m_directory[i], name(i)) & mask;
+        while (m_slots[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        m_slots[slot] = static_cast<uint32_t>(i + 1);
+    }
+    m_lookupValid = true;
+}
+
+size_t ImageCatalog::lookup(uint32_t directory, std::string_view file) const {
+    if (!m_lookupValid) rebuildLookup();
+    if (m_slots.empty()) return npos;
+    const size_t mask = m_slots.size() - 1;
+    size_t slot = hashEntry(directory, file) & mask;
+    while (m_slots[slot] != 0) {
+        size_t index = m_slots[slot] - 1;
+        if (m_directory[index] == directory && name(index) == file) return index;
+        slot = (slot + 1) & mask;
+    }
+    return npos;
+}
+
+size_t ImageCatalog::lookup(std::string_view directory, std::string_view file) const {
+    auto it = m_directoryIds.find(std::string(directory));
+    if (it == m_directoryIds.end()) return npos;
+    return lookup(it->second, file);
+}
+
+size_t ImageCatalog::find(const fs::path& path) const {
+    std::string directory, file;
+    splitPath(path, directory, file);
+    return lookup(directory, file);
+}
+
+size_t ImageCatalog::find(std::string_view directory, std::string_view name) const {
+    return lookup(directory, name);
+}
+
+bool ImageCatalog::isUnder(size_t index, const fs::path& path) const {
+    const std::string prefix = normalizeDirectory(path.generic_u8string());
+    const JoinedPath entry(m_directories[m_directory[index]], name(index));
+    if (entry.size() < prefix.size()) return false;
+    for (size_t i = 0; i < prefix.size(); ++i) {
+        if (entry.at(i) != static_cast<unsigned char>(prefix[i])) return false;
+    }
+    return entry.size() == prefix.size() || prefix.back() == '/' || entry.at(prefix.size()) == '/';
+}
+
+std::string_view ImageCatalog::name(size_t index) const {
+    return std::string_view(m_names.data() + m_nameOffset[index], m_nameLength[index]);
+}
+
+std::string_view ImageCatalog::extension(size_t index) const {
+    return name(index).substr(m_extension[index]);
+}
+
+std::string ImageCatalog::pathString(size_t index) const {
+    const std::string& directory = m_directories[m_directory[index]];
+    std::string_view file = name(index);
+    std::string result;
+    result.reserve(directory.size() + 1 + file.size());
+    result = directory;
+    if (!directory.empty() && directory.back() != '/') result += '/';
+    result += file;
+    return result;
+}
+
+fs::path ImageCatalog::path(size_t index) const {
+    return fs::u8path(pathString(index));
+}
+
+bool ImageCatalog::getMetadata(size_t index, ImageIndexInfo& info) const {
+    if (m_hasMetadata.empty() || !m_hasMetadata[index]) return false;
+    info.mtime = m_mtime[index];
+    info.size = m_fileSize[index];
+    info.width = m_width[index];
+    info.height = m_height[index];
+    info.orientation = m_orientation[index];
+    return true;
+}
+
+void ImageCatalog::setMetadata(size_t index, const ImageIndexInfo& info) {
+    if (m_hasMetadata.empty()) {
+        const size_t count = size();
+        m_mtime.assign(count, 0);
+        m_fileSize.assign(count, 0);
+        m_width.assign(count, 0);
+        m_height.assign(count, 0);
+        m_orientation.assign(count, 0);
+        m_hasMetadata.assign(count, 0);
+    }
+    // 文件变化后原来的拍摄时间作废
+    if (!m_captureTime.empty() && (m_mtime[index] != info.mtime || m_fileSize[index] != info.size)) {
+        m_captureTime[index] = 0;
+    }
+    m_mtime[index] = info.mtime;
+    m_fileSize[index] = info.size;
+    m_width[index] = info.width;
+    m_height[index] = info.height;
+    m_orientation[index] = static_cast<int16_t>(info.orientation);
+    m_hasMetadata[index] = 1;
+}
+
+bool ImageCatalog::getCaptureTime(size_t index, int64_t& time) const {
+    if (m_captureTime.empty() || m_captureTime[index] == 0) return false;
+    time = m_captureTime[index];
+    return true;
+}
+
+void ImageCatalog::setCaptureTime(size_t index, int64_t time) {
+    if (m_captureTime.empty()) m_captureTime.assign(size(), 0);
+    m_captureTime[index] = time;
+}
+
+size_t ImageCatalog::memoryBytes() const {
+    size_t bytes = m_names.capacity() + m_slots.capacity() * sizeof(uint32_t);
+    bytes += m_directory.capacity() * sizeof(uint32_t) + m_nameOffset.capacity() * sizeof(uint32_t);
+    bytes += m_nameLength.capacity() * sizeof(uint16_t) + m_extension.capacity() * sizeof(uint16_t);
+    bytes += m_mtime.capacity() * sizeof(int64_t) + m_fileSize.capacity() * sizeof(uint64_t);
+    bytes += (m_width.capacity() + m_height.capacity()) * sizeof(int32_t);
+    bytes += m_orientation.capacity() * sizeof(int16_t) + m_hasMetadata.capacity();
+    bytes += m_captureTime.capacity() * sizeof(int64_t);
+    for (const auto& directory : m_directories) {
+        bytes += directory.capacity() * 2 + sizeof(std::string) * 2;
+    }
+    return bytes;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "DirectoryIndex.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+/**
+ * @class ImageCatalog
+ * @brief 图片列表（按列存储）
+ * @description 目录字符串只保存一份（按编号引用），文件名连续存放在同一块字符串区中，
+ *              每张图片只占目录编号、文件名偏移、长度和扩展名位置几个整数，
+ *              百万张图片时不再有上百万个 fs::path 和 std::string 的小块堆内存。
+ *              路径到索引的查找使用开放寻址哈希表，是 O(1) 的。
+ *              路径统一保存为 UTF-8、'/' 分隔；排序顺序与 fs::path 的比较顺序一致。
+ *              尺寸、修改时间等元数据列在第一次写入时才分配。只在主线程使用（或自行加锁）。
+ */
+class ImageCatalog {
+public:
+    static constexpr size_t npos = static_cast<size_t>(-1);
+
+    size_t size() const { return m_directory.size(); }
+    bool empty() const { return m_directory.empty(); }
+    void clear();
+    void reserve(size_t count);
+
+    // 追加一张图片（不保持顺序），已存在时返回原索引
+    size_t add(const fs::path& path);
+    // 目录为 UTF-8、'/' 分隔的字符串；批量添加同一目录的图片时先取得目录编号
+    uint32_t addDirectory(std::string_view directory);
+    size_t add(uint32_t directory, std::string_view name);
+
+    // 用路径列表整体替换并排序
+    void assign(const std::vector<fs::path>& paths);
+    // 按路径排序
+    void sort();
+    // 按给定顺序重排，order[i] 为新位置 i 上原来的索引
+    void permute(const std::vector<uint32_t>& order);
+    // 在有序列表中按顺序插入，已存在时返回 false
+    bool insertSorted(const fs::path& path);
+    // 删除 [begin, end)
+    void erase(size_t begin, size_t end);
+
+    // 路径对应的索引，找不到返回 npos
+    size_t find(const fs::path& path) const;
+    // 目录为 UTF-8、'/' 分隔的字符串（与 directoryString 相同的写法），不构造 fs::path
+    size_t find(std::string_view directory, std::string_view name) const;
+    // 有序列表中第一个不小于 path 的位置
+    size_t lowerBound(const fs::path& path) const;
+    // 第 index 项是 path 本身或位于目录 path 之下
+    bool isUnder(size_t index, const fs::path& path) const;
+    // 第 a 项的路径排在第 b 项之前
+    bool less(size_t a, size_t b) const;
+
+    fs::path path(size_t index) const;
+    std::string pathString(size_t index) const;     // UTF-8，'/' 分隔
+    std::string_view name(size_t index) const;
+    std::string_view extension(size_t index) const; // 含 '.'，没有时为空
+    uint32_t directoryId(size_t index) const { return m_directory[index]; }
+    const std::string& directoryString(uint32_t directory) const { return m_directories[directory]; }
+    size_t directoryCount() const { return m_directories.size(); }
+
+    // 元数据列
+    bool getMetadata(size_t index, ImageIndexInfo& info) const;
+    void setMetadata(size_t index, const ImageIndexInfo& info);
+    // EXIF 拍摄时间（YYYYMMDDhhmmss），与元数据中的修改时间、大小对应；没有 EXIF 时为 -1
+    bool getCaptureTime(size_t index, int64_t& time) const;
+    void setCaptureTime(size_t index, int64_t time);
+
+    // 估算占用的内存
+    size_t memoryBytes() const;
+
+private:
+    static void splitPath(const fs::path& path, std::string& directory, std::string& name);
+    static std::string normalizeDirectory(std::string directory);
+    static uint64_t hashEntry(uint32_t directory, std::string_view name);
+    // 第 index 项与 (directory, name) 按路径顺序比较
+    int compare(size_t index, std::string_view directory, std::string_view name) const;
+    size_t lookup(uint32_t directory, std::string_view name) const;
+    size_t lookup(std::string_view directory, std::string_view name) const;
+    void insertSlot(size_t index) const;
+    void rebuildLookup() const;
+
+    // 目录表（去重）
+    std::vector<std::string> m_directories;
+    std::unordered_map<std::string, uint32_t> m_directoryIds;
+
+    // 每张图片一项
+    std::string m_names;                     // 所有文件名连续存放
+    std::vector<uint32_t> m_directory;
+    std::vector<uint32_t> m_nameOffset;
+    std::vector<uint16_t> m_nameLength;
+    std::vector<uint16_t> m_extension;       // 扩展名在文件名中的起点，没有时等于长度
+
+    // 元数据列（未写入过时为空）
+    std::vector<int64_t> m_mtime;
+    std::vector<uint64_t> m_fileSize;
+    std::vector<int32_t> m_width;
+    std::vector<int32_t> m_height;
+    std::vector<int16_t> m_orientation;
+    std::vector<uint8_t> m_hasMetadata;
+    std::vector<int64_t> m_captureTime;      // 0 表示未读取
+
+    // 开放寻址哈希表，保存 索引+1（0 表示空位）；排序、删除后延迟重建
+    mutable std::vector<uint32_t> m_slots;
+    mutable bool m_lookupValid = true;
+};
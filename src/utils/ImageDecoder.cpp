@@ -0,0 +1,216 @@
+#include "ImageDecoder.h"
+#include "stb_image.h"
+#include <iostream>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+bool hasPrefix(const unsigned char* data, size_t size, const char* magic, size_t length) {
+    return size >= length && std::memcmp(data, magic, length) == 0;
+}
+
+bool stbInfo(const unsigned char* data, size_t size, int& width, int& height, int& channels) {
+    if (size > static_cast<size_t>(INT_MAX)) return false;
+    return stbi_info_from_memory(data, static_cast<int>(size), &width, &height, &channels) != 0;
+}
+
+unsigned char* stbDecode(const unsigned char* data, size_t size, int& width, int& height, int& channels, int desiredChannels) {
+    if (size > static_cast<size_t>(INT_MAX)) return nullptr;
+    return stbi_load_from_memory(data, static_cast<int>(size), &width, &height, &channels, desiredChannels);
+}
+
+// JPEG 可以在 IDCT 阶段直接按 1/2、1/4、1/8 输出；选择不小于目标尺寸的最大缩小倍数
+int chooseJpegScaleShift(int longSide, int maxSide) {
+    int shift = 0;
+    while (shift < 3 && (longSide >> (shift + 1)) >= maxSide) {
+        shift++;
+    }
+    return shift;
+}
+
+unsigned char* jpegDecodeScaled(const unsigned char* data, size_t size, int maxSide,
+                                int& width, int& height, int& channels, int desiredChannels) {
+    if (size > static_cast<size_t>(INT_MAX)) return nullptr;
+    int sourceWidth = 0, sourceHeight = 0, sourceChannels = 0;
+    if (!stbInfo(data, size, sourceWidth, sourceHeight, sourceChannels)) return nullptr;
+
+    int scaleShift = chooseJpegScaleShift(std::max(sourceWidth, sourceHeight), maxSide);
+    if (scaleShift == 0) {
+        return stbDecode(data, size, width, height, channels, desiredChannels);
+    }
+    return stbi_load_jpeg_scaled_from_memory(data, static_cast<int>(size), &width, &height, &channels,
+                                             desiredChannels, scaleShift);
+}
+
+// TGA 没有魔数，只能检查文件头字段是否合理，再由 stb 确认
+bool probeTga(const unsigned char* data, size_t size) {
+    if (size < 18) return false;
+    const unsigned char colorMapType = data[1];
+    const unsigned char imageType = data[2];
+    if (colorMapType > 1) return false;
+    if (imageType != 1 && imageType != 2 && imageType != 3 && imageType != 9 && imageType != 10 && imageType != 11) {
+        return false;
+    }
+    int width = 0, height = 0, channels = 0;
+    return stbInfo(data, size, width, height, channels);
+}
+
+ImageDecoder makeStbDecoder(const std::string& name, ImageType type, ImageDecoder::ProbeFunc probe) {
+    ImageDecoder decoder;
+    decoder.name = name;
+    decoder.type = type;
+    decoder.probe = std::move(probe);
+    decoder.info = stbInfo;
+    decoder.decode = stbDecode;
+    return decoder;
+}
+
+thread_local DecodeCancelScope* t_cancelScope = nullptr;
+
+int stbCancelCheck() {
+    return DecodeCancelScope::isCancelled() ? 1 : 0;
+}
+
+} // namespace
+
+DecodeCancelScope::DecodeCancelScope(std::function<bool()> isCancelled)
+    : m_check(std::move(isCancelled)), m_previous(t_cancelScope) {
+    t_cancelScope = this;
+}
+
+DecodeCancelScope::~DecodeCancelScope() {
+    t_cancelScope = m_previous;
+}
+
+bool DecodeCancelScope::isCancelled() {
+    return t_cancelScope && t_cancelScope->m_check && t_cancelScope->m_check();
+}
+
+const char* imageTypeName(ImageType type) {
+    switch (type) {
+        case PNG: return "PNG";
+        case JPG: return "JPEG";
+        case GIF: return "GIF";
+        case BMP: return "BMP";
+        case TIFF: return "TIFF";
+        case HDR: return "HDR";
+        case TGA: return "TGA";
+        case PSD: return "PSD";
+        default: return "UNKNOWN";
+    }
+}
+
+ImageDecoderRegistry& ImageDecoderRegistry::getInstance() {
+    static ImageDecoderRegistry instance;
+    return instance;
+}
+
+ImageDecoderRegistry::ImageDecoderRegistry() {
+    stbi_set_cancel_check(stbCancelCheck);
+    registerBuiltinDecoders();
+}
+
+void ImageDecoderRegistry::registerBuiltinDecoders() {
+    ImageDecoder jpeg = makeStbDecoder("stb-jpeg", JPG, [](const unsigned char* data, size_t size) {
+        return size >= 3 && data[0] == 0xFF && data[1] == 0xD8 && data[2] == 0xFF;
+    });
+    jpeg.decodeScaled = jpegDecodeScaled;
+    registerDecoder(jpeg, false);
+
+    registerDecoder(makeStbDecoder("stb-png", PNG, [](const unsigned char* data, size_t size) {
+        return hasPrefix(data, size, "\x89PNG\r\n\x1a\n", 8);
+    }), false);
+    registerDecoder(makeStbDecoder("stb-gif", GIF, [](const unsigned char* data, size_t size) {
+        return hasPrefix(data, size, "GIF87a", 6) || hasPrefix(data, size, "GIF89a", 6);
+    }), false);
+    registerDecoder(makeStbDecoder("stb-bmp", BMP, [](const unsigned char* data, size_t size) {
+        return hasPrefix(data, size, "BM", 2);
+    }), false);
+    registerDecoder(makeStbDecoder("stb-psd", PSD, [](const unsigned char* data, size_t size) {
+        return hasPrefix(data, size, "8BPS", 4);
+    }), false);
+    registerDecoder(makeStbDecoder("stb-hdr", HDR, [](const unsigned char* data, size_t size) {
+        return hasPrefix(data, size, "#?RADIANCE\n", 11) || hasPrefix(data, size, "#?RGBE\n", 7);
+    }), false);
+    // 放在最后：其他格式都不匹配时才按 TGA 检查
+    registerDecoder(makeStbDecoder("stb-tga", TGA, probeTga), false);
+}
+
+void ImageDecoderRegistry::registerDecoder(const ImageDecoder& decoder, bool front) {
+    if (!decoder.probe || !decoder.decode) {
+        std::cerr << "[ImageDecoder] Decoder " << decoder.name << " needs probe and decode" << std::endl;
+        return;
+    }
+    auto entry = std::make_shared<Entry>();
+    entry->decoder = decoder;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (front) {
+        m_entries.insert(m_entries.begin(), entry);
+    } else {
+        m_entries.push_back(entry);
+    }
+}
+
+const ImageDecoder* ImageDecoderRegistry::find(const unsigned char* data, size_t size) const {
+    if (!data || size == 0) return nullptr;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_entries) {
+        if (entry->decoder.probe(data, size)) {
+            return &entry->decoder;
+        }
+    }
+    return nullptr;
+}
+
+ImageType ImageDecoderRegistry::sniff(const unsigned char* data, size_t size) const {
+    const ImageDecoder* decoder = find(data, size);
+    return decoder ? decoder->type : UNKNOWN;
+}
+
+unsigned char* ImageDecoderRegistry::decode(const ImageDecoder& decoder, const unsigned char* data, size_t size,
+                                            int maxSide, int& width, int& height, int& channels, int desiredChannels) {
+    auto start = std::chrono::steady_clock::now();
+    const bool scaled = maxSide > 0 && decoder.decodeScaled;
+    unsigned char* pixels = scaled
+        ? decoder.decodeScaled(data, size, maxSide, width, height, channels, desiredChannels)
+        : decoder.decode(data, size, width, height, channels, desiredChannels);
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_entries) {
+        if (&entry->decoder != &decoder) continue;
+        entry->decodes++;
+        if (scaled) entry->scaledDecodes++;
+        entry->totalMicros += static_cast<uint64_t>(micros);
+        break;
+    }
+    return pixels;
+}
+
+std::vector<ImageDecoderStats> ImageDecoderRegistry::getStats() const {
+    std::vector<ImageDecoderStats> stats;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const auto& entry : m_entries) {
+        ImageDecoderStats item;
+        item.name = entry->decoder.name;
+        item.decodes = entry->decodes.load();
+        item.scaledDecodes = entry->scaledDecodes.load();
+        item.totalMs = entry->totalMicros.load() / 1000.0;
+        stats.push_back(item);
+    }
+    return stats;
+}
+
+void ImageDecoderRegistry::printStats() const {
+    std::cout << "\n=== Image Decoder Stats ===" << std::endl;
+    for (const auto& item : getStats()) {
+        if (item.decodes == 0) continue;
+        std::cout << item.name << ": " << item.decodes << " decodes (" << item.scaledDecodes << " scaled), "
+                  << item.totalMs << " ms, avg " << (item.totalMs / item.decodes) << " ms" << std::endl;
+    }
+    std::cout << "============================" << std::endl;
+}
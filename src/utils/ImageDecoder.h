@@ -0,0 +1,118 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+// 图像格式（由文件头的魔数判断，不依赖扩展名）
+enum ImageType {
+    PNG, JPG, GIF, BMP, TIFF, HDR, TGA, PSD, UNKNOWN
+};
+
+/**
+ * @struct ImageDecoder
+ * @brief 一种图像格式的解码入口
+ * @description 所有入口都直接读取内存中的文件数据（通常是 FileBuffer 读入的缓冲区）
+ */
+struct ImageDecoder {
+    // 判断数据是否为该格式；通常只看开头几个字节
+    using ProbeFunc = std::function<bool(const unsigned char* data, size_t size)>;
+    // 读取尺寸和通道数，不解码像素
+    using InfoFunc = std::function<bool(const unsigned char* data, size_t size, int& width, int& height, int& channels)>;
+    // 完整解码，返回的像素用 stbi_image_free 释放
+    using DecodeFunc = std::function<unsigned char*(const unsigned char* data, size_t size,
+                                                    int& width, int& height, int& channels, int desiredChannels)>;
+    // 解码时直接缩小（可选）：结果长边不小于 maxSide，剩余比例由调用方再缩放
+    using DecodeScaledFunc = std::function<unsigned char*(const unsigned char* data, size_t size, int maxSide,
+                                                          int& width, int& height, int& channels, int desiredChannels)>;
+
+    std::string name;
+    ImageType type = UNKNOWN;
+    ProbeFunc probe;
+    InfoFunc info;
+    DecodeFunc decode;
+    DecodeScaledFunc decodeScaled;   // 可为空
+};
+
+// 单个解码器的统计，用于比较不同实现
+struct ImageDecoderStats {
+    std::string name;
+    uint64_t decodes = 0;
+    uint64_t scaledDecodes = 0;
+    double totalMs = 0.0;
+};
+
+/**
+ * @class ImageDecoderRegistry
+ * @brief 按文件头魔数选择解码器
+ * @description 内置基于 stb_image 的解码器；新的快速解码器可以通过 registerDecoder 注册，
+ *              先注册的优先匹配，无需修改 UITexture 或纹理缓存。
+ */
+class ImageDecoderRegistry {
+public:
+    // 判断格式需要的最多字节数
+    static constexpr size_t SNIFF_BYTES = 16;
+
+    // 单例模式
+    static ImageDecoderRegistry& getInstance();
+
+    // 禁止拷贝和赋值
+    ImageDecoderRegistry(const ImageDecoderRegistry&) = delete;
+    ImageDecoderRegistry& operator=(const ImageDecoderRegistry&) = delete;
+
+    // 注册解码器；front 为 true 时优先于已有的同格式解码器
+    void registerDecoder(const ImageDecoder& decoder, bool front = true);
+
+    // 按数据选择解码器，无法识别时返回 nullptr
+    const ImageDecoder* find(const unsigned char* data, size_t size) const;
+    ImageType sniff(const unsigned char* data, size_t size) const;
+
+    // 解码并记录耗时；maxSide > 0 且解码器支持时走缩小解码
+    unsigned char* decode(const ImageDecoder& decoder, const unsigned char* data, size_t size, int maxSide,
+                          int& width, int& height, int& channels, int desiredChannels);
+
+    std::vector<ImageDecoderStats> getStats() const;
+    void printStats() const;
+
+private:
+    ImageDecoderRegistry();
+    void registerBuiltinDecoders();
+
+    struct Entry {
+        ImageDecoder decoder;
+        std::atomic<uint64_t> decodes{0};
+        std::atomic<uint64_t> scaledDecodes{0};
+        std::atomic<uint64_t> totalMicros{0};
+    };
+
+    mutable std::mutex m_mutex;
+    std::vector<std::shared_ptr<Entry>> m_entries;
+};
+
+const char* imageTypeName(ImageType type);
+
+/**
+ * @class DecodeCancelScope
+ * @brief 为当前线程的解码设置取消检查
+ * @description 作用域内的 stb 解码会逐行（JPEG 每行 MCU、PNG 每行像素）调用检查函数，
+ *              返回 true 时中途放弃，已被新请求取代的解码不必跑完
+ */
+class DecodeCancelScope {
+public:
+    explicit DecodeCancelScope(std::function<bool()> isCancelled);
+    ~DecodeCancelScope();
+
+    DecodeCancelScope(const DecodeCancelScope&) = delete;
+    DecodeCancelScope& operator=(const DecodeCancelScope&) = delete;
+
+    // 当前线程的解码是否已被取消（作用域外总是 false）
+    static bool isCancelled();
+
+private:
+    std::function<bool()> m_check;
+    DecodeCancelScope* m_previous = nullptr;
+};
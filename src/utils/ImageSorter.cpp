@@ -0,0 +1,384 @@
+#include "ImageSorter.h"
+#include "HeaderProbe.h"
+#include "../TinyEXIF/EXIF.h"
+#include <iostream>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <ctime>
+#include <cctype>
+
+namespace {
+
+struct SortModeEntry {
+    SortMode mode;
+    const char* name;
+};
+
+const SortModeEntry SORT_MODES[] = {
+    { SortMode::Path, "path" },
+    { SortMode::Natural, "natural" },
+    { SortMode::CaptureDate, "capture_date" },
+    { SortMode::ModifiedTime, "modified_time" },
+    { SortMode::FileSize, "file_size" },
+    { SortMode::PixelCount, "pixel_count" },
+};
+
+double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 文件时间转为本地时间的 YYYYMMDDhhmmss，与 EXIF 拍摄时间可以直接比较
+int64_t localTimeKey(fs::file_time_type time) {
+    using namespace std::chrono;
+    auto system = time_point_cast<system_clock::duration>(time - fs::file_time_type::clock::now() + system_clock::now());
+    std::time_t seconds = system_clock::to_time_t(system);
+    std::tm local{};
+#if defined(_WIN32)
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    return (local.tm_year + 1900) * 10000000000ll + (local.tm_mon + 1) * 100000000ll + local.tm_mday * 1000000ll +
+           local.tm_hour * 10000ll + local.tm_min * 100ll + local.tm_sec;
+}
+
+// "YYYY:MM:DD HH:MM:SS" -> YYYYMMDDhhmmss，格式不对或全为 0 时返回 -1
+int64_t parseExifTime(const std::string& text) {
+    int64_t value = 0;
+    int digits = 0;
+    for (char c : text) {
+        if (c >= '0' && c <= '9') {
+            value = value * 10 + (c - '0');
+            if (++digits == 14) break;
+        }
+    }
+    return digits == 14 && value > 0 ? value : -1;
+}
+
+// 读取 JPEG 的 EXIF 拍摄时间
+int64_t readCaptureTime(const fs::path& path) {
+    TinyEXIF::EXIFInfo info;
+    FileEXIFStream stream(path);
+    if (info.parseFrom(stream) != TinyEXIF::PARSE_SUCCESS) return -1;
+    int64_t time = parseExifTime(info.DateTimeOriginal);
+    if (time < 0) time = parseExifTime(info.DateTimeDigitized);
+    if (time < 0) time = parseExifTime(info.DateTime);
+    return time;
+}
+
+// 分段排序后两两归并
+template <typename Compare>
+void parallelSort(std::vector<uint32_t>& order, Compare comp, unsigned threads, const std::atomic<bool>* cancel) {
+    const size_t count = order.size();
+    if (threads < 2 || count < ImageSorter::PARALLEL_SORT_MIN) {
+        std::sort(order.begin(), order.end(), comp);
+        return;
+    }
+    size_t chunks = 1;
+    while (chunks * 2 <= threads) chunks *= 2;
+    std::vector<size_t> bounds(chunks + 1);
+    for (size_t i = 0; i <= chunks; ++i) {
+        bounds[i] = count * i / chunks;
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < chunks; ++i) {
+        workers.emplace_back([&, i]() {
+            std::sort(order.begin() + bounds[i], order.begin() + bounds[i + 1], comp);
+        });
+    }
+    for (auto& worker : workers) worker.join();
+
+    std::vector<uint32_t> buffer(count);
+    for (size_t width = 1; width < chunks; width *= 2) {
+        if (cancel && cancel->load()) return;
+        workers.clear();
+        for (size_t i = 0; i < chunks; i += width * 2) {
+            workers.emplace_back([&, i]() {
+                const size_t begin = bounds[i];
+                const size_t middle = bounds[i + width];
+                const size_t end = bounds[std::min(i + width * 2, chunks)];
+                std::merge(order.begin() + begin, order.begin() + middle, order.begin() + middle,
+                           order.begin() + end, buffer.begin() + begin, comp);
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        order.swap(buffer);
+    }
+}
+
+} // namespace
+
+const char* sortModeName(SortMode mode) {
+    for (const auto& entry : SORT_MODES) {
+        if (entry.mode == mode) return entry.name;
+    }
+    return "path";
+}
+
+bool parseSortMode(const std::string& name, SortMode& mode) {
+    for (const auto& entry : SORT_MODES) {
+        if (name == entry.name) {
+            mode = entry.mode;
+            return true;
+        }
+    }
+    return false;
+}
+
+ImageSorter::~ImageSorter() {
+    cancel();
+    wait();
+}
+
+void ImageSorter::start(ImageCatalog images, SortMode mode, bool descending, int threads) {
+    cancel();
+    wait();
+    m_cancel = false;
+    m_running = true;
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        m_hasResult = false;
+    }
+    m_thread = std::thread([this, images = std::move(images), mode, descending, threads]() mutable {
+        SortStats stats = sort(images, mode, descending, threads, &m_cancel);
+        if (!stats.cancelled) {
+            std::cout << "[ImageSorter] sorted " << stats.images << " images by " << sortModeName(mode)
+                      << (descending ? " (descending)" : "") << ": fetched " << stats.fetched << " in "
+                      << stats.fetchMs << " ms, sorted in " << stats.sortMs << " ms" << std::endl;
+            std::lock_guard<std::mutex> lock(m_resultMutex);
+            m_result = std::move(images);
+            m_resultStats = stats;
+            m_hasResult = true;
+        }
+        m_running = false;
+    });
+}
+
+void ImageSorter::cancel() {
+    m_cancel = true;
+}
+
+void ImageSorter::wait() {
+    if (m_thread.joinable()) m_thread.join();
+}
+
+bool ImageSorter::takeResult(ImageCatalog& images, SortStats& stats) {
+    std::lock_guard<std::mutex> lock(m_resultMutex);
+    if (!m_hasResult) return false;
+    images = std::move(m_result);
+    m_result.clear();
+    stats = m_resultStats;
+    m_hasResult = false;
+    return true;
+}
+
+int ImageSorter::naturalCompare(std::string_view a, std::string_view b) {
+    size_t i = 0;
+    size_t j = 0;
+    int zeros = 0;      // 数值相同时，前导零少的排在前面
+    while (i < a.size() && j < b.size()) {
+        const unsigned char ca = static_cast<unsigned char>(a[i]);
+        const unsigned char cb = static_cast<unsigned char>(b[j]);
+        if (std::isdigit(ca) && std::isdigit(cb)) {
+            size_t za = i;
+            size_t zb = j;
+            while (za < a.size() && a[za] == '0') ++za;
+            while (zb < b.size() && b[zb] == '0') ++zb;
+            size_t ea = za;
+            size_t eb = zb;
+            while (ea < a.size() && std::isdigit(static_cast<unsigned char>(a[ea]))) ++ea;
+            while (eb < b.size() && std::isdigit(static_cast<unsigned char>(b[eb]))) ++eb;
+            // 有效位数多的数值大，位数相同时逐位比较
+            if (ea - za != eb - zb) return ea - za < eb - zb ? -1 : 1;
+            int digits = a.substr(za, ea - za).compare(b.substr(zb, eb - zb));
+            if (digits != 0) return digits < 0 ? -1 : 1;
+            if (zeros == 0 && za - i != zb - j) zeros = za - i < zb - j ? -1 : 1;
+            i = ea;
+            j = eb;
+            continue;
+        }
+        const int la = ca < 0x80 ? std::tolower(ca) : ca;
+        const int lb = cb < 0x80 ? std::tolower(cb) : cb;
+        if (la != lb) return la < lb ? -1 : 1;
+        ++i;
+        ++j;
+    }
+    if (i < a.size() || j < b.size()) return i < a.size() ? 1 : -1;
+    if (zeros != 0) return zeros;
+    // 只有大小写不同时按原字符串比较，保证顺序确定
+    int exact = a.compare(b);
+    return exact == 0 ? 0 : (exact < 0 ? -1 : 1);
+}
+
+SortStats ImageSorter::sort(ImageCatalog& images, SortMode mode, bool descending, int threads,
+                            const std::atomic<bool>* cancel) {
+    SortStats stats;
+    const size_t count = images.size();
+    stats.images = count;
+    const unsigned threadCount = threads > 0 ? static_cast<unsigned>(threads)
+                                             : std::max(2u, std::thread::hardware_concurrency());
+    auto cancelled = [cancel]() { return cancel && cancel->load(); };
+
+    // 按需读取排序键
+    std::vector<int64_t> keys;
+    const bool needsFiles = mode == SortMode::CaptureDate || mode == SortMode::ModifiedTime ||
+                            mode == SortMode::FileSize || mode == SortMode::PixelCount;
+    if (needsFiles) {
+        auto fetchStart = std::chrono::steady_clock::now();
+        keys.assign(count, 0);
+        std::vector<ImageIndexInfo> fetched(count);
+        std::vector<int64_t> captured(count, 0);
+        std::vector<uint8_t> updated(count, 0);
+        std::vector<uint8_t> needsDimensions(count, 0);
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> fetchedCount{0};
+
+        auto worker = [&]() {
+            for (;;) {
+                if (cancelled()) return;
+                const size_t begin = next.fetch_add(FETCH_BATCH);
+                if (begin >= count) return;
+                const size_t end = std::min(begin + FETCH_BATCH, count);
+                for (size_t i = begin; i < end; ++i) {
+                    // 单个文件出错只让这一项没有元数据，
+                    // 异常不能离开工作线程，否则整个程序会终止
+                    try {
+                        const fs::path path = images.path(i);
+                        std::error_code ec;
+                        auto time = fs::last_write_time(path, ec);
+                        if (ec) continue;
+                        ImageIndexInfo info;
+                        info.mtime = DirectoryIndex::toTicks(time);
+                        info.size = fs::file_size(path, ec);
+                        if (ec) continue;
+
+                        // 文件没有变化时沿用已有的尺寸、旋转和拍摄时间
+                        ImageIndexInfo known;
+                        const bool unchanged = images.getMetadata(i, known) &&
+                                               known.mtime == info.mtime && known.size == info.size;
+                        if (unchanged) {
+                            info.width = known.width;
+                            info.height = known.height;
+                            info.orientation = known.orientation;
+                        }
+
+                        int64_t capture = 0;
+                        switch (mode) {
+                        case SortMode::ModifiedTime:
+                            keys[i] = info.mtime;
+                            break;
+                        case SortMode::FileSize:
+                            keys[i] = static_cast<int64_t>(info.size);
+                            break;
+                        case SortMode::PixelCount:
+                            // 尺寸未知的稍后一起读取文件头
+                            needsDimensions[i] = info.width <= 0 || info.height <= 0;
+                            keys[i] = static_cast<int64_t>(info.width) * info.height;
+                            break;
+                        case SortMode::CaptureDate:
+                            if (!unchanged || !images.getCaptureTime(i, capture)) {
+                                capture = readCaptureTime(path);
+                                captured[i] = capture;
+                            }
+                            keys[i] = capture > 0 ? capture : localTimeKey(time);
+                            break;
+                        default:
+                            break;
+                        }
+                        if (!unchanged || captured[i] != 0 || known.width != info.width) {
+                            fetched[i] = info;
+                            updated[i] = 1;
+                        }
+                        fetchedCount++;
+                    } catch (const std::exception& e) {
+                        std::cerr << "[ImageSorter] failed to read metadata: " << e.what() << std::endl;
+                    }
+                }
+            }
+        };
+        std::vector<std::thread> workers;
+        for (unsigned t = 1; t < threadCount; ++t) {
+            workers.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : workers) thread.join();
+        if (cancelled()) {
+            stats.cancelled = true;
+            return stats;
+        }
+
+        // 批量读取文件头中的尺寸
+        std::vector<size_t> probeIndices;
+        std::vector<std::string> probePaths;
+        for (size_t i = 0; i < count; ++i) {
+            if (!needsDimensions[i]) continue;
+            try {
+                probePaths.push_back(images.path(i).generic_string());
+            } catch (const std::exception& e) {
+                std::cerr << "[ImageSorter] skipped dimensions: " << e.what() << std::endl;
+                continue;
+            }
+            probeIndices.push_back(i);
+        }
+        if (!probePaths.empty()) {
+            std::vector<ImageHeader> headers;
+            HeaderProbe::probeAll(probePaths, headers, static_cast<int>(threadCount));
+            for (size_t k = 0; k < probeIndices.size(); ++k) {
+                const size_t i = probeIndices[k];
+                if (!headers[k].valid) continue;
+                fetched[i].width = headers[k].width;
+                fetched[i].height = headers[k].height;
+                updated[i] = 1;
+                keys[i] = static_cast<int64_t>(headers[k].width) * headers[k].height;
+            }
+        }
+
+        // 读到的信息写回列表（列在这里才分配，工作线程只读列表）
+        for (size_t i = 0; i < count; ++i) {
+            if (!updated[i]) continue;
+            images.setMetadata(i, fetched[i]);
+            if (captured[i] != 0) images.setCaptureTime(i, captured[i]);
+        }
+        stats.fetched = fetchedCount.load();
+        stats.fetchMs = elapsedMs(fetchStart);
+    }
+
+    auto sortStart = std::chrono::steady_clock::now();
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0u);
+
+    // 键相同时按文件名自然顺序，再按原位置，结果与线程数无关
+    auto byName = [&images](uint32_t a, uint32_t b) {
+        int result = naturalCompare(images.name(a), images.name(b));
+        if (result == 0) {
+            result = naturalCompare(images.directoryString(images.directoryId(a)),
+                                    images.directoryString(images.directoryId(b)));
+        }
+        return result != 0 ? result < 0 : a < b;
+    };
+    auto ascending = [&](uint32_t a, uint32_t b) {
+        switch (mode) {
+        case SortMode::Path:
+            return images.less(a, b);
+        case SortMode::Natural:
+            return byName(a, b);
+        default:
+            if (keys[a] != keys[b]) return keys[a] < keys[b];
+            return byName(a, b);
+        }
+    };
+    if (descending) {
+        parallelSort(order, [&](uint32_t a, uint32_t b) { return ascending(b, a); }, threadCount, cancel);
+    } else {
+        parallelSort(order, ascending, threadCount, cancel);
+    }
+    if (cancelled()) {
+        stats.cancelled = true;
+        return stats;
+    }
+    images.permute(order);
+    stats.sortMs = elapsedMs(sortStart);
+    return stats;
+}
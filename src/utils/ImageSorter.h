@@ -0,0 +1,85 @@
+#pragma once
+#include "ImageCatalog.h"
+#include <string>
+#include <string_view>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// 图片列表的排序方式
+enum class SortMode {
+    Path,           // 完整路径（默认，与扫描结果的顺序相同）
+    Natural,        // 文件名自然顺序（img2 在 img10 之前），同名时比较目录
+    CaptureDate,    // EXIF 拍摄时间，没有时用修改时间
+    ModifiedTime,   // 文件修改时间
+    FileSize,       // 文件大小
+    PixelCount,     // 宽 × 高
+    Count
+};
+
+// 设置文件中使用的名字
+const char* sortModeName(SortMode mode);
+// 名字无法识别时返回 false
+bool parseSortMode(const std::string& name, SortMode& mode);
+
+// 排序统计
+struct SortStats {
+    size_t images = 0;
+    size_t fetched = 0;         // 读取了文件信息（状态、文件头或 EXIF）的图片数
+    double fetchMs = 0.0;
+    double sortMs = 0.0;
+    bool cancelled = false;
+};
+
+/**
+ * @class ImageSorter
+ * @brief 在后台线程中对图片列表排序
+ * @description 排序在列表的副本上进行，不阻塞主线程；完成后由主线程每帧调用 takeResult 取回。
+ *              排序需要的文件信息只在用到时读取：按名字排序不访问文件，
+ *              按时间、大小只查询文件状态，按像素数读取文件头，按拍摄时间读取 EXIF。
+ *              列表中已有且修改时间、大小未变的元数据直接沿用；读取按批次分给多个线程，
+ *              读到的信息写回结果列表，下次排序不必再读。比较本身用多线程分段排序后归并。
+ */
+class ImageSorter {
+public:
+    // 少于这么多项时单线程排序
+    static constexpr size_t PARALLEL_SORT_MIN = 16384;
+    // 读取文件信息时每个线程一次领取的图片数
+    static constexpr size_t FETCH_BATCH = 64;
+
+    ImageSorter() = default;
+    ~ImageSorter();
+
+    ImageSorter(const ImageSorter&) = delete;
+    ImageSorter& operator=(const ImageSorter&) = delete;
+
+    /**
+     * @brief 开始后台排序；已有排序在进行时先取消
+     * @param images 要排序的列表（副本）
+     * @param threads 线程数，0 表示按 CPU 核数
+     */
+    void start(ImageCatalog images, SortMode mode, bool descending, int threads = 0);
+    void cancel();
+    void wait();
+    bool isRunning() const { return m_running.load(); }
+
+    // 取出已完成的结果（按新顺序排列并带有读取到的元数据），没有时返回 false
+    bool takeResult(ImageCatalog& images, SortStats& stats);
+
+    // 同步排序；cancel 置位时尽快返回，列表保持原样
+    static SortStats sort(ImageCatalog& images, SortMode mode, bool descending, int threads = 0,
+                          const std::atomic<bool>* cancel = nullptr);
+
+    // 自然顺序比较：连续数字按数值比较，字母不区分大小写
+    static int naturalCompare(std::string_view a, std::string_view b);
+
+private:
+    std::thread m_thread;
+    std::atomic<bool> m_cancel{false};
+    std::atomic<bool> m_running{false};
+
+    std::mutex m_resultMutex;
+    bool m_hasResult = false;
+    ImageCatalog m_result;
+    SortStats m_resultStats;
+};
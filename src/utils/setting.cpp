@@ -91,6 +91,23 @@ void SettingManager::initDefaultSettings() {
     setBool("Display", "image_EXIF", true);
     setBool("Display", "image_index", true);
     setBool("Display", "Enable_Exif_orientation", true);
+    setString("Display", "sort_mode", "path");      // path/natural/capture_date/modified_time/file_size/pixel_count
+    setBool("Display", "sort_descending", false);
+
+    // Cache节默认配置（单位 MB）
+    setInt("Cache", "gpu_budget_mb", 512);
+    setInt("Cache", "cpu_budget_mb", 256);
+    setBool("Cache", "decode_to_display", true);
+    setInt("Cache", "decode_display_multiple", 1);
+    setInt("Cache", "upload_budget_mb", 32);
+    setInt("Cache", "upload_budget_ms", 4);
+    setBool("Cache", "pixel_buffer_upload", true);
+    setInt("Cache", "texture_pool_size", 8);
+    setInt("Cache", "texture_pool_mb", 128);
+    setBool("Cache", "mipmaps", true);
+    setInt("Cache", "decode_pool_mb", 256);
+    setBool("Cache", "directory_index", true);
+    setBool("Cache", "directory_watch", true);
     
     saveSettings();
 }
@@ -429,6 +429,17 @@ STBIDEF stbi_uc *stbi_load_from_file  (FILE *f, int *x, int *y, int *channels_in
 // for stbi_load_from_file, file pointer is left pointing immediately after image
 #endif
 
+#ifndef STBI_NO_JPEG
+// [Vimag] JPEG decode at 1/2, 1/4 or 1/8 scale (scale_shift 1..3) using reduced IDCTs;
+// *x, *y receive the scaled size. scale_shift 0 is a normal full-size decode.
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *channels_in_file, int desired_channels, int scale_shift);
+#endif
+
+// [Vimag] cooperative cancellation: the check is polled once per MCU row (JPEG) or
+// scanline (PNG); a non-zero return aborts the decode with failure reason "cancelled".
+typedef int (*stbi_cancel_check)(void);
+STBIDEF void stbi_set_cancel_check(stbi_cancel_check check);
+
 #ifndef STBI_NO_GIF
 STBIDEF stbi_uc *stbi_load_gif_from_memory(stbi_uc const *buffer, int len, int **delays, int *x, int *y, int *z, int *comp, int req_comp);
 #endif
@@ -974,6 +985,19 @@ STBIDEF const char *stbi_failure_reason(void)
    return stbi__g_failure_reason;
 }
 
+// [Vimag] cooperative cancellation hook
+static stbi_cancel_check stbi__cancel_check_fn = NULL;
+
+STBIDEF void stbi_set_cancel_check(stbi_cancel_check check)
+{
+   stbi__cancel_check_fn = check;
+}
+
+static int stbi__cancelled(void)
+{
+   return stbi__cancel_check_fn != NULL && stbi__cancel_check_fn() != 0;
+}
+
 #ifndef STBI_NO_FAILURE_STRINGS
 static int stbi__err(const char *str)
 {
@@ -1994,6 +2018,8 @@ typedef struct
    int scan_n, order[4];
    int restart_interval, todo;
 
+   int scale_shift; // [Vimag] 0 = full size, 1..3 = 1/2, 1/4, 1/8 via reduced IDCT
+
 // kernels
    void (*idct_block_kernel)(stbi_uc *out, int out_stride, short data[64]);
    void (*YCbCr_to_RGB_kernel)(stbi_uc *out, const stbi_uc *y, const stbi_uc *pcb, const stbi_uc *pcr, int count, int step);
@@ -2961,10 +2987,11 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          int w = (z->img_comp[n].x+7) >> 3;
          int h = (z->img_comp[n].y+7) >> 3;
          for (j=0; j < h; ++j) {
+            if (stbi__cancelled()) return stbi__err("cancelled", "Decode cancelled"); // [Vimag]
             for (i=0; i < w; ++i) {
                int ha = z->img_comp[n].ha;
                if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*((j*8)>>z->scale_shift)+((i*8)>>z->scale_shift), z->img_comp[n].w2, data);
                // every data block is an MCU, so countdown the restart interval
                if (--z->todo <= 0) {
                   if (z->code_bits < 24) stbi__grow_buffer_unsafe(z);
@@ -2980,6 +3007,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          int i,j,k,x,y;
          STBI_SIMD_ALIGN(short, data[64]);
          for (j=0; j < z->img_mcu_y; ++j) {
+            if (stbi__cancelled()) return stbi__err("cancelled", "Decode cancelled"); // [Vimag]
             for (i=0; i < z->img_mcu_x; ++i) {
                // scan an interleaved mcu... process scan_n components in order
                for (k=0; k < z->scan_n; ++k) {
@@ -2992,7 +3020,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
                         int y2 = (j*z->img_comp[n].v + y)*8;
                         int ha = z->img_comp[n].ha;
                         if (!stbi__jpeg_decode_block(z, data, z->huff_dc+z->img_comp[n].hd, z->huff_ac+ha, z->fast_ac[ha], n, z->dequant[z->img_comp[n].tq])) return 0;
-                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*y2+x2, z->img_comp[n].w2, data);
+                        z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*(y2>>z->scale_shift)+(x2>>z->scale_shift), z->img_comp[n].w2, data);
                      }
                   }
                }
@@ -3018,6 +3046,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
          int w = (z->img_comp[n].x+7) >> 3;
          int h = (z->img_comp[n].y+7) >> 3;
          for (j=0; j < h; ++j) {
+            if (stbi__cancelled()) return stbi__err("cancelled", "Decode cancelled"); // [Vimag]
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                if (z->spec_start == 0) {
@@ -3040,6 +3069,7 @@ static int stbi__parse_entropy_coded_data(stbi__jpeg *z)
       } else { // interleaved
          int i,j,k,x,y;
          for (j=0; j < z->img_mcu_y; ++j) {
+            if (stbi__cancelled()) return stbi__err("cancelled", "Decode cancelled"); // [Vimag]
             for (i=0; i < z->img_mcu_x; ++i) {
                // scan an interleaved mcu... process scan_n components in order
                for (k=0; k < z->scan_n; ++k) {
@@ -3089,7 +3119,7 @@ static void stbi__jpeg_finish(stbi__jpeg *z)
             for (i=0; i < w; ++i) {
                short *data = z->img_comp[n].coeff + 64 * (i + j * z->img_comp[n].coeff_w);
                stbi__jpeg_dequantize(data, z->dequant[z->img_comp[n].tq]);
-               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*j*8+i*8, z->img_comp[n].w2, data);
+               z->idct_block_kernel(z->img_comp[n].data+z->img_comp[n].w2*((j*8)>>z->scale_shift)+((i*8)>>z->scale_shift), z->img_comp[n].w2, data);
             }
          }
       }
@@ -3329,8 +3359,9 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       //
       // img_mcu_x, img_mcu_y: <=17 bits; comp[i].h and .v are <=4 (checked earlier)
       // so these muls can't overflow with 32-bit ints (which we require)
-      z->img_comp[i].w2 = z->img_mcu_x * z->img_comp[i].h * 8;
-      z->img_comp[i].h2 = z->img_mcu_y * z->img_comp[i].v * 8;
+      // [Vimag] scaled decode: each 8x8 block produces (8>>scale_shift)^2 pixels
+      z->img_comp[i].w2 = (z->img_mcu_x * z->img_comp[i].h * 8) >> z->scale_shift;
+      z->img_comp[i].h2 = (z->img_mcu_y * z->img_comp[i].v * 8) >> z->scale_shift;
       z->img_comp[i].coeff = 0;
       z->img_comp[i].raw_coeff = 0;
       z->img_comp[i].linebuf = NULL;
@@ -3340,10 +3371,10 @@ static int stbi__process_frame_header(stbi__jpeg *z, int scan)
       // align blocks for idct using mmx/sse
       z->img_comp[i].data = (stbi_uc*) (((size_t) z->img_comp[i].raw_data + 15) & ~15);
       if (z->progressive) {
-         // w2, h2 are multiples of 8 (see above)
-         z->img_comp[i].coeff_w = z->img_comp[i].w2 / 8;
-         z->img_comp[i].coeff_h = z->img_comp[i].h2 / 8;
-         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].w2, z->img_comp[i].h2, sizeof(short), 15);
+         // coefficients are kept at full block resolution regardless of scale_shift
+         z->img_comp[i].coeff_w = z->img_mcu_x * z->img_comp[i].h;
+         z->img_comp[i].coeff_h = z->img_mcu_y * z->img_comp[i].v;
+         z->img_comp[i].raw_coeff = stbi__malloc_mad3(z->img_comp[i].coeff_w * 8, z->img_comp[i].coeff_h * 8, sizeof(short), 15);
          if (z->img_comp[i].raw_coeff == NULL)
             return stbi__free_jpeg_components(z, i+1, stbi__err("outofmem", "Out of memory"));
          z->img_comp[i].coeff = (short*) (((size_t) z->img_comp[i].raw_coeff + 15) & ~15);
@@ -3817,6 +3848,61 @@ static void stbi__YCbCr_to_RGB_simd(stbi_uc *out, stbi_uc const *y, stbi_uc cons
 }
 #endif
 
+// [Vimag] reduced IDCTs: only the low NxN coefficients of each 8x8 block are
+// transformed, giving a 1/2 (4x4), 1/4 (2x2) or 1/8 (1x1) scaled image
+// basis[x*N+u] = C(u) * cos((2x+1)u*pi/(2N)), C(0) = 1/sqrt(2)
+static const float stbi__idct_basis4[16] = {
+   0.70710678f,  0.92387953f,  0.70710678f,  0.38268343f,
+   0.70710678f,  0.38268343f, -0.70710678f, -0.92387953f,
+   0.70710678f, -0.38268343f, -0.70710678f,  0.92387953f,
+   0.70710678f, -0.92387953f,  0.70710678f, -0.38268343f
+};
+static const float stbi__idct_basis2[4] = {
+   0.70710678f,  0.70710678f,
+   0.70710678f, -0.70710678f
+};
+
+static void stbi__idct_reduced(stbi_uc *out, int out_stride, const short data[64], int n, const float *basis)
+{
+   float tmp[16];
+   int x,y,u,v;
+   // vertical pass: tmp[y][u] = sum_v basis(y,v) * F(v,u)
+   for (y=0; y < n; ++y) {
+      for (u=0; u < n; ++u) {
+         float sum = 0;
+         for (v=0; v < n; ++v)
+            sum += basis[y*n+v] * data[v*8+u];
+         tmp[y*n+u] = sum;
+      }
+   }
+   // horizontal pass, scale by 1/4 so the DC maps to its block mean, then level shift
+   for (y=0; y < n; ++y, out += out_stride) {
+      for (x=0; x < n; ++x) {
+         float sum = 0;
+         for (u=0; u < n; ++u)
+            sum += basis[x*n+u] * tmp[y*n+u];
+         out[x] = stbi__clamp((int) floorf(sum * 0.25f + 128.5f));
+      }
+   }
+}
+
+static void stbi__idct_block_4x4(stbi_uc *out, int out_stride, short data[64])
+{
+   stbi__idct_reduced(out, out_stride, data, 4, stbi__idct_basis4);
+}
+
+static void stbi__idct_block_2x2(stbi_uc *out, int out_stride, short data[64])
+{
+   stbi__idct_reduced(out, out_stride, data, 2, stbi__idct_basis2);
+}
+
+static void stbi__idct_block_1x1(stbi_uc *out, int out_stride, short data[64])
+{
+   STBI_NOTUSED(out_stride);
+   // DC only: the block mean is F(0,0)/8
+   out[0] = stbi__clamp(((data[0] + 4) >> 3) + 128);
+}
+
 // set up the kernels
 static void stbi__setup_jpeg(stbi__jpeg *j)
 {
@@ -3873,6 +3959,17 @@ static stbi_uc *load_jpeg_image(stbi__jpeg *z, int *out_x, int *out_y, int *comp
    // load a jpeg image from whichever source, but leave in YCbCr format
    if (!stbi__decode_jpeg_image(z)) { stbi__cleanup_jpeg(z); return NULL; }
 
+   // [Vimag] from here on everything works on the scaled planes
+   if (z->scale_shift) {
+      int k, round = (1 << z->scale_shift) - 1;
+      z->s->img_x = (z->s->img_x + round) >> z->scale_shift;
+      z->s->img_y = (z->s->img_y + round) >> z->scale_shift;
+      for (k=0; k < z->s->img_n; ++k) {
+         z->img_comp[k].x = (z->img_comp[k].x + round) >> z->scale_shift;
+         z->img_comp[k].y = (z->img_comp[k].y + round) >> z->scale_shift;
+      }
+   }
+
    // determine actual number of components to generate
    n = req_comp ? req_comp : z->s->img_n >= 3 ? 3 : 1;
 
@@ -4039,6 +4136,32 @@ static void *stbi__jpeg_load(stbi__context *s, int *x, int *y, int *comp, int re
    return result;
 }
 
+static stbi_uc *stbi__jpeg_load_scaled(stbi__context *s, int *x, int *y, int *comp, int req_comp, int scale_shift)
+{
+   unsigned char* result;
+   stbi__jpeg* j = (stbi__jpeg*) stbi__malloc(sizeof(stbi__jpeg));
+   if (!j) return stbi__errpuc("outofmem", "Out of memory");
+   memset(j, 0, sizeof(stbi__jpeg));
+   j->s = s;
+   stbi__setup_jpeg(j);
+   j->scale_shift = scale_shift;
+   if (scale_shift == 1) j->idct_block_kernel = stbi__idct_block_4x4;
+   else if (scale_shift == 2) j->idct_block_kernel = stbi__idct_block_2x2;
+   else if (scale_shift == 3) j->idct_block_kernel = stbi__idct_block_1x1;
+   result = load_jpeg_image(j, x,y,comp,req_comp);
+   STBI_FREE(j);
+   return result;
+}
+
+STBIDEF stbi_uc *stbi_load_jpeg_scaled_from_memory(stbi_uc const *buffer, int len, int *x, int *y, int *comp, int req_comp, int scale_shift)
+{
+   stbi__context s;
+   if (scale_shift < 0 || scale_shift > 3) return stbi__errpuc("bad scale", "JPEG scale must be 0..3");
+   stbi__start_mem(&s,buffer,len);
+   if (!stbi__jpeg_test(&s)) return stbi__errpuc("not JPEG", "Image is not a JPEG");
+   return stbi__jpeg_load_scaled(&s, x, y, comp, req_comp, scale_shift);
+}
+
 static int stbi__jpeg_test(stbi__context *s)
 {
    int r;
@@ -4735,6 +4858,7 @@ static int stbi__create_png_image_raw(stbi__png *a, stbi_uc *raw, stbi__uint32 r
    }
 
    for (j=0; j < y; ++j) {
+      if (stbi__cancelled()) { STBI_FREE(filter_buf); return stbi__err("cancelled", "Decode cancelled"); } // [Vimag]
       // cur/prior filter buffers alternate
       stbi_uc *cur = filter_buf + (j & 1)*img_width_bytes;
       stbi_uc *prior = filter_buf + (~j & 1)*img_width_bytes;
@@ -1,10 +1,23 @@
 #include "utils.h"
 
 #define STBI_MAX_DIMENSIONS 32768  // 扩展到 32768x32768 ,默认最大支持尺寸为 ​16,777,216 像素
+// 解码缓冲区走分级缓存池，切换图片时复用已映射的内存；stb 分配的内存必须用 stbi_image_free 释放
+#include "DecodeBufferPool.h"
+#define STBI_MALLOC(sz)           decodeBufferMalloc(sz)
+#define STBI_REALLOC(p,newsz)     decodeBufferRealloc(p,newsz)
+#define STBI_FREE(p)              decodeBufferFree(p)
 // 需要包含 stb_image
 #define STB_IMAGE_IMPLEMENTATION
 // #include "stb_image.h"
 #include "stb_image.h" // 需先下载stb_image.h
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include "stb_image_resize2.h"
+#include "FileBuffer.h"
+#include "HeaderProbe.h"
+#include "DirectoryScanner.h"
+#include "ExifCache.h"
+#include <climits>
+#include <new>
 
 
 
@@ -13,47 +26,14 @@
 
 
 bool getImageInfo(const std::string& filePath, int& w, int& h) {
-    int channels;
-    // 检查文件是否存在
-    if (!fs::exists(filePath)) {
-        std::cerr << "文件不存在: " << filePath << std::endl;
-        return false;
-    }
-
-    // 打开文件并定位到末尾
-    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        std::cerr << "无法打开文件: " << filePath << std::endl;
-        return false;
-    }
-
-    // 检查文件大小是否有效
-    const long fileSize = file.tellg();
-    if (fileSize <= 0) {
-        std::cerr << "无效的文件大小: " << fileSize << std::endl;
-        file.close();
-        return false;
-    }
-
-    // 动态计算头部大小（上限2KB）
-    // 修改headerSize的计算逻辑
-    const size_t headerSize = (fileSize > 51768) ? 51768 : static_cast<size_t>(fileSize); // 32KB覆盖99%的EXIF偏移
-    file.seekg(0, std::ios::beg);
-
-    // 读取头部数据到vector（自动内存管理）
-    std::vector<unsigned char> header(headerSize);
-    if (!file.read(reinterpret_cast<char*>(header.data()), headerSize)) {
-        std::cerr << "读取文件头失败: " << filePath << std::endl;
-        file.close();
-        return false;
-    }
-    file.close();
-
-    // 解析图像元数据
-    if (stbi_info_from_memory(header.data(), headerSize, &w, &h, &channels) == 0) {
+    // 只读取各格式文件头中需要的几十个字节
+    ImageHeader header;
+    if (!HeaderProbe::probe(filePath, header)) {
         std::cerr << "不支持的图像格式或损坏的文件: " << filePath << std::endl;
         return false;
     }
+    w = header.width;
+    h = header.height;
     return true;
 }
 
@@ -79,54 +59,14 @@ void find_image_files(
     }
 
     try {
-        // 创建递归迭代器
-        auto options = fs::directory_options::skip_permission_denied;
-        fs::recursive_directory_iterator dir_iter(directory, options);
-        fs::recursive_directory_iterator end_iter;
-
-        while (dir_iter != end_iter) {
-            try {
-                const auto& entry = *dir_iter;
-                
-                // 跳过非常规文件（目录/符号链接等）
-                if (entry.is_regular_file()) {
-                    // 获取小写扩展名以统一比较
-                    std::string ext = entry.path().extension().string();
-                    std::transform(ext.begin(), ext.end(), ext.begin(), 
-                                  [](unsigned char c) { return std::tolower(c); });
-                    
-                    // 检查是否为图片格式 
-                    if (imageExtensions.find(ext) != imageExtensions.end() && std::filesystem::exists(entry.path())) {
-                       
-                       
-                        try{
-                            std::string filePath = entry.path().generic_string();
-                            image_paths.push_back(entry.path());
-                            image_names.push_back(entry.path().filename().u8string());
-
-                        }
-                        catch (const std::exception& e) {
-                            std::cerr << entry.path() <<"  -------: " << std::endl;
-                     
-                        }
-                        
-
-                    }
-                }
-                ++dir_iter;
-            } 
-            // 捕获单个文件处理中的异常（不影响整体遍历）
-            catch (const fs::filesystem_error& e) {
-                std::cerr << "跳过无法访问的文件: " << e.what() << std::endl;
-                dir_iter.disable_recursion_pending();  // 继续遍历其他文件 [7](@ref)
-                ++dir_iter;
-            }
+        // 多线程并行遍历子目录；结果按路径排序，顺序与文件系统返回的顺序无关
+        std::vector<fs::path> found = DirectoryScanner::scan(directory);
+        image_paths.reserve(image_paths.size() + found.size());
+        image_names.reserve(image_names.size() + found.size());
+        for (auto& path : found) {
+            image_names.push_back(path.filename().u8string());
+            image_paths.push_back(std::move(path));
         }
-    } 
-    // 捕获全局性异常（如目录打开失败）
-    catch (const fs::filesystem_error& e) {
-        std::cerr << "文件系统错误: " << e.what() << std::endl;
-
     }
     catch (const std::exception& e) {
         std::cerr << "未知错误: " << e.what() << std::endl;
@@ -190,10 +130,6 @@ bool isFile(const std::string& path) {
     }
 }
 
-bool isGifPath(const std::string& path) {
-    return fs::path(path).extension() == ".gif";
-}
-
 bool isDirectory(const std::string& path) {
     try {
         return fs::is_directory(path);
@@ -235,119 +171,315 @@ void getImages( const std::string& filePath,fs::path& directory,std::vector<fs::
     } 
 }
 //////////////////////////////  gif   //////////////////////////////////////////
-unsigned char* loadGifImage(const std::string& path, int& outWidth, int& outHeight, int& channels, int& frames,std::vector<int>& outDelays) { 
-    // 1. 读取文件到内存 
-    std::ifstream file(path, std::ios::binary | std::ios::ate); 
-    if (!file.is_open()) { 
-        std::cerr << "Failed to open GIF: " << path << std::endl; 
-        return nullptr;  // 修正：返回nullptr而不是false
-    } 
-    
-    size_t size = file.tellg(); 
-    file.seekg(0); 
-    std::vector<char> buffer(size); 
-    file.read(buffer.data(), size); 
-    
-    int* delays = nullptr;
-    unsigned char* data = nullptr;  // 初始化为nullptr
-    
-    try { 
-        // 2. 使用stb_image加载GIF 
-        data = stbi_load_gif_from_memory( 
-            reinterpret_cast<unsigned char*>(buffer.data()), 
-            static_cast<int>(size), 
-            &delays, &outWidth, &outHeight, &frames, &channels, 0); 
-
-        // 直接使用参数引用，不需要局部变量
-        std::cout << "GIF width: " << outWidth << ", height: " << outHeight 
-                  << ", frames: " << frames << ", channels: " << channels << std::endl; 
-        
-        if (!data) { 
-            std::cerr << "Failed to load GIF: " << stbi_failure_reason() << std::endl; 
-            if (delays) free(delays);  // 清理delays
-            return nullptr; 
-        } 
-        
-        // 将C数组复制到vector中
-        if (delays && frames > 0) {
-            outDelays.assign(delays, delays + frames);
-            free(delays); // 释放stbi分配的内存
+// 流式解码直接使用 stb 的 GIF 内部状态，每次只合成一帧
+struct GifDecoder::State {
+    FileBuffer file;
+    stbi__context context;
+    stbi__gif gif;
+    // 处置方式 3（恢复到前一帧）需要两帧之前的画面
+    std::vector<unsigned char> previous;
+    std::vector<unsigned char> twoBack;
+    bool hasTwoBack = false;
+
+    // 当前帧在画布中的矩形（stb 以字节偏移记录）
+    void frameRect(int& x0, int& y0, int& x1, int& y1) const {
+        const int lineSize = gif.w * 4;
+        x0 = gif.start_x / 4;
+        x1 = gif.max_x / 4;
+        y0 = lineSize > 0 ? gif.start_y / lineSize : 0;
+        y1 = lineSize > 0 ? gif.max_y / lineSize : 0;
+    }
+
+    void resetGif() {
+        STBI_FREE(gif.out);
+        STBI_FREE(gif.history);
+        STBI_FREE(gif.background);
+        memset(&gif, 0, sizeof(gif));
+        previous.clear();
+        hasTwoBack = false;
+    }
+};
+
+GifDecoder::GifDecoder() {
+}
+
+GifDecoder::~GifDecoder() {
+    close();
+}
+
+bool GifDecoder::open(const std::string& path) {
+    close();
+    m_state = new State();
+    memset(&m_state->gif, 0, sizeof(m_state->gif));
+    m_path = path;
+    if (!m_state->file.open(path) || m_state->file.size() > static_cast<size_t>(INT_MAX)) {
+        std::cerr << "Failed to open GIF: " << path << std::endl;
+        close();
+        return false;
+    }
+
+    int channels = 0;
+    if (!stbi_info_from_memory(m_state->file.data(), static_cast<int>(m_state->file.size()), &m_width, &m_height, &channels)) {
+        std::cerr << "Failed to read GIF header: " << path << " " << stbi_failure_reason() << std::endl;
+        close();
+        return false;
+    }
+    if (!rewind()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void GifDecoder::close() {
+    if (m_state) {
+        m_state->resetGif();
+        delete m_state;
+        m_state = nullptr;
+    }
+    m_frameIndex = 0;
+    m_end = false;
+}
+
+bool GifDecoder::rewind() {
+    if (!m_state) return false;
+    m_state->resetGif();
+    stbi__start_mem(&m_state->context, m_state->file.data(), static_cast<int>(m_state->file.size()));
+    if (!stbi__gif_test(&m_state->context)) {
+        std::cerr << "Not a GIF: " << m_path << std::endl;
+        return false;
+    }
+    m_frameIndex = 0;
+    m_end = false;
+    return true;
+}
+
+bool GifDecoder::nextFrame(unsigned char* outRGBA, int& delayMs) {
+    if (!m_state || m_end) return false;
+
+    State& state = *m_state;
+    // 处置方式在解码下一帧时才生效，先记下前一帧的矩形和处置方式
+    const bool firstFrame = m_frameIndex == 0;
+    const int previousDispose = (state.gif.eflags & 0x1C) >> 2;
+    int prevX0 = 0, prevY0 = 0, prevX1 = 0, prevY1 = 0;
+    if (!firstFrame) state.frameRect(prevX0, prevY0, prevX1, prevY1);
+
+    int comp = 0;
+    stbi_uc* twoBack = state.hasTwoBack ? state.twoBack.data() : nullptr;
+    stbi_uc* frame = stbi__gif_load_next(&state.context, &state.gif, &comp, 4, twoBack);
+    if (frame == reinterpret_cast<stbi_uc*>(&state.context) || !frame) {
+        // 结束码或数据损坏：都当作结尾，已解码的帧仍可循环播放
+        if (!frame) {
+            std::cerr << "GIF decode stopped at frame " << m_frameIndex << ": " << stbi_failure_reason() << std::endl;
         }
+        m_end = true;
+        return false;
+    }
 
-        return data; 
-    } catch (const std::bad_alloc& e) { 
-        std::cerr << "Memory allocation failed: " << e.what() << std::endl; 
-        if (delays) free(delays);  // 安全清理
-        if (data) stbi_image_free(data);  // 安全清理
-        return nullptr; 
-    } 
+    m_width = state.gif.w;
+    m_height = state.gif.h;
+    const size_t frameBytes = static_cast<size_t>(m_width) * m_height * 4;
+    memcpy(outRGBA, frame, frameBytes);
+
+    int x0 = 0, y0 = 0, x1 = m_width, y1 = m_height;
+    if (!firstFrame) {
+        state.frameRect(x0, y0, x1, y1);
+        // 处置方式 2、3 会把前一帧的区域恢复成背景或更早的画面
+        if ((previousDispose == 2 || previousDispose == 3) && prevX1 > prevX0 && prevY1 > prevY0) {
+            if (x1 <= x0 || y1 <= y0) {
+                x0 = prevX0; y0 = prevY0; x1 = prevX1; y1 = prevY1;
+            } else {
+                x0 = std::min(x0, prevX0);
+                y0 = std::min(y0, prevY0);
+                x1 = std::max(x1, prevX1);
+                y1 = std::max(y1, prevY1);
+            }
+        }
+    }
+    m_dirtyX = std::clamp(x0, 0, m_width);
+    m_dirtyY = std::clamp(y0, 0, m_height);
+    m_dirtyWidth = std::max(0, std::min(x1, m_width) - m_dirtyX);
+    m_dirtyHeight = std::max(0, std::min(y1, m_height) - m_dirtyY);
+
+    // 滚动保存前两帧，供后续帧的处置方式 3 使用
+    if (!state.previous.empty()) {
+        state.twoBack.swap(state.previous);
+        state.hasTwoBack = true;
+    }
+    state.previous.assign(frame, frame + frameBytes);
+
+    delayMs = state.gif.delay;
+    m_frameIndex++;
+    return true;
 }
 
 
 ////////////////////////////////   image   ///////////////////////////////
-unsigned char* LoadImage(const std::string& path, int& outWidth, int& outHeight, int& channels, int desiredChannels) {
-    // 检查文件是否存在
-    if (!std::filesystem::exists(path)) {
+/**
+ * @brief 从读入内存的文件解码图像
+ * @param maxSide 长边上限，>0 且解码器支持时在解码阶段缩小，输出仍可能大于 maxSide（由调用方再精确缩放）
+ * @param outWidth/outHeight 解码结果的尺寸
+ * @param sourceWidth/sourceHeight 原图尺寸
+ * @param type 按文件头识别出的格式，可为空
+ */
+static unsigned char* loadMappedImage(const std::string& path, int maxSide, int& outWidth, int& outHeight,
+                                      int& sourceWidth, int& sourceHeight, int& channels, int desiredChannels,
+                                      ImageType* type = nullptr) {
+    // 只打开一次文件，识别格式、探测和解码共用同一块缓冲区
+    FileBuffer file;
+    if (!file.open(path)) {
         std::cerr << "Error: Image file not found: " << path << std::endl;
         return nullptr;
     }
-    
-    // 先尝试获取图像信息
-    if (!stbi_info(path.c_str(), &outWidth, &outHeight, &channels)) {
+    if (file.size() > static_cast<size_t>(INT_MAX)) {
+        std::cerr << "Error: Image file too large: " << path << std::endl;
+        return nullptr;
+    }
+
+    // 按魔数选择解码器，扩展名错误的文件也能走正确的路径
+    ImageDecoderRegistry& registry = ImageDecoderRegistry::getInstance();
+    const ImageDecoder* decoder = registry.find(file.data(), file.size());
+    if (!decoder) {
+        std::cerr << "Unsupported image format: " << path << std::endl;
+        return nullptr;
+    }
+    if (type) *type = decoder->type;
+
+    // 先尝试获取图像信息，无法识别或尺寸超限时不再解码
+    if (!decoder->info(file.data(), file.size(), sourceWidth, sourceHeight, channels)) {
         std::cerr << "Failed to get image info: " << path << std::endl;
         std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
         return nullptr;
     }
-    
-    std::cout << "Loading image: " << path << std::endl;
+    if (sourceWidth > STBI_MAX_DIMENSIONS || sourceHeight > STBI_MAX_DIMENSIONS) {
+        std::cerr << "Image too large: " << path << " (" << sourceWidth << "x" << sourceHeight << ")" << std::endl;
+        return nullptr;
+    }
+    outWidth = sourceWidth;
+    outHeight = sourceHeight;
+    if (DecodeCancelScope::isCancelled()) return nullptr;
+
+    std::cout << "Loading image: " << path << " [" << decoder->name << "]" << std::endl;
     unsigned char* outData = nullptr;
 
-    if (!isGifPath(path)) {
-        try {
-            outData = stbi_load(path.c_str(), &outWidth, &outHeight, &channels, desiredChannels);
-            if (!outData) {
-                std::cerr << "Failed to load image: " << path << std::endl;
-                std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
+    try {
+        outData = registry.decode(*decoder, file.data(), file.size(), maxSide,
+                                  outWidth, outHeight, channels, desiredChannels);
+        if (!outData) {
+            if (DecodeCancelScope::isCancelled()) {
+                std::cout << "Decode cancelled: " << path << std::endl;
                 return nullptr;
             }
-        } catch (const std::exception& e) {
-            std::cerr << "Error: Failed to load image: " << e.what() << std::endl;
+            std::cerr << "Failed to load image: " << path << std::endl;
+            std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
             return nullptr;
         }
-    } else {
-        // try {
-        //     int frame_count;
-        //     GifImage gif = loadGif(path, outWidth, outHeight, frame_count);
-        //     if (gif.frame_count > 0 && gif.frames) {
-        //         size_t frameSize = gif.width * gif.height * 4;
-        //         outData = new unsigned char[frameSize];
-        //         memcpy(outData, gif.frames.get()+ 60 * frameSize, frameSize);
-        //     } else {
-        //         std::cerr << "Failed to load GIF: " << path << std::endl;
-        //         return nullptr;
-        //     }
-        // } catch (const std::exception& e) {
-        //     std::cerr << "Error: Failed to load GIF: " << e.what() << std::endl;
-        //     return nullptr;
-        // }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: Failed to load image: " << e.what() << std::endl;
+        return nullptr;
     }
 
     return outData;
 }
 
-// 修改函数定义
-void FreeImage(unsigned char*& data, const std::string& path) {
-    if (!data) return;
-    
-    if (isGifPath(path)) {
-        stbi_image_free(data);
-        // GIF内存由unique_ptr自动管理，只需重置指针
-        data = nullptr;
-    } else {
-        // 普通图像使用STB释放
+unsigned char* LoadImage(const std::string& path, int& outWidth, int& outHeight, int& channels, int desiredChannels) {
+    int sourceWidth = 0, sourceHeight = 0;
+    return loadMappedImage(path, 0, outWidth, outHeight, sourceWidth, sourceHeight, channels, desiredChannels);
+}
+
+unsigned char* LoadImageScaled(const std::string& path, int maxSide, int& outWidth, int& outHeight,
+                               int& sourceWidth, int& sourceHeight, int& channels, ImageType* type) {
+    // 支持缩小解码的格式（如 JPEG）先在解码时按 2 的幂缩小，剩余的比例再由 stb_image_resize2 完成
+    int decodedWidth = 0, decodedHeight = 0;
+    unsigned char* data = loadMappedImage(path, maxSide, decodedWidth, decodedHeight,
+                                          sourceWidth, sourceHeight, channels, 4, type);
+    outWidth = decodedWidth;
+    outHeight = decodedHeight;
+    if (!data || maxSide <= 0) return data;
+
+    int longSide = std::max(sourceWidth, sourceHeight);
+    if (std::max(decodedWidth, decodedHeight) <= maxSide) return data;
+    if (DecodeCancelScope::isCancelled()) {
+        // 已被取代，不再缩放
         stbi_image_free(data);
-        data = nullptr;
+        return nullptr;
+    }
+
+    double scale = static_cast<double>(maxSide) / longSide;
+    int scaledWidth = std::max(1, static_cast<int>(std::lround(sourceWidth * scale)));
+    int scaledHeight = std::max(1, static_cast<int>(std::lround(sourceHeight * scale)));
+
+    // 输出缓冲区同样来自解码缓冲池，调用方仍用 FreeImage 释放
+    unsigned char* scaled = static_cast<unsigned char*>(decodeBufferMalloc(static_cast<size_t>(scaledWidth) * scaledHeight * 4));
+    if (!scaled) return data;
+    if (!stbir_resize_uint8_srgb(data, decodedWidth, decodedHeight, 0,
+                                 scaled, scaledWidth, scaledHeight, 0, STBIR_RGBA)) {
+        // 缩放失败时退回解码结果
+        decodeBufferFree(scaled);
+        return data;
     }
+    stbi_image_free(data);
+
+    outWidth = scaledWidth;
+    outHeight = scaledHeight;
+    std::cout << "Scaled image: " << path << " " << sourceWidth << "x" << sourceHeight
+              << " -> " << scaledWidth << "x" << scaledHeight << std::endl;
+    return scaled;
+}
+
+bool BuildMipChain(const unsigned char* rgba, int width, int height, MipChain& chain) {
+    chain.levels.clear();
+    chain.pixels.clear();
+    if (!rgba || width <= 0 || height <= 0 || (width == 1 && height == 1)) return false;
+
+    size_t total = 0;
+    int levelWidth = width, levelHeight = height;
+    while (levelWidth > 1 || levelHeight > 1) {
+        levelWidth = std::max(1, levelWidth / 2);
+        levelHeight = std::max(1, levelHeight / 2);
+        MipChain::Level level;
+        level.width = levelWidth;
+        level.height = levelHeight;
+        level.offset = total;
+        chain.levels.push_back(level);
+        total += static_cast<size_t>(levelWidth) * levelHeight * 4;
+    }
+
+    try {
+        chain.pixels.resize(total);
+    } catch (const std::bad_alloc&) {
+        chain.levels.clear();
+        return false;
+    }
+
+    const unsigned char* source = rgba;
+    int sourceWidth = width, sourceHeight = height;
+    for (const auto& level : chain.levels) {
+        if (DecodeCancelScope::isCancelled()) break;
+        unsigned char* target = chain.pixels.data() + level.offset;
+        if (!stbir_resize(source, sourceWidth, sourceHeight, 0, target, level.width, level.height, 0,
+                          STBIR_RGBA, STBIR_TYPE_UINT8_SRGB, STBIR_EDGE_CLAMP, STBIR_FILTER_BOX)) {
+            break;
+        }
+        source = target;
+        sourceWidth = level.width;
+        sourceHeight = level.height;
+        if (&level == &chain.levels.back()) return true;
+    }
+
+    chain.levels.clear();
+    chain.pixels.clear();
+    chain.pixels.shrink_to_fit();
+    return false;
+}
+
+// 修改函数定义
+void FreeImage(unsigned char*& data) {
+    if (!data) return;
+
+    // 所有格式都由 stb 或解码缓冲池分配，统一释放
+    stbi_image_free(data);
+    data = nullptr;
 }
 
 
@@ -386,20 +518,19 @@ int get_Orientation(int orientation){
 bool getExifInfo(const std::string& imagPath,std::string& image_exif,int& orientation){
 
 
-    EXIF exif(imagPath);
-    if (!exif.isValid()) {
+    ExifSummary info;
+    if (!ExifCache::getInstance().get(imagPath, info)) {
         // std::cerr << "EXIF信息无效: " << imagPath << std::endl;
         image_exif = "EXIF info is invalid";
         orientation = 0;
         return false ;
     }
-    TinyEXIF::EXIFInfo info = exif.getInfo();
-    std::string Fnumber = std::to_string(info.FNumber);
+    std::string Fnumber = std::to_string(info.fNumber);
     // std::cout<< "Fnumber =" << Fnumber <<std::endl;
     removeZero(Fnumber);
     // std::cout<< "Fnumber =" << Fnumber <<std::endl;
-    orientation = get_Orientation(info.Orientation);
-    image_exif =  info.Make + "\n光圈 f/" + Fnumber + "\n快门 1/" + fomatExposureTime(info.ExposureTime) + "\nISO " + std::to_string(info.ISOSpeedRatings) +"\n旋转 "+ std::to_string(orientation)+"°"  ;
+    orientation = get_Orientation(info.orientation);
+    image_exif =  info.make + "\n光圈 f/" + Fnumber + "\n快门 1/" + fomatExposureTime(info.exposureTime) + "\nISO " + std::to_string(info.iso) +"\n旋转 "+ std::to_string(orientation)+"°"  ;
   
     return true;
 
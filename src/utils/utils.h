@@ -10,6 +10,7 @@
 #include <iostream> // \以包含 std::cout 和 std::cerr
 #include <cstring> // 包含 std::strerror 函数的头文件
 #include "../TinyEXIF/EXIF.h" 
+#include "ImageDecoder.h"
 
 #include <filesystem>
 namespace fs = std::filesystem;
@@ -17,7 +18,7 @@ namespace fs = std::filesystem;
 
 // 检查是否是支持的图像文件
 static const std::set<std::string> imageExtensions = {
-    ".jpg", ".jpeg", ".png", ".bmp", ".gif", ".tga","hdr",".psd"
+    ".jpg", ".jpeg", ".png", ".bmp", ".gif", ".tga",".hdr",".psd"
 };
 
 
@@ -32,7 +33,6 @@ void removeZero(std::string& str);
 //格式化曝光时间
 std::string fomatExposureTime(double& exposureTime) ;
 bool isFile(const std::string& path) ;
-bool isGifPath(const std::string& path);
 bool isDirectory(const std::string& path) ;
 std::string getDirectoryFromPath(const std::string& path) ;
 
@@ -107,16 +107,101 @@ public:
      */
 // bool LoadImage(const std::string& path, unsigned char** outData,  int* outWidth,  int* outHeight);
 unsigned char* LoadImage(const std::string& path,  int& outWidth, int& outHeight, int& channels ,int desiredChannels = 4); 
+    /**
+     * @brief 加载图像并缩小到显示尺寸（RGBA）
+     * @param maxSide 长边上限，0 或原图更小时返回原始尺寸
+     * @param outWidth/outHeight 返回像素数据的尺寸
+     * @param sourceWidth/sourceHeight 原图尺寸
+     * @param type 按文件头识别出的格式，可为空
+     * @return 像素数据，用 FreeImage 释放
+     */
+unsigned char* LoadImageScaled(const std::string& path, int maxSide, int& outWidth, int& outHeight,
+                               int& sourceWidth, int& sourceHeight, int& channels, ImageType* type = nullptr);
+
+/**
+ * @struct MipChain
+ * @brief 纹理的缩小层级（从第 1 级开始，第 0 级是原图），各级依次存放在 pixels 中
+ */
+struct MipChain {
+    struct Level {
+        int width = 0;
+        int height = 0;
+        size_t offset = 0;      // 在 pixels 中的起始位置
+    };
+    std::vector<Level> levels;
+    std::vector<unsigned char> pixels;
+
+    bool empty() const { return levels.empty(); }
+    size_t bytes() const { return pixels.size(); }
+};
+    /**
+     * @brief 在工作线程中生成完整的缩小层级（RGBA）
+     * @description 每级用 stb_image_resize2 的盒式滤波（整数倍时即 2x2 平均，内部使用 SIMD）
+     *              从上一级缩小一半，直到 1x1；尺寸规则与 GL 相同（向下取整，最小为 1）
+     * @return 取消或内存不足时返回 false，chain 为空
+     */
+bool BuildMipChain(const unsigned char* rgba, int width, int height, MipChain& chain);
   /**
      * @brief 安全释放由LoadImage加载的图像数据
      * @param data 图像数据指针（会被置为nullptr）
      */
 // 修改函数声明
-void FreeImage(unsigned char*& data, const std::string& path);
+void FreeImage(unsigned char*& data);
 
 
 // GIF
-unsigned char* loadGifImage(const std::string& path, int& outWidth, int& outHeight, int& channels, int& frames,std::vector<int>& outDelays) ;
+/**
+ * @class GifDecoder
+ * @brief 流式 GIF 解码器
+ * @description 每次只合成一帧（RGBA 画布），内存占用与帧数无关；读到结尾后可 rewind 循环播放。
+ *              不是线程安全的，同一时间只能在一个线程中使用。
+ */
+class GifDecoder {
+public:
+    GifDecoder();
+    ~GifDecoder();
+    GifDecoder(const GifDecoder&) = delete;
+    GifDecoder& operator=(const GifDecoder&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    // 回到第一帧
+    bool rewind();
+
+    /**
+     * @brief 解码下一帧
+     * @param outRGBA 输出缓冲区，至少 width*height*4 字节
+     * @param delayMs 本帧显示时间（毫秒）
+     * @return 读到结尾或出错时返回 false（isEnd 区分两者）
+     */
+    bool nextFrame(unsigned char* outRGBA, int& delayMs);
+
+    bool isOpen() const { return m_state != nullptr; }
+    bool isEnd() const { return m_end; }
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    int getFrameIndex() const { return m_frameIndex; }   // 下一次 nextFrame 返回的帧序号
+    /**
+     * @brief 上一次 nextFrame 相对前一帧变化的区域
+     * @description 由本帧的图像描述符和前一帧的处置方式得出；每轮的第一帧为整个画布
+     */
+    void getDirtyRect(int& x, int& y, int& width, int& height) const {
+        x = m_dirtyX; y = m_dirtyY; width = m_dirtyWidth; height = m_dirtyHeight;
+    }
+
+private:
+    struct State;
+    State* m_state = nullptr;
+    std::string m_path;
+    int m_width = 0;
+    int m_height = 0;
+    int m_frameIndex = 0;
+    bool m_end = false;
+    int m_dirtyX = 0;
+    int m_dirtyY = 0;
+    int m_dirtyWidth = 0;
+    int m_dirtyHeight = 0;
+};
 // GifImage loadGif(const std::string& path,  int& outWidth, int& outHeight,int& frame_count);
 
 
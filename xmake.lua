@@ -14,10 +14,20 @@ if is_plat("linux") then
     add_ldflags("-Wl,-rpath=$ORIGIN")
 end
 
+-- 可选：Linux 上用 io_uring 批量读取图片文件头（xmake f --io_uring=y）
+option("io_uring")
+    set_default(false)
+    set_showmenu(true)
+    set_description("Batch image header reads with io_uring (Linux, requires liburing)")
+option_end()
+
 -- 添加第三方库依赖
 add_requires("glfw 3.3.8", {configs = {shared = true}})
 add_requires("nanovg", {configs = {shared = true}})
 add_requires("glew", {configs = {shared = true}})
+if is_plat("linux") and has_config("io_uring") then
+    add_requires("liburing")
+end
 
 -- UI 静态库
 target("ui")
@@ -29,6 +39,10 @@ target("ui")
     add_files("src/TinyEXIF/*.cpp")
     add_includedirs("src", "src/component", "src/animation","src/utils","src/TinyEXIF")
     add_packages("glfw", "nanovg", "glew")
+    if is_plat("linux") and has_config("io_uring") then
+        add_packages("liburing", {public = true})
+        add_defines("VIMAG_IO_URING")
+    end
 
 
 
@@ -36,7 +50,7 @@ target("ui")
 target("UITest")
     set_kind("binary")
     add_rpathdirs("$ORIGIN")
-    add_files("src/main.cpp","src/TinyEXIF/TinyEXIF.cpp","src/component/TextureCache.cpp","src/VimagApp.cpp")
+    add_files("src/main.cpp","src/TinyEXIF/TinyEXIF.cpp","src/VimagApp.cpp")
     
     -- 添加Windows资源文件
     if is_plat("windows") then
@@ -71,7 +85,7 @@ target("UITest")
 -- target("VIMAG")
 --     set_kind("binary")
 --     add_rpathdirs("$ORIGIN")
---     add_files("src/Vimag.cpp","src/TinyEXIF/TinyEXIF.cpp","src/component/TextureCache.cpp","src/VimagApp.cpp")
+--     add_files("src/Vimag.cpp","src/TinyEXIF/TinyEXIF.cpp","src/VimagApp.cpp")
     
 --     -- 添加Windows资源文件
 --     if is_plat("windows") then